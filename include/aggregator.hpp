@@ -0,0 +1,54 @@
+#ifndef IOP_AGGREGATOR_HPP
+#define IOP_AGGREGATOR_HPP
+
+#include "sensors.hpp"
+#include "utils.hpp"
+#include <array>
+
+/// Streaming statistics of a single field, with Welford's online algorithm.
+/// Uses constant memory independently of the number of samples
+struct FieldSummary {
+  uint16_t count;
+  float min;
+  float max;
+  float mean;
+  /// Sum of squared differences from the mean, the variance is `m2 / count`
+  float m2;
+
+  void add(float value) noexcept;
+  auto variance() const noexcept -> float;
+};
+
+/// Statistics of every `EventStorage` value since the last summary was sent,
+/// laid out like `EventStorage::values`. Values are counted independently
+/// because invalid readings are ignored
+struct Summary {
+  uint16_t samples;
+  /// Unix time (in seconds) of the first and last timestamped samples, 0 if
+  /// none of them is
+  uint32_t from;
+  uint32_t to;
+  std::array<FieldSummary, eventChannels> channels;
+  FieldSummary acquisitionMillis;
+};
+
+/// Aggregates the measurements taken every `config::sampleInterval` into a
+/// single `Summary`, sent every `config::interval`. So data resolution grows
+/// without sending more requests
+class Aggregator {
+  Summary summary_;
+
+public:
+  Aggregator() noexcept;
+
+  void add(const Event &event) noexcept;
+  auto summary() const noexcept -> const Summary &;
+  auto isEmpty() const noexcept -> bool;
+  void reset() noexcept;
+
+  /// Averages of the aggregated samples, stored in flash if the summary can't
+  /// be sent. Timestamped at the middle of the summarized period
+  auto mean() const noexcept -> Event;
+};
+
+#endif
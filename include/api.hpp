@@ -1,12 +1,23 @@
 #ifndef IOP_API_HPP
 #define IOP_API_HPP
 
+#include "aggregator.hpp"
+#include "report.hpp"
+#include "outbound.hpp"
 #include "core/log.hpp"
 #include "core/network.hpp"
 #include "utils.hpp"
 
 #include <ArduinoJson.h>
 
+/// Result of a batched upload. The first `sent` events were accepted by the
+/// server, `status` refers to the request that stopped the batch (or the last
+/// one, if all were sent)
+struct BatchStatus {
+  iop::NetworkStatus status;
+  size_t sent;
+};
+
 /// High level client, that abstracts IoP API access in a safe and ergonomic way
 ///
 /// Handles all the network internals.
@@ -37,10 +48,12 @@ public:
   auto reportPanic(const AuthToken &authToken,
                    const PanicData &event) const noexcept -> iop::NetworkStatus;
 
-  /// Register frequent event to server, with measurements and device
-  /// information
+  /// Register many events with a single request. The payload is capped at
+  /// `config::eventBatchPayloadBudget` bytes, if the events don't fit they are
+  /// split into as many requests as needed, oldest first. Stops at the first
+  /// request that fails
   ///
-  /// Possible responses:
+  /// Possible statuses:
   ///
   /// OK: success
   /// FORBIDDEN: auth token is invalid
@@ -48,7 +61,17 @@ public:
   /// CLIENT_BUFFER_OVERFLOW: something is very broken with this methods's code
   /// MUST_UPGRADE: Well, upgrade your code
   /// BROKEN_SERVER: Must wait until server is fixed
-  auto registerEvent(const AuthToken &token, const Event &event) const noexcept
+  auto registerEvents(const AuthToken &token,
+                      iop::Span<const Event> events) const noexcept
+      -> BatchStatus;
+
+  /// Register statistics of the measurements taken since the last summary
+  /// sent, and how many summaries were suppressed. The format is documented at
+  /// `docs/EVENTS.md`
+  ///
+  /// Possible statuses are the same as `registerEvents`
+  auto registerSummary(const AuthToken &token, const Summary &summary,
+                       const ReportCounters &counters) const noexcept
       -> iop::NetworkStatus;
 
   /// Tries to authenticate with the server getting AuthToken if succeeded
@@ -62,6 +85,20 @@ public:
                     std::string_view password) const noexcept
       -> std::variant<AuthToken, iop::NetworkStatus>;
 
+  /// Starts `authenticate` without waiting for the server, so the captive
+  /// portal is served meanwhile. Check `authenticated`
+  ///
+  /// OK: started
+  /// CONNECTION_ISSUES: another request is in flight, or no connection
+  /// Other statuses are the same as `authenticate`
+  auto startAuthentication(std::string_view username,
+                           std::string_view password) const noexcept
+      -> iop::NetworkStatus;
+  /// Result of the authentication started by `startAuthentication`, once the
+  /// server answers (it's returned only once). The same as `authenticate`'s
+  auto authenticated() const noexcept
+      -> std::optional<std::variant<AuthToken, iop::NetworkStatus>>;
+
   /// Reports panicHandler message to server. Possible responses:
   ///
   /// OK: panicHandler successfully reported
@@ -72,6 +109,20 @@ public:
   auto registerLog(const AuthToken &authToken,
                    std::string_view log) const noexcept -> iop::NetworkStatus;
 
+  /// Queues the log to be sent by `drain`, with `registerLog`. It never
+  /// touches the network, so it's safe to call from the logger itself.
+  /// Returns false if the queue is full
+  auto enqueueLog(std::string_view log) const noexcept -> bool;
+
+  /// Kind of the next queued request, if it may be sent now (requests that
+  /// failed may be backing off, check `iop::RetryPolicy`)
+  auto nextOutbound() const noexcept -> std::optional<OutboundKind>;
+
+  /// Sends the next queued request, check `OutboundQueue`. None if nothing
+  /// may be sent now. Requests that fail with CONNECTION_ISSUES or
+  /// BROKEN_SERVER stay queued, to be retried later
+  auto drain(const AuthToken &token) const noexcept -> std::optional<iop::NetworkStatus>;
+
   /// Tries to update. Restarts on success. Returns OK if no updates are
   /// available
   ///
@@ -95,6 +146,10 @@ public:
 private:
   using JsonCallback = std::function<void(JsonDocument &)>;
 
+  /// Posts a request taken from the queue
+  auto send(const AuthToken &token, iop::StaticString path, std::string_view payload) const noexcept
+      -> iop::NetworkStatus;
+
   /// Abstracs safe json serialization. Returns None on overflow
   ///
   /// Overflows will mean the json couldn't be generated fitting the SIZE
@@ -104,6 +159,19 @@ private:
   auto makeJson(const iop::StaticString name,
                 const JsonCallback &func) const noexcept
       -> std::optional<std::reference_wrapper<std::array<char, 1024>>>;
+
+  /// Checks the token sent by the server, in answer to the login
+  auto tokenOf(const std::variant<iop::Response, int> &maybeResp) const noexcept
+      -> std::variant<AuthToken, iop::NetworkStatus>;
+
+  /// How many events, from the start, fit in a batch payload
+  auto eventsFittingBatch(iop::Span<const Event> events) const noexcept -> size_t;
+
+  /// Sends events with the binary encoding (check `docs/EVENTS.md`). Returns
+  /// None if the server doesn't support it, so JSON should be used instead
+  auto registerEventsBinary(const AuthToken &token, iop::StaticString path,
+                            iop::Span<const Event> events) const noexcept
+      -> std::optional<iop::NetworkStatus>;
 public:
   ~Api() noexcept;
   Api(Api const &other);
@@ -0,0 +1,37 @@
+#ifndef IOP_CLOCK_HPP
+#define IOP_CLOCK_HPP
+
+#include "driver/thread.hpp"
+#include "utils.hpp"
+
+/// Maps the monotonic clock (`millis()`) to Unix time. It's synchronized with
+/// NTP every `config::timeSyncInterval`, and measures how much `millis()`
+/// drifts between synchronizations to correct the mapping
+class Clock {
+  bool synchronized_;
+  /// Monotonic and Unix time of the last synchronization
+  iop::esp_time anchorMillis;
+  uint64_t anchorUnixMillis;
+  /// How fast `millis()` runs compared to NTP, in parts per million
+  int32_t driftPpm_;
+  bool hasDrift;
+
+public:
+  Clock() noexcept;
+
+  void setup() const noexcept;
+  /// Checks if the clock was synchronized, never blocks. Returns true if it was
+  auto handle(iop::esp_time now) noexcept -> bool;
+  /// Records that it was `unixMillis` at `now`
+  void synchronized(iop::esp_time now, uint64_t unixMillis) noexcept;
+
+  auto isSynchronized() const noexcept -> bool;
+  auto driftPpm() const noexcept -> int32_t;
+
+  /// Unix time at `monotonic`, which may precede the synchronization. 0 if the
+  /// clock was never synchronized
+  auto unixMillis(iop::esp_time monotonic) const noexcept -> uint64_t;
+  auto unixSeconds(iop::esp_time monotonic) const noexcept -> uint32_t;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef IOP_CORE_CONNECTION_HPP
+#define IOP_CORE_CONNECTION_HPP
+
+#include "driver/thread.hpp"
+#include <stdint.h>
+
+namespace iop {
+/// Since boot
+struct ConnectionStats {
+  uint32_t requests;
+  /// Requests sent over an already open connection
+  uint32_t reused;
+  /// Kept-alive connections found closed by the server, the request was
+  /// retried over a new one
+  uint32_t reconnected;
+};
+
+/// Decides when the single keep-alive connection to the server may be reused.
+/// It's closed after `idleTimeout` without requests (servers drop idle
+/// connections, so we must do it first) or after serving `maxRequests`
+///
+/// Doesn't own the socket, check `Network::httpRequest`
+class ConnectionManager {
+  iop::esp_time idleTimeout;
+  uint16_t maxRequests;
+
+  iop::esp_time lastUsed;
+  /// Requests served by the current connection
+  uint16_t served;
+  ConnectionStats stats_;
+
+public:
+  ConnectionManager(iop::esp_time idleTimeout, uint16_t maxRequests) noexcept;
+
+  /// If the next request may use the connection. When false and it's still
+  /// open it must be closed first
+  auto canReuse(iop::esp_time now, bool connected) const noexcept -> bool;
+  /// Records a request, `reused` if it was sent over an already open connection
+  void sent(iop::esp_time now, bool reused) noexcept;
+  void reconnected() noexcept;
+
+  auto stats() const noexcept -> ConnectionStats;
+  /// Percentage of the requests that reused a connection
+  auto hitRate() const noexcept -> uint8_t;
+};
+} // namespace iop
+
+#endif
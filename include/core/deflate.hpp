@@ -0,0 +1,62 @@
+#ifndef IOP_CORE_DEFLATE_HPP
+#define IOP_CORE_DEFLATE_HPP
+
+#include "core/utils.hpp"
+
+#include <array>
+#include <optional>
+#include <stdint.h>
+#include <string_view>
+
+namespace iop {
+/// Since boot
+struct CompressionStats {
+  /// Requests sent compressed
+  uint32_t requests;
+  uint32_t bytesIn;
+  uint32_t bytesOut;
+};
+
+/// Gzip (RFC 1952) compressor for request bodies. Single pass LZ77 with a hash
+/// table of the last position of each 3 byte sequence (no chains), encoded as
+/// a single DEFLATE block with the fixed Huffman codes, so it needs no tables
+/// besides `head`.
+///
+/// The input is always fully in memory (JSON or logs), so matches are searched
+/// in it directly, there is no separate window buffer
+class Deflate {
+public:
+  /// Matches further away are ignored
+  constexpr static uint16_t window = 4096;
+  constexpr static uint8_t hashBits = 8;
+
+private:
+  /// Position + 1 of the last occurrence of each hash, 0 if none
+  std::array<uint16_t, 1 << hashBits> head;
+
+  Span<char> output;
+  size_t length;
+  bool overflow;
+  uint32_t bits;
+  uint8_t bitCount;
+
+public:
+  Deflate() noexcept;
+
+  /// Compresses `input` into `output`, returning how much of it was used.
+  /// None if it doesn't fit
+  auto gzip(std::string_view input, Span<char> output) noexcept -> std::optional<size_t>;
+
+private:
+  void literal(uint16_t symbol) noexcept;
+  void match(size_t length, size_t distance) noexcept;
+  /// Huffman codes are packed starting from their most significant bit
+  void writeCode(uint16_t code, uint8_t count) noexcept;
+  void writeBits(uint32_t value, uint8_t count) noexcept;
+  void writeByte(uint8_t byte) noexcept;
+  void writeUint32(uint32_t value) noexcept;
+  void flushBits() noexcept;
+};
+} // namespace iop
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef IOP_CORE_HEADERS_HPP
+#define IOP_CORE_HEADERS_HPP
+
+#include "core/string.hpp"
+#include "core/utils.hpp"
+#include "driver/thread.hpp"
+
+#include <array>
+#include <optional>
+#include <string_view>
+
+namespace iop {
+/// Formats the URI, authorization and the headers sent with every request
+/// into preallocated buffers, without temporary strings. Headers that never
+/// change (VERSION and MAC_ADDRESS) are formatted once, at `setup`
+///
+/// Headers are stored as consecutive null terminated names and values
+class HeaderBuilder {
+public:
+  constexpr static size_t capacity = 256;
+  constexpr static size_t uriCapacity = 128;
+  constexpr static size_t tokenCapacity = 64;
+
+private:
+  std::array<char, capacity> headers;
+  /// Where the headers that change every request start
+  size_t staticLength;
+  size_t length;
+  std::array<char, uriCapacity + 1> uri_;
+  std::array<char, tokenCapacity + 1> authorization_;
+
+public:
+  HeaderBuilder() noexcept;
+
+  void setup(const MD5Hash &md5, const MacAddress &mac) noexcept;
+
+  /// Each returns false if it doesn't fit its buffer
+  auto setUri(StaticString base, StaticString path) noexcept -> bool;
+  /// Without a token the authorization is empty, it must be cleared as
+  /// HTTPClient keeps it between requests
+  auto setAuthorization(std::optional<std::string_view> token) noexcept -> bool;
+  /// Replaces the headers that change every request
+  auto setDeviceStats(size_t freeStack, size_t freeHeap, size_t biggestFreeBlock,
+                      uint16_t vcc, iop::esp_time timeRunning) noexcept -> bool;
+  /// Makes the request conditional, the server answers 304 if its entity tag
+  /// is `etag`. Must come after `setDeviceStats`, that removes it
+  auto setIfNoneMatch(std::string_view etag) noexcept -> bool;
+
+  auto uri() const noexcept -> const char * { return this->uri_.data(); }
+  auto authorization() const noexcept -> const char * { return this->authorization_.data(); }
+
+  /// Calls `func(name, value)` for every header, in order
+  template <typename Func>
+  void forEach(Func func) const noexcept {
+    size_t index = 0;
+    while (index < this->length) {
+      const char *name = this->headers.data() + index; // NOLINT *-pro-bounds-pointer-arithmetic
+      index += strlen(name) + 1;
+      const char *value = this->headers.data() + index; // NOLINT *-pro-bounds-pointer-arithmetic
+      index += strlen(value) + 1;
+      func(name, value);
+    }
+  }
+
+private:
+  auto append(StaticString str) noexcept -> bool;
+  auto append(std::string_view str) noexcept -> bool;
+  auto append(uint64_t number) noexcept -> bool;
+};
+} // namespace iop
+
+#endif
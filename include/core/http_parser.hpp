@@ -0,0 +1,106 @@
+#ifndef IOP_CORE_HTTP_PARSER_HPP
+#define IOP_CORE_HTTP_PARSER_HPP
+
+#include <array>
+#include <optional>
+#include <stdint.h>
+#include <string_view>
+
+namespace iop {
+/// Incremental HTTP/1.x response parser. Input can be split anywhere, each
+/// byte is examined once and never moved, body slices point into the input.
+/// Only lines split between reads are copied, to a small internal buffer
+///
+/// Supports `Content-Length`, chunked transfer encoding and bodies delimited
+/// by the connection closing. Collects the values of the headers registered
+/// with `collect`
+///
+/// Doesn't allocate, so it may be used by the device's client too
+class HttpResponseParser {
+public:
+  enum class State : uint8_t {
+    STATUS_LINE,
+    HEADERS,
+    BODY,
+    CHUNK_SIZE,
+    CHUNK_DATA,
+    CHUNK_DATA_END,
+    TRAILERS,
+    DONE,
+    FAILED,
+  };
+
+  constexpr static size_t lineCapacity = 256;
+  constexpr static uint8_t maxCollectedHeaders = 4;
+  constexpr static size_t headerValueCapacity = 64;
+
+  /// Part of the input processed by a `feed` call, `body` points into it
+  struct Step {
+    size_t consumed;
+    std::string_view body;
+  };
+
+private:
+  struct Header {
+    const char *name;
+    std::array<char, headerValueCapacity> value;
+    uint8_t length;
+    bool found;
+  };
+
+  State state_;
+  uint16_t status_;
+  std::optional<size_t> contentLength_;
+  bool chunked;
+  bool keepAlive_;
+  /// Body length is only known when the connection closes
+  bool untilClose;
+  /// Answers HEAD, so it has no body, whatever its headers say
+  bool bodyless;
+  /// Body bytes still expected, of the whole body or of the current chunk
+  size_t remaining;
+
+  std::array<char, lineCapacity> line;
+  size_t lineLength;
+
+  std::array<Header, maxCollectedHeaders> headers;
+  uint8_t headersCount;
+
+public:
+  HttpResponseParser() noexcept;
+
+  /// Prepares to parse a new response, keeps the headers to collect
+  void reset() noexcept;
+  /// Must be called after `reset` for responses to HEAD requests
+  void expectNoBody() noexcept { this->bodyless = true; }
+  /// `name` must outlive the parser. Returns false if `maxCollectedHeaders`
+  /// are already collected
+  auto collect(const char *name) noexcept -> bool;
+
+  /// Processes `input` until its end, or until the end of the next body
+  /// slice. Call it again with the unconsumed input
+  auto feed(std::string_view input) noexcept -> Step;
+  /// Must be called when the connection closes, it may end the body
+  void finish() noexcept;
+
+  auto state() const noexcept -> State { return this->state_; }
+  auto isDone() const noexcept -> bool { return this->state_ == State::DONE; }
+  auto hasFailed() const noexcept -> bool { return this->state_ == State::FAILED; }
+  auto status() const noexcept -> uint16_t { return this->status_; }
+  auto contentLength() const noexcept -> std::optional<size_t> { return this->contentLength_; }
+  /// If the server allows sending another request over this connection
+  auto keepAlive() const noexcept -> bool { return this->keepAlive_; }
+  /// Value of a collected header, if the server sent it. Values longer than
+  /// `headerValueCapacity` are truncated
+  auto header(std::string_view name) const noexcept -> std::optional<std::string_view>;
+
+private:
+  void processLine(std::string_view line) noexcept;
+  void processStatusLine(std::string_view line) noexcept;
+  void processHeader(std::string_view line) noexcept;
+  void processChunkSize(std::string_view line) noexcept;
+  void endHeaders() noexcept;
+};
+} // namespace iop
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef IOP_CORE_MQTT_HPP
+#define IOP_CORE_MQTT_HPP
+
+#include "core/utils.hpp"
+#include "driver/thread.hpp"
+
+#include <array>
+#include <optional>
+#include <stdint.h>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+class WiFiClient;
+
+namespace iop {
+enum class MqttPacketType : uint8_t {
+  CONNECT = 1,
+  CONNACK,
+  PUBLISH,
+  PUBACK,
+  PUBREC,
+  PUBREL,
+  PUBCOMP,
+  SUBSCRIBE,
+  SUBACK,
+  UNSUBSCRIBE,
+  UNSUBACK,
+  PINGREQ,
+  PINGRESP,
+  DISCONNECT,
+};
+
+/// Views the buffer it was decoded from
+struct MqttPacket {
+  MqttPacketType type;
+  /// Lower nibble of the fixed header
+  uint8_t flags;
+  /// Variable header and payload
+  std::string_view body;
+  /// Of the whole packet, fixed header included
+  size_t size;
+};
+
+enum class MqttDecodeError {
+  /// More bytes are needed
+  INCOMPLETE,
+  MALFORMED,
+};
+
+struct MqttMessage {
+  std::string_view topic;
+  std::string_view payload;
+  /// 0 for QoS 0
+  uint16_t packetId;
+  uint8_t qos;
+  bool retain;
+  bool dup;
+};
+
+struct MqttConnect {
+  std::string_view clientId;
+  std::string_view username;
+  std::string_view password;
+  /// Seconds
+  uint16_t keepAlive;
+  bool cleanSession;
+};
+
+struct MqttSubscription {
+  uint16_t packetId;
+  std::string_view topic;
+  uint8_t qos;
+};
+
+/// MQTT 3.1.1 packets, only the ones a QoS 1 client (and a broker stand-in
+/// for it) needs. Encoders write to `output` and return the packet's size,
+/// none if it doesn't fit. Decoders view their input
+class MqttCodec {
+public:
+  static auto connect(const MqttConnect &connect, Span<char> output) noexcept -> std::optional<size_t>;
+  static auto connack(bool sessionPresent, uint8_t code, Span<char> output) noexcept -> std::optional<size_t>;
+  /// `message.packetId` is ignored for QoS 0
+  static auto publish(const MqttMessage &message, Span<char> output) noexcept -> std::optional<size_t>;
+  static auto puback(uint16_t packetId, Span<char> output) noexcept -> std::optional<size_t>;
+  static auto subscribe(const MqttSubscription &subscription, Span<char> output) noexcept -> std::optional<size_t>;
+  static auto suback(uint16_t packetId, uint8_t qos, Span<char> output) noexcept -> std::optional<size_t>;
+  static auto pingreq(Span<char> output) noexcept -> std::optional<size_t>;
+  static auto pingresp(Span<char> output) noexcept -> std::optional<size_t>;
+  static auto disconnect(Span<char> output) noexcept -> std::optional<size_t>;
+
+  /// The first packet of `input`
+  static auto decode(std::string_view input) noexcept -> std::variant<MqttPacket, MqttDecodeError>;
+  static auto connectOf(const MqttPacket &packet) noexcept -> std::optional<MqttConnect>;
+  /// The session present flag and return code
+  static auto connackOf(const MqttPacket &packet) noexcept -> std::optional<std::pair<bool, uint8_t>>;
+  static auto messageOf(const MqttPacket &packet) noexcept -> std::optional<MqttMessage>;
+  /// Only the first topic of the subscription
+  static auto subscriptionOf(const MqttPacket &packet) noexcept -> std::optional<MqttSubscription>;
+  /// Of PUBACK and SUBACK
+  static auto packetIdOf(const MqttPacket &packet) noexcept -> std::optional<uint16_t>;
+};
+
+/// Client state that outlives the connection, as the broker keeps the session.
+/// Only one QoS 1 message is in flight at a time: publishing blocks until it's
+/// acknowledged, and a message that wasn't is redelivered with the same id
+class MqttSession {
+  uint16_t keepAlive;
+  uint16_t lastId;
+  std::optional<uint16_t> unacked;
+  uint32_t unackedHash;
+  esp_time lastSent;
+  esp_time pingSent;
+  bool pinging;
+
+public:
+  /// `keepAlive` in seconds, 0 disables it
+  explicit MqttSession(uint16_t keepAlive) noexcept;
+
+  /// Id of the next QoS 1 publish. The same message as the unacknowledged one
+  /// is a redelivery, so it keeps its id and the second is true (DUP)
+  auto publishing(std::string_view topic, std::string_view payload) noexcept -> std::pair<uint16_t, bool>;
+  /// False if it isn't the message in flight
+  auto acked(uint16_t packetId) noexcept -> bool;
+
+  void connected(esp_time now) noexcept;
+  void sent(esp_time now) noexcept;
+  void pinged(esp_time now) noexcept;
+  void ponged() noexcept;
+  /// The client must send something at least once per keep-alive, pings
+  /// are sent after half of it without traffic
+  auto shouldPing(esp_time now) const noexcept -> bool;
+  /// The broker didn't answer a ping in a keep-alive
+  auto isDead(esp_time now) const noexcept -> bool;
+  auto keepAliveSeconds() const noexcept -> uint16_t { return this->keepAlive; }
+};
+
+enum class MqttStatus {
+  OK,
+  /// Couldn't connect, the connection dropped or timed out
+  CONNECTION_ISSUES,
+  /// CONNACK refused the credentials
+  FORBIDDEN,
+  /// The broker sent something that isn't valid
+  BROKEN_SERVER,
+  CLIENT_BUFFER_OVERFLOW,
+};
+
+/// Called with every message received from the broker
+using MqttHandler = void (*) (std::string_view topic, std::string_view payload);
+
+/// Blocking MQTT 3.1.1 client over `client`, with QoS 1 and a persistent
+/// session (so subscriptions and in flight messages survive reconnections).
+/// Packets are built in fixed buffers, nothing is allocated
+class MqttClient {
+public:
+  constexpr static size_t outputCapacity = 1024 + 128;
+  constexpr static size_t inputCapacity = 256;
+
+private:
+  /// What the packet awaited by `receive` carries
+  struct Ack {
+    uint16_t packetId;
+    bool sessionPresent;
+    /// CONNACK's return code, or SUBACK's granted QoS
+    uint8_t code;
+  };
+
+  WiFiClient *client;
+  MqttSession session;
+  esp_time timeout;
+  MqttHandler handler;
+  std::array<char, outputCapacity> output;
+  std::array<char, inputCapacity> input;
+  size_t inputLength;
+  /// Bytes left of a packet that doesn't fit `input`, it's discarded
+  size_t skip;
+  bool connected_;
+
+public:
+  /// `timeout` (ms) bounds each wait for the broker
+  MqttClient(WiFiClient &client, uint16_t keepAlive, esp_time timeout) noexcept;
+
+  void onMessage(MqttHandler handler) noexcept { this->handler = handler; }
+
+  /// Noop if already connected. Without a persistent session at the broker
+  /// (first connection, or it expired) `subscription` is subscribed again
+  auto connect(std::string_view host, uint16_t port, const MqttConnect &connect,
+               std::optional<std::string_view> subscription) noexcept -> MqttStatus;
+  /// QoS 1, waits for the broker's acknowledgement
+  auto publish(std::string_view topic, std::string_view payload) noexcept -> MqttStatus;
+  /// Handles the messages received and keeps the connection alive, call it
+  /// often. Drops the connection if the broker is unresponsive
+  void poll() noexcept;
+  void disconnect() noexcept;
+  auto isConnected() noexcept -> bool;
+
+private:
+  auto send(std::optional<size_t> size) noexcept -> MqttStatus;
+  /// Reads from the broker, handling every packet until the one of type
+  /// `until` (with `packetId`, if it has one) arrives, or the timeout. Without
+  /// `until` it returns OK when nothing else is available
+  auto receive(std::optional<MqttPacketType> until, uint16_t packetId) noexcept
+      -> std::variant<Ack, MqttStatus>;
+  auto handle(const MqttPacket &packet) noexcept -> MqttStatus;
+  void drop() noexcept;
+};
+} // namespace iop
+
+#endif
@@ -5,7 +5,12 @@
 #include <optional>
 #include <string>
 #include "driver/client.hpp"
+#include "core/connection.hpp"
+#include "core/retry.hpp"
+#include "core/deflate.hpp"
+#include "core/timing.hpp"
 #include "core/log.hpp"
+#include "core/utils.hpp"
 
 namespace iop {
 /// Higher level error reporting. Lower level is logged
@@ -24,7 +29,7 @@ enum class HttpMethod;
 class CertStore;
 
 /// If server set LAST_VERSION HTTP header is different than current sketch's
-/// md5 hash the hook is called
+/// md5 hash the hook is called (with `IOP_MQTT` it's the retained update message)
 class UpgradeHook {
 public:
   using UpgradeScheduler = void (*) ();
@@ -34,6 +39,15 @@ public:
   static void defaultHook() noexcept; // Noop
 };
 
+/// Follows a request started by `Network::start`
+struct RequestHandle {
+  uint32_t id;
+};
+
+/// Called once, when a request started by `Network::start` ends, with what
+/// `httpRequest` would have returned
+using RequestCallback = void (*) (const std::variant<Response, int> &result);
+
 /// General lower level client network API, that is focused on our need.
 /// Security, good error reporting, no UB possible, ergonomy.
 ///
@@ -62,23 +76,95 @@ public:
   static void setUpgradeHook(UpgradeHook scheduler) noexcept;
   /// Removes current hook, replaces for default one (noop)
   static auto takeUpgradeHook() noexcept -> UpgradeHook;
+  /// Last LATEST_VERSION sent by the server, if any
+  static auto latestVersion() noexcept -> std::optional<MD5Hash>;
 
   static auto wifiClient() noexcept -> WiFiClient &;
+  /// Keep-alive connection reuse, since boot
+  static auto connectionStats() noexcept -> ConnectionStats;
+  /// Bodies of at least `config::compressionThreshold` bytes are gzipped. If
+  /// the server doesn't support it (415) they are sent uncompressed until reboot
+  static auto compressionStats() noexcept -> CompressionStats;
+  /// Per endpoint percentiles of each phase of the requests (check
+  /// `NetworkTimings::serialize`), written to `output`. None without
+  /// `IOP_NETWORK_TIMING` or if it doesn't fit
+  static auto timingMetrics(Span<char> output) noexcept -> std::optional<std::string_view>;
+
+  /// Failed requests are retried with backoff, check `RetryPolicy`. Requests
+  /// sent before it allows fail with `NetworkStatus::CONNECTION_ISSUES`
+  /// without touching the network
+  static auto retryState() noexcept -> RetryState;
+  /// Time until `path` may be requested, 0 if it may be now
+  auto retryIn(StaticString path) const noexcept -> esp_time;
+  /// Random delay in [delay / 2, delay], so fixed timers aren't in sync across the fleet
+  static auto jitter(esp_time delay) noexcept -> esp_time;
 
   static void disconnect() noexcept;
   static auto isConnected() noexcept -> bool;
 
+  /// Posts JSON data
   auto httpPost(std::string_view token, StaticString path,
                 std::string_view data) const noexcept
       -> std::variant<Response, int> const &;
   auto httpPost(StaticString path, std::string_view data) const noexcept
       -> std::variant<Response, int> const &;
+  /// Streams the response body into `body`, `Response::payload` views it
+  auto httpPost(StaticString path, std::string_view data, Span<char> body) const noexcept
+      -> std::variant<Response, int> const &;
+  /// Posts data with a custom `Content-Type`, it may be binary
+  auto httpPost(std::string_view token, StaticString path,
+                std::string_view data, StaticString contentType) const noexcept
+      -> std::variant<Response, int> const &;
+
+  /// Only the headers are read, the server answers 304 (as the raw int
+  /// response) if `etag` is still current
+  auto httpHead(std::string_view token, StaticString path, std::string_view etag) const noexcept
+      -> std::variant<Response, int> const &;
 
+  /// The response body is streamed into `body` as it arrives, bodies that
+  /// don't fit it are a `NetworkStatus::BROKEN_SERVER`. If it's empty the body
+  /// is discarded. Either way it's never buffered in the heap.
+  ///
+  /// With `ifNoneMatch` the request is conditional, check `httpHead`
   auto httpRequest(HttpMethod method, const std::optional<std::string_view> &token,
                    StaticString path,
-                   const std::optional<std::string_view> &data) const noexcept
+                   const std::optional<std::string_view> &data,
+                   StaticString contentType, Span<char> body,
+                   const std::optional<std::string_view> &ifNoneMatch) const noexcept
       -> std::variant<Response, int> const &;
 
+  /// Starts a request like `httpRequest`, but doesn't wait for the server,
+  /// so the loop keeps serving interrupts and the captive portal. It's
+  /// advanced by `poll`, that calls `callback` when it ends. `data` and `body`
+  /// must stay valid until then. Bodies aren't compressed
+  ///
+  /// Only one request is in flight at a time, blocking ones included since
+  /// they share the client. CONNECTION_ISSUES if there's already one, or if
+  /// `path` is backing off
+  auto start(HttpMethod method, const std::optional<std::string_view> &token, StaticString path,
+             const std::optional<std::string_view> &data, StaticString contentType, Span<char> body,
+             RequestCallback callback) const noexcept -> std::variant<RequestHandle, NetworkStatus>;
+  /// Advances the request in flight without waiting for the server (except
+  /// to connect), must be called often. True while it's in flight
+  auto poll() const noexcept -> bool;
+  static auto isPending(RequestHandle handle) noexcept -> bool;
+  /// Ends it without calling its callback, closing its connection
+  static void cancel(RequestHandle handle) noexcept;
+
+#ifdef IOP_MQTT
+  /// Publishes `payload` with QoS 1 to the topic "iop/<MAC address><path>",
+  /// instead of POSTing it to `path`. The connection to `config::mqttHost` is
+  /// kept open, the client id is the MAC address and `token` authenticates it.
+  ///
+  /// The upgrade hook is triggered by the retained message at
+  /// "iop/<MAC address>/v1/update", instead of the LATEST_VERSION header
+  auto publish(std::string_view token, StaticString path, std::string_view payload) const noexcept
+      -> NetworkStatus;
+  /// Receives the upgrade message and keeps the connection alive, must be
+  /// called often
+  static void pollMqtt() noexcept;
+#endif
+
   static auto rawStatusToString(const RawStatus &status) noexcept
       -> StaticString;
   auto rawStatus(int code) const noexcept -> RawStatus;
@@ -98,10 +184,12 @@ public:
 class Response {
 public:
   NetworkStatus status;
-  std::optional<std::string> payload;
+  /// View over the buffer given to `Network::httpRequest`, so it's only valid
+  /// until that buffer is reused
+  std::optional<std::string_view> payload;
   ~Response() noexcept;
   explicit Response(const NetworkStatus &status) noexcept;
-  Response(const NetworkStatus &status, std::string payload) noexcept;
+  Response(const NetworkStatus &status, std::string_view payload) noexcept;
   Response(Response &resp) noexcept = delete;
   Response(Response &&resp) noexcept;
   auto operator=(Response &resp) noexcept -> Response & = delete;
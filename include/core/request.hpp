@@ -0,0 +1,132 @@
+#ifndef IOP_CORE_REQUEST_HPP
+#define IOP_CORE_REQUEST_HPP
+
+#include "core/http_parser.hpp"
+#include "core/utils.hpp"
+#include "driver/thread.hpp"
+
+#include <array>
+#include <optional>
+#include <stdint.h>
+#include <string_view>
+
+class WiFiClient;
+
+namespace iop {
+/// HTTP/1.1 request that never waits for the server. Each `step` writes what
+/// the socket accepts and parses what already arrived, so the loop keeps
+/// running (serving interrupts and the captive portal) while the server
+/// answers. Only connecting blocks (DNS, TCP and the TLS handshake, up to the
+/// client's timeout), Arduino's clients can't connect asynchronously
+///
+/// Uses the raw stream API of `WiFiClient`, like `MqttClient`. The head is
+/// built in a fixed buffer and the response body is streamed into the buffer
+/// given to `start`, nothing is allocated. The connection is kept open if the
+/// server allows, and reused by the next request to the same host
+class HttpRequest {
+public:
+  enum class State : uint8_t {
+    IDLE,
+    CONNECTING,
+    SENDING,
+    RECEIVING,
+    DONE,
+    FAILED,
+  };
+
+  constexpr static size_t headCapacity = 768;
+  constexpr static size_t hostCapacity = 64;
+
+private:
+  WiFiClient *client;
+  State state_;
+  HttpResponseParser parser;
+
+  std::array<char, hostCapacity> host;
+  uint16_t port;
+  /// Where the open connection goes, so it's only reused by the same host
+  std::array<char, hostCapacity> connectedHost;
+  uint16_t connectedPort;
+  std::array<char, headCapacity> head;
+  size_t headLength;
+  std::string_view body;
+  /// Bytes of the head, then of the body, already written
+  size_t sent;
+
+  Span<char> response;
+  size_t responseLength;
+  bool overflowed_;
+
+  esp_time startedAt;
+  esp_time timeout;
+  /// Sent over a connection kept open by the previous request
+  bool reused;
+  bool reconnected_;
+  bool received;
+  int code_;
+
+public:
+  explicit HttpRequest(WiFiClient &client) noexcept;
+
+  /// Starts building the head. `uri` is like "https://host:port/path", the
+  /// port defaults to the scheme's. False if it's invalid or doesn't fit.
+  /// `method` and header values may point to flash (like `StaticString`)
+  auto begin(std::string_view method, std::string_view uri) noexcept -> bool;
+  /// Must come after `begin`. False if it doesn't fit `headCapacity`
+  auto addHeader(std::string_view name, std::string_view value) noexcept -> bool;
+  /// Collects the value of this response header. `name` must outlive the
+  /// request, check `HttpResponseParser::collect`
+  auto collect(const char *name) noexcept -> bool { return this->parser.collect(name); }
+  /// Must be called after `begin` for HEAD requests
+  void expectNoBody() noexcept { this->parser.expectNoBody(); }
+
+  /// Ends the head and sends it with `body` from the next `step`. `body` must
+  /// stay valid until the request ends, the response body is written to
+  /// `response` (it's discarded if empty). Fails after `timeout` (ms) without
+  /// finishing
+  auto start(std::string_view body, Span<char> response, esp_time timeout, esp_time now) noexcept -> bool;
+  /// Advances the request as far as it can without waiting. Returns the new
+  /// state
+  auto step(esp_time now) noexcept -> State;
+  /// Ends it, closing the connection if something was sent. Noop if it
+  /// already ended
+  void cancel() noexcept;
+
+  auto state() const noexcept -> State { return this->state_; }
+  auto isInFlight() const noexcept -> bool {
+    return this->state_ == State::CONNECTING || this->state_ == State::SENDING || this->state_ == State::RECEIVING;
+  }
+  /// HTTP status code when DONE, one of HTTPC_ERROR_* when FAILED
+  auto code() const noexcept -> int { return this->code_; }
+  /// Response body written to the buffer given to `start`
+  auto payload() const noexcept -> std::string_view { return std::string_view(this->response.begin(), this->responseLength); }
+  /// The response body didn't fit the buffer given to `start`, `payload` is truncated
+  auto overflowed() const noexcept -> bool { return this->overflowed_; }
+  /// Sent over a connection kept open by the previous request
+  auto wasReused() const noexcept -> bool { return this->reused; }
+  /// The kept-alive connection was found closed by the server, so it was sent
+  /// again over a new one
+  auto reconnected() const noexcept -> bool { return this->reconnected_; }
+  auto header(const std::string_view name) const noexcept -> std::optional<std::string_view> { return this->parser.header(name); }
+
+private:
+  auto append(std::string_view str) noexcept -> bool;
+  void connect() noexcept;
+  void send() noexcept;
+  void receive() noexcept;
+  /// Servers may close kept-alive connections before reading the request,
+  /// then it's sent again over a new connection
+  void lost(int code) noexcept;
+  void fail(int code) noexcept;
+  void finish() noexcept;
+
+public:
+  ~HttpRequest() noexcept = default;
+  HttpRequest(HttpRequest const &other) noexcept = delete;
+  HttpRequest(HttpRequest &&other) noexcept = delete;
+  auto operator=(HttpRequest const &other) noexcept -> HttpRequest & = delete;
+  auto operator=(HttpRequest &&other) noexcept -> HttpRequest & = delete;
+};
+} // namespace iop
+
+#endif
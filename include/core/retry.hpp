@@ -0,0 +1,105 @@
+#ifndef IOP_CORE_RETRY_HPP
+#define IOP_CORE_RETRY_HPP
+
+#include "driver/thread.hpp"
+
+#include <array>
+#include <optional>
+#include <stdint.h>
+#include <string_view>
+
+namespace iop {
+enum class RetryFailure {
+  /// Connection issues, the server may be fine
+  TRANSIENT,
+  /// Server answered with errors, counts towards opening the circuit breaker
+  BROKEN_SERVER,
+};
+
+/// Since boot
+struct RetryState {
+  /// Endpoints currently backing off
+  uint8_t backingOff;
+  bool breakerOpen;
+  /// Until the next attempt is allowed anywhere, 0 if it's allowed now
+  iop::esp_time waitFor;
+  /// Requests not sent because of the policy
+  uint32_t suppressed;
+};
+
+/// Decides when each endpoint may be retried after failing, so a server blip
+/// doesn't become a synchronized retry storm across the fleet.
+///
+/// Each endpoint backs off exponentially with full jitter (a random delay up to
+/// `baseDelay * 2^failures`, capped at `maxDelay`), or for as long as the
+/// server asked with `Retry-After`. After `breakerThreshold` consecutive
+/// `RetryFailure::BROKEN_SERVER`, on any endpoint, the circuit breaker opens
+/// and no request is sent for a jittered `breakerCooldown`. Then a single
+/// attempt is allowed, closing it on success or opening it again on failure
+///
+/// Doesn't send anything, check `Network::httpRequest`
+class RetryPolicy {
+public:
+  constexpr static uint8_t capacity = 8;
+
+private:
+  struct Endpoint {
+    uint32_t key;
+    uint8_t failures;
+    iop::esp_time failedAt;
+    iop::esp_time delay;
+  };
+
+  iop::esp_time baseDelay;
+  iop::esp_time maxDelay;
+  uint8_t breakerThreshold;
+  iop::esp_time breakerCooldown;
+
+  std::array<std::optional<Endpoint>, capacity> endpoints;
+  uint8_t brokenStreak;
+  std::optional<iop::esp_time> openedAt;
+  iop::esp_time openFor;
+  /// A trial request is in flight, since `trialAt`
+  bool halfOpen;
+  iop::esp_time trialAt;
+  uint32_t suppressed_;
+  /// xorshift32 state, never 0
+  uint32_t random;
+
+public:
+  RetryPolicy(iop::esp_time baseDelay, iop::esp_time maxDelay, uint8_t breakerThreshold,
+              iop::esp_time breakerCooldown) noexcept;
+
+  /// Devices must have different seeds, or they would retry in sync
+  void seed(uint32_t seed) noexcept;
+
+  /// Time until `endpoint` may be attempted, 0 if it may be now
+  auto waitFor(std::string_view endpoint, iop::esp_time now) const noexcept -> iop::esp_time;
+  /// Like `waitFor`, but records the attempt. When the breaker is half-open
+  /// only one attempt is allowed, until its result is recorded
+  auto attempt(std::string_view endpoint, iop::esp_time now) noexcept -> bool;
+
+  /// The server answered, even if with a client error
+  void succeeded(std::string_view endpoint) noexcept;
+  /// `retryAfter` replaces the backoff of this failure, if the server sent it
+  void failed(std::string_view endpoint, iop::esp_time now, RetryFailure failure,
+              std::optional<iop::esp_time> retryAfter) noexcept;
+
+  auto isOpen(iop::esp_time now) const noexcept -> bool;
+  auto state(iop::esp_time now) const noexcept -> RetryState;
+
+  /// Random delay in [delay / 2, delay], for fixed timers that must not be in
+  /// sync across the fleet
+  auto jitter(iop::esp_time delay) noexcept -> iop::esp_time;
+
+private:
+  auto find(uint32_t key) const noexcept -> std::optional<uint8_t>;
+  auto next() noexcept -> uint32_t;
+  /// Uniform in [0, max]
+  auto uniform(iop::esp_time max) noexcept -> iop::esp_time;
+  auto breakerWait(iop::esp_time now) const noexcept -> iop::esp_time;
+  static auto keyOf(std::string_view endpoint) noexcept -> uint32_t;
+};
+} // namespace iop
+
+#endif
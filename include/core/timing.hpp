@@ -0,0 +1,106 @@
+#ifndef IOP_CORE_TIMING_HPP
+#define IOP_CORE_TIMING_HPP
+
+#include "core/utils.hpp"
+#include "driver/thread.hpp"
+
+#include <array>
+#include <optional>
+#include <stdint.h>
+#include <string_view>
+
+namespace iop {
+enum class RequestPhase : uint8_t {
+  DNS = 0,
+  CONNECT,
+  TLS,
+  FIRST_BYTE,
+  BODY,
+};
+constexpr static uint8_t requestPhases = 5;
+
+/// Milliseconds spent in each phase, indexed by `RequestPhase`
+using RequestTiming = std::array<esp_time, requestPhases>;
+
+/// Splits a request's duration in phases. Each mark closes a phase, adding to
+/// it the time since the previous mark. So phases that weren't marked (the
+/// driver can't tell them apart) are counted in the next marked one: the
+/// ESP8266 HTTPClient connects inside `sendRequest`, so there DNS, CONNECT
+/// and TLS are part of FIRST_BYTE, unless marked before it
+class RequestTimer {
+  RequestTiming timing_;
+  esp_time last;
+  bool running;
+
+public:
+  RequestTimer() noexcept;
+
+  void start(esp_time now) noexcept;
+  /// Noop if it wasn't started
+  void mark(RequestPhase phase, esp_time now) noexcept;
+  auto stop() noexcept -> RequestTiming;
+  auto isRunning() const noexcept -> bool { return this->running; }
+};
+
+/// Times the request being sent. `Network::httpRequest` starts and stops it,
+/// drivers mark the phases they can tell apart
+auto requestTimer() noexcept -> RequestTimer &;
+
+/// Timings of the latest requests to an endpoint, per phase. Buckets grow by
+/// powers of 4 (0ms, <4ms, <16ms, ... <16s, more), phases that didn't happen
+/// (like TLS on a reused connection) take 0ms. Counts are halved every
+/// `window` requests, so older requests fade away
+class TimingHistogram {
+public:
+  constexpr static uint8_t buckets = 9;
+  constexpr static uint8_t window = 64;
+
+private:
+  std::array<std::array<uint8_t, buckets>, requestPhases> counts;
+  uint8_t samples_;
+  uint32_t total_;
+
+public:
+  TimingHistogram() noexcept;
+
+  void record(const RequestTiming &timing) noexcept;
+  /// Upper bound of the bucket that contains the percentile (64s for the
+  /// last), 0 if empty
+  auto percentile(RequestPhase phase, uint8_t percent) const noexcept -> esp_time;
+  /// Requests in the histogram, after decay
+  auto samples() const noexcept -> uint8_t { return this->samples_; }
+  /// Requests recorded since boot
+  auto total() const noexcept -> uint32_t { return this->total_; }
+
+  static auto bucketOf(esp_time duration) noexcept -> uint8_t;
+  static auto upperBound(uint8_t bucket) noexcept -> esp_time;
+};
+
+/// A histogram for each endpoint we care about, and one for the others
+class NetworkTimings {
+public:
+  /// /v1/events, /v1/summary, /v1/log, /v1/panic, /v1/user/login, /v1/update and others
+  constexpr static uint8_t endpoints = 7;
+
+private:
+  std::array<TimingHistogram, endpoints> histograms;
+
+public:
+  NetworkTimings() noexcept = default;
+
+  /// `path` excludes the server's address
+  void record(std::string_view path, const RequestTiming &timing) noexcept;
+  auto histogram(uint8_t endpoint) const noexcept -> const TimingHistogram & { return this->histograms.at(endpoint); }
+  static auto endpointOf(std::string_view path) noexcept -> uint8_t;
+
+  /// Compact JSON, with the p50 and p95 of each phase of each endpoint that
+  /// has samples (in the `RequestPhase` order), in milliseconds:
+  ///
+  /// {"event":{"n":12,"p50":[0,16,0,64,4],"p95":[4,64,0,256,16]}}
+  ///
+  /// None if it doesn't fit `output`
+  auto serialize(Span<char> output) const noexcept -> std::optional<std::string_view>;
+};
+} // namespace iop
+
+#endif
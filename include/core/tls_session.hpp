@@ -0,0 +1,35 @@
+#ifndef IOP_CORE_TLS_SESSION_HPP
+#define IOP_CORE_TLS_SESSION_HPP
+
+#include <stdint.h>
+
+namespace iop {
+/// Since boot
+struct HandshakeStats {
+  uint32_t full;
+  uint32_t resumed;
+};
+
+/// Caches the TLS session negotiated with the server, so new connections
+/// resume it instead of paying a full handshake (hundreds of milliseconds of
+/// CPU and a few KB of heap). If `IOP_TLS_SESSION_RTC` is defined it's also
+/// kept in RTC memory, so it survives resets and deep sleep
+///
+/// Noop without `IOP_SSL`
+class TlsSessionCache {
+public:
+  /// Restores the persisted session and attaches it to `Network::wifiClient`
+  static void setup() noexcept;
+
+  /// Must surround every request that opens a new connection, to measure if
+  /// the session was resumed. A failed connection invalidates the session, as
+  /// the server may be refusing it
+  static void beforeHandshake() noexcept;
+  static void afterHandshake(bool succeeded) noexcept;
+
+  static void invalidate() noexcept;
+  static auto stats() noexcept -> HandshakeStats;
+};
+} // namespace iop
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef IOP_CORE_UPGRADE_HPP
+#define IOP_CORE_UPGRADE_HPP
+
+#include "core/utils.hpp"
+
+#include <array>
+#include <optional>
+#include <stdint.h>
+
+namespace iop {
+/// Remembers the last firmware offered by the server and how many times
+/// installing it failed. After `maxFailures` the image isn't downloaded again,
+/// until the server offers another one
+///
+/// Persisted as 4 byte blocks, for RTC memory (it survives the deep sleep of
+/// `halt`, that would otherwise retry the same broken image every hour)
+class UpgradeAttempts {
+public:
+  using Persisted = std::array<uint32_t, 11>;
+
+private:
+  uint8_t maxFailures;
+  MD5Hash offered;
+  uint8_t failures;
+
+public:
+  explicit UpgradeAttempts(uint8_t maxFailures) noexcept;
+
+  /// False if `offered` already failed too many times
+  auto shouldDownload(const MD5Hash &offered) const noexcept -> bool;
+  void failed(const MD5Hash &offered) noexcept;
+  auto failuresOf(const MD5Hash &offered) const noexcept -> uint8_t;
+
+  auto persist() const noexcept -> Persisted;
+  /// Ignores garbage, as RTC memory is lost on power loss
+  void restore(const Persisted &persisted) noexcept;
+};
+} // namespace iop
+
+#endif
@@ -5,6 +5,8 @@
 #include "core/log.hpp"
 #include "core/panic.hpp"
 #include <variant>
+#include <optional>
+#include <cstdint>
 
 // (Un)Comment this line to toggle wifi dependency
 #define IOP_ONLINE
@@ -17,6 +19,23 @@
 #define IOP_SSL
 #endif
 
+// (Un)Comment this line to toggle persisting the TLS session in RTC memory, so
+// it's resumed after resets and deep sleep (like the one after a panic)
+#define IOP_TLS_SESSION_RTC
+
+// (Un)Comment this line to toggle gzip compression of big request bodies
+#define IOP_COMPRESSION
+
+// (Un)Comment this line to toggle timing each phase of network requests (DNS,
+// connection, first byte...), logged per endpoint
+#define IOP_NETWORK_TIMING
+
+// (Un)Comment this line to toggle publishing events, summaries, logs and panics over MQTT
+// instead of HTTP POSTs, the server must run a broker (check `config::mqttHost`).
+// The broker's connection stays open in its own client, which costs roughly
+// another TLS session of RAM
+//#define IOP_MQTT
+
 // (Un)Comment this line to toggle memory stats logging
 //#define LOG_MEMORY
 
@@ -88,6 +107,43 @@ inline auto unwrap_mut(std::optional<T> &opt, const CodePoint point) -> T& {
     return opt.value();
 }
 
+/// Non-owning view over contiguous elements, like c++20's `std::span`.
+///
+/// Like `std::string_view` it shouldn't be stored, it's basically a reference.
+/// Out of bounds access panics.
+template <typename T>
+class Span {
+  T *ptr;
+  size_t length;
+
+public:
+  constexpr Span(T *ptr, size_t length) noexcept: ptr(ptr), length(length) {}
+  // NOLINTNEXTLINE hicpp-explicit-conversions
+  template <typename Container>
+  constexpr Span(Container &container) noexcept: ptr(container.data()), length(container.size()) {}
+
+  auto size() const noexcept -> size_t { return this->length; }
+  auto isEmpty() const noexcept -> bool { return this->length == 0; }
+  auto begin() const noexcept -> T * { return this->ptr; }
+  // NOLINTNEXTLINE *-pro-bounds-pointer-arithmetic
+  auto end() const noexcept -> T * { return this->ptr + this->length; }
+
+  auto operator[](const size_t index) const noexcept -> T & {
+    if (index >= this->length)
+      iop::panicHandler(F("Span index out of bounds"), IOP_CTX());
+    return this->ptr[index]; // NOLINT *-pro-bounds-pointer-arithmetic
+  }
+
+  /// Clamps to the available elements, so it never panics
+  auto subspan(const size_t offset, const size_t count = SIZE_MAX) const noexcept -> Span<T> {
+    if (offset >= this->length)
+      return Span<T>(this->end(), 0);
+    const auto available = this->length - offset;
+    // NOLINTNEXTLINE *-pro-bounds-pointer-arithmetic
+    return Span<T>(this->ptr + offset, count < available ? count : available);
+  }
+};
+
 template <typename T>
 inline auto unwrap(std::optional<T> &opt, const CodePoint point) -> T {
     if (!opt.has_value()) {
@@ -0,0 +1,141 @@
+#ifndef IOP_DRIVER_BACKEND_HPP
+#define IOP_DRIVER_BACKEND_HPP
+
+#ifdef IOP_DESKTOP
+#include "driver/thread.hpp"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace driver {
+/// Scripted answer of `MockBackend`
+struct MockResponse {
+  uint16_t status = 200;
+  std::string body;
+  /// Sent after the defaults (content-length, connection and LATEST_VERSION)
+  std::vector<std::pair<std::string, std::string>> headers;
+  /// Waits before answering, on top of `MockBackend::setLatency`
+  iop::esp_time latency = 0;
+  /// Closes the connection after sending this many bytes of the response
+  /// (headers included), so the client gets a truncated body
+  std::optional<size_t> truncateAt;
+  /// Dribbles the response in chunks of this many bytes, waiting `chunkDelay`
+  /// between them, so the client has to read slowly. 0 sends it all at once
+  size_t chunkSize = 0;
+  iop::esp_time chunkDelay = 0;
+};
+
+/// What `MockBackend` received. Gzipped bodies are inflated, like the server
+/// does (check the content-encoding header)
+struct MockRequest {
+  std::string method;
+  std::string path;
+  /// Names are lowercase
+  std::unordered_map<std::string, std::string> headers;
+  std::string body;
+  /// Length of the body as sent, before inflating it
+  size_t sentLength = 0;
+
+  auto header(std::string_view name) const noexcept -> std::optional<std::string_view>;
+};
+
+/// Stand-in for the IoP server, to run the desktop build against it with no
+/// outside services. It serves every connection from its own thread, one
+/// request at a time (so latency delays the other connections too), and
+/// answers like the real server, unless scripted otherwise:
+///
+/// POST /v1/user/login: 200 with a 64 bytes token
+/// /v1/event, /v1/events, /v1/summary, /v1/log, /v1/panic: 200, empty
+/// GET and HEAD /v1/update: 304 if If-None-Match is the latest version, 200 otherwise
+/// Anything else: 404
+///
+/// Bodies with `Content-Encoding: gzip` are inflated before answering, corrupted
+/// ones get 400. Other encodings get 415, and gzip too if `acceptGzip(false)`
+///
+/// Scripts are per path, and may be queued to answer the next requests in
+/// order, or replace the default answer
+class MockBackend {
+public:
+  /// Requests kept by `received`, older ones are dropped (they are still counted)
+  constexpr static size_t maxReceived = 1024;
+
+private:
+  uint16_t port_;
+  std::optional<int32_t> fd;
+  std::atomic<bool> running;
+  std::thread thread;
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, std::deque<MockResponse>> scripted;
+  std::unordered_map<std::string, MockResponse> fallbacks;
+  std::optional<std::string> latestVersion;
+  iop::esp_time latency;
+  uint32_t failEvery_;
+  uint32_t untilFailure;
+  bool acceptGzip_;
+  std::deque<MockRequest> received_;
+  std::unordered_map<std::string, uint32_t> counts;
+  uint32_t total;
+
+public:
+  /// Port 0 picks any available one, check `port` after `start`
+  explicit MockBackend(uint16_t port) noexcept;
+
+  /// Binds to 127.0.0.1 and serves from a new thread. False if the port can't be used
+  auto start() noexcept -> bool;
+  /// Closes every connection and waits for the thread
+  void stop() noexcept;
+  auto port() const noexcept -> uint16_t { return this->port_; }
+
+  /// Answers the next request to `path` (excluding the query). Queued in order,
+  /// they take precedence over `fallback`
+  void script(std::string path, MockResponse response) noexcept;
+  /// Replaces the default answer to `path`
+  void fallback(std::string path, MockResponse response) noexcept;
+  /// Sent as the LATEST_VERSION header of every response, if any
+  void setLatestVersion(std::optional<std::string> md5) noexcept;
+  /// Waits before every answer
+  void setLatency(iop::esp_time latency) noexcept;
+  /// From now on every nth request is answered with 500, unless scripted. 0
+  /// disables it
+  void failEvery(uint32_t nth) noexcept;
+  /// Servers that don't support gzipped bodies answer them with 415
+  void acceptGzip(bool accept) noexcept;
+
+  /// Latest requests, oldest first
+  auto received() const noexcept -> std::vector<MockRequest>;
+  /// Requests to `path` since start (or `clear`)
+  auto receivedCount(std::string_view path) const noexcept -> uint32_t;
+  auto receivedCount() const noexcept -> uint32_t;
+  /// Forgets the requests received and the scripts, keeps the settings
+  void clear() noexcept;
+
+private:
+  void run() noexcept;
+  /// Answers the requests fully buffered in `pending`. False if the connection
+  /// must be closed
+  auto handle(int32_t client, std::string &pending) noexcept -> bool;
+  /// `rejection` is the status of a body that can't be decoded
+  auto answer(const MockRequest &request, std::optional<uint16_t> rejection) noexcept -> MockResponse;
+  auto defaultAnswer(const MockRequest &request) const noexcept -> MockResponse;
+
+public:
+  ~MockBackend() noexcept;
+  MockBackend(MockBackend const &other) = delete;
+  MockBackend(MockBackend &&other) = delete;
+  auto operator=(MockBackend const &other) -> MockBackend & = delete;
+  auto operator=(MockBackend &&other) -> MockBackend & = delete;
+};
+} // namespace driver
+#endif
+
+#endif
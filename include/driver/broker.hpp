@@ -0,0 +1,118 @@
+#ifndef IOP_DRIVER_BROKER_HPP
+#define IOP_DRIVER_BROKER_HPP
+
+#ifdef IOP_DESKTOP
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace driver {
+/// What `MockBroker` received
+struct MockPublish {
+  std::string clientId;
+  std::string topic;
+  std::string payload;
+  uint16_t packetId;
+  uint8_t qos;
+  bool retain;
+  bool dup;
+};
+
+struct MockConnect {
+  std::string clientId;
+  std::string username;
+  std::string password;
+  uint16_t keepAlive;
+  bool cleanSession;
+};
+
+/// Stand-in for an MQTT 3.1.1 broker, to test `iop::MqttClient` with no
+/// outside services. Serves every connection from its own thread, like
+/// `MockBackend`. Supports what the client uses: QoS 0 and 1, persistent
+/// sessions (subscriptions survive reconnections, messages are queued while
+/// offline), retained messages and keep-alive. Topic filters must match
+/// exactly, wildcards aren't supported
+class MockBroker {
+  struct Session {
+    std::vector<std::string> subscriptions;
+    /// Published to its subscriptions while offline
+    std::vector<std::pair<std::string, std::string>> queued;
+    bool online;
+  };
+
+  uint16_t port_;
+  std::optional<int32_t> fd;
+  std::atomic<bool> running;
+  std::atomic<bool> kick;
+  std::thread thread;
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, Session> sessions;
+  std::unordered_map<std::string, std::string> retained;
+  /// Retained by `retain`, to be sent to the subscribers by the broker's thread
+  std::vector<std::pair<std::string, std::string>> outbox;
+  std::vector<MockPublish> published_;
+  std::vector<MockConnect> connects_;
+  uint32_t dropAcks_;
+  uint8_t refuse_;
+  uint32_t pings_;
+  uint16_t lastId;
+
+public:
+  /// Port 0 picks any available one, check `port` after `start`
+  explicit MockBroker(uint16_t port) noexcept;
+
+  /// Binds to 127.0.0.1 and serves from a new thread. False if the port can't be used
+  auto start() noexcept -> bool;
+  /// Closes every connection and waits for the thread
+  void stop() noexcept;
+  auto port() const noexcept -> uint16_t { return this->port_; }
+
+  /// Stored and sent to the subscribers of `topic`, now and whenever they
+  /// subscribe. An empty payload clears it
+  void retain(std::string topic, std::string payload) noexcept;
+  /// The next `count` QoS 1 messages aren't acknowledged, so they time out
+  void dropAcks(uint32_t count) noexcept;
+  /// Answers connections with this CONNACK return code, 0 accepts them
+  void refuse(uint8_t code) noexcept;
+  /// Closes every connection, sessions are kept
+  void disconnectAll() noexcept;
+
+  auto published() const noexcept -> std::vector<MockPublish>;
+  auto connects() const noexcept -> std::vector<MockConnect>;
+  auto pings() const noexcept -> uint32_t;
+
+private:
+  struct Connection {
+    int32_t fd;
+    std::string pending;
+    std::optional<std::string> clientId;
+  };
+
+  void run() noexcept;
+  /// Answers the packets fully buffered by `connections[index]`. False if the
+  /// connection must be closed
+  auto handle(std::vector<Connection> &connections, size_t index) noexcept -> bool;
+  /// Sends it to the online subscribers, queues it for the offline ones.
+  /// Must hold `mutex`
+  void deliver(std::vector<Connection> &connections, const std::string &topic, const std::string &payload) noexcept;
+  /// QoS 1. Must hold `mutex`
+  auto send(int32_t fd, const std::string &topic, const std::string &payload, bool retain) noexcept -> bool;
+
+public:
+  ~MockBroker() noexcept;
+  MockBroker(MockBroker const &other) = delete;
+  MockBroker(MockBroker &&other) = delete;
+  auto operator=(MockBroker const &other) -> MockBroker & = delete;
+  auto operator=(MockBroker &&other) -> MockBroker & = delete;
+};
+} // namespace driver
+#endif
+
+#endif
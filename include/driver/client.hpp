@@ -25,19 +25,38 @@
 #include "core/string.hpp"
 #include "core/utils.hpp"
 #include "core/log.hpp"
+#include "core/http_parser.hpp"
 
 #include <algorithm>
 #include <cctype>
 #include <string>
 
+#include <array>
+#include <chrono>
+
 #include <stdio.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 #include <stdlib.h>
 
 static iop::Log clientDriverLogger(iop::LogLevel::WARN, F("HTTP Client"));
 
+#include "core/timing.hpp"
+#ifdef IOP_NETWORK_TIMING
+#include "driver/thread.hpp"
+
+static void markPhase(const iop::RequestPhase phase) noexcept {
+  iop::requestTimer().mark(phase, driver::thisThread.now());
+}
+#else
+static void markPhase(const iop::RequestPhase phase) noexcept { (void)phase; }
+#endif
+
 static ssize_t send__(uint32_t fd, const char * msg, const size_t len) noexcept {
   if (iop::Log::isTracing())
     iop::Log::print(msg, iop::LogLevel::TRACE, iop::LogType::STARTEND);
@@ -108,17 +127,16 @@ typedef enum {
     HTTP_CODE_NETWORK_AUTHENTICATION_REQUIRED = 511
 } t_http_codes;
 
+/// Same interface as Arduino's, used as `HTTPClient::writeToStream`'s sink
 class Stream {
-  uint32_t fd;
 public:
-  Stream(uint32_t fd): fd(fd) {}
-
-  ssize_t write(const char *msg, size_t len) {
-    return send__(this->fd, msg, len);
-  }
-  ssize_t read(char *buff, size_t len) {
-    return recv(this->fd, buff, len);
-  }
+  virtual ~Stream() = default;
+  virtual size_t write(uint8_t byte) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
 };
 
 enum HTTPUpdateResult {
@@ -131,30 +149,211 @@ namespace BearSSL {
   class CertStoreBase;
 }
 
+struct Address {
+  sockaddr_storage storage;
+  socklen_t length;
+};
+
+/// Resolved addresses are cached for a while, `getaddrinfo` blocks and
+/// production resolvers cache too
+class DnsCache {
+  struct Entry {
+    std::string host;
+    uint16_t port;
+    std::vector<Address> addresses;
+    std::chrono::steady_clock::time_point expiration;
+  };
+  constexpr static uint8_t capacity = 4;
+  constexpr static auto ttl = std::chrono::seconds(60);
+  std::array<std::optional<Entry>, capacity> entries;
+  uint8_t next = 0;
+
+public:
+  auto resolve(const std::string &host, const uint16_t port) -> std::vector<Address> {
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto &entry: this->entries) {
+      if (entry.has_value() && entry->host == host && entry->port == port && entry->expiration > now)
+        return entry->addresses;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *result = nullptr;
+    const auto code = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result);
+    if (code != 0) {
+      clientDriverLogger.error(F("Unable to resolve "), host, F(": "), gai_strerror(code));
+      return {};
+    }
+
+    std::vector<Address> addresses;
+    for (const auto *info = result; info != nullptr; info = info->ai_next) {
+      Address address = {};
+      memcpy(&address.storage, info->ai_addr, info->ai_addrlen);
+      address.length = info->ai_addrlen;
+      addresses.push_back(address);
+    }
+    freeaddrinfo(result);
+
+    this->entries.at(this->next) = Entry { host, port, addresses, now + ttl };
+    this->next = static_cast<uint8_t>((this->next + 1) % capacity);
+    return addresses;
+  }
+};
+static DnsCache dnsCache;
+
+/// Owns the connection, like the device's. So it may be reused between
+/// requests by `HTTPClient`
 class WiFiClient {
+  std::optional<int32_t> fd;
+  std::string host;
+  uint16_t port = 0;
+
+  friend class HTTPClient;
 public:
   void setNoDelay(bool b) { (void) b; }
   void setSync(bool b) { (void) b; }
   void setInsecure() const noexcept {}
   void setCertStore(const BearSSL::CertStoreBase *base) const noexcept { (void) base; }
+
+  /// Also detects connections closed by the server
+  auto connected() -> uint8_t {
+    if (!this->fd.has_value())
+      return 0;
+
+    pollfd pfd = { *this->fd, POLLIN, 0 };
+    char byte = 0;
+    if (poll(&pfd, 1, 0) > 0 && recv(*this->fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) <= 0) {
+      this->stop();
+      return 0;
+    }
+    return 1;
+  }
+  void stop() {
+    if (this->fd.has_value())
+      close(*this->fd);
+    this->fd.reset();
+  }
+
+  /// Raw stream access, like Arduino's. For protocols other than HTTP (MQTT)
+  auto connect(const char *host, const uint16_t port) -> int {
+    return this->connect(std::string(host), port, std::chrono::milliseconds(5000)) ? 1 : 0;
+  }
+  /// Blocks until everything is written, 0 on errors
+  auto write(const uint8_t *data, const size_t size) -> size_t {
+    size_t sent = 0;
+    while (this->fd.has_value() && sent < size) {
+      pollfd pfd = { *this->fd, POLLOUT, 0 };
+      if (poll(&pfd, 1, 5000) <= 0)
+        return 0;
+      const auto written = send__(static_cast<uint32_t>(*this->fd), reinterpret_cast<const char *>(data) + sent, size - sent);
+      if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+        return 0;
+      if (written > 0)
+        sent += static_cast<size_t>(written);
+    }
+    return sent;
+  }
+  /// Bytes that may be written without blocking. The kernel doesn't tell how
+  /// many, so it's a guess while the socket is writable
+  auto availableForWrite() -> int {
+    if (!this->fd.has_value())
+      return 0;
+    pollfd pfd = { *this->fd, POLLOUT, 0 };
+    return poll(&pfd, 1, 0) > 0 ? 1024 : 0;
+  }
+  auto available() -> int {
+    int count = 0;
+    if (!this->fd.has_value() || ioctl(*this->fd, FIONREAD, &count) < 0)
+      return 0;
+    return count;
+  }
+  /// Non-blocking, -1 if nothing is available
+  auto read(uint8_t *data, const size_t size) -> int {
+    if (!this->fd.has_value())
+      return -1;
+    return static_cast<int>(recv(static_cast<uint32_t>(*this->fd), reinterpret_cast<char *>(data), size));
+  }
+
+private:
+  /// Non-blocking, tries every address resolved until `timeout`
+  auto connect(const std::string &host, const uint16_t port, const std::chrono::milliseconds timeout) -> bool {
+    this->stop();
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    const auto addresses = dnsCache.resolve(host, port);
+    markPhase(iop::RequestPhase::DNS);
+    for (const auto &address: addresses) {
+      const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+      if (remaining.count() <= 0)
+        break;
+
+      const auto fd = WiFiClient::connect(address, remaining);
+      if (fd.has_value()) {
+        this->fd = fd;
+        this->host = host;
+        this->port = port;
+        markPhase(iop::RequestPhase::CONNECT);
+        return true;
+      }
+    }
+    clientDriverLogger.error(F("Unable to connect to "), host);
+    return false;
+  }
+
+  static auto connect(const Address &address, const std::chrono::milliseconds timeout) -> std::optional<int32_t> {
+    const int32_t fd = socket(address.storage.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+      clientDriverLogger.error(F("Unable to open socket: "), strerror(errno));
+      return std::nullopt;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address.storage), address.length) < 0 && errno != EINPROGRESS) {
+      clientDriverLogger.warn(F("Unable to connect: "), strerror(errno));
+      close(fd);
+      return std::nullopt;
+    }
+
+    pollfd pfd = { fd, POLLOUT, 0 };
+    int error = 0;
+    socklen_t errorLength = sizeof(error);
+    if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0) {
+      clientDriverLogger.warn(F("Connect timeout"));
+      close(fd);
+      return std::nullopt;
+    }
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) < 0 || error != 0) {
+      clientDriverLogger.warn(F("Unable to connect: "), strerror(error));
+      close(fd);
+      return std::nullopt;
+    }
+    return fd;
+  }
 };
 
 class HTTPClient {
   std::vector<std::string> headersToCollect;
 
-  std::string uri;
+  std::string host;
+  uint16_t port = 80;
+  std::string path;
   std::unordered_map<std::string, std::string> headers;
-  std::string authorization;
+  bool reuse = true;
+  std::chrono::milliseconds timeout = std::chrono::milliseconds(5000);
 
   std::string responsePayload;
   std::unordered_map<std::string, std::string> responseHeaders;
 
-  std::optional<int32_t> currentFd;
+  WiFiClient *client = nullptr;
+  iop::HttpResponseParser parser;
 public:
-  void setReuse(bool reuse) { (void) reuse; }
+  void setReuse(bool reuse) { this->reuse = reuse; }
   void collectHeaders(const char **headerKeys, size_t count) {
     for (uint8_t index = 0; index < count; ++index) {
         this->headersToCollect.push_back(headerKeys[index]);
+        // Keys are static strings, so they outlive the parser
+        this->parser.collect(headerKeys[index]);
     }
   }
   std::string header(std::string key) {
@@ -167,257 +366,179 @@ public:
   std::string getString() {
     return this->responsePayload;
   }
+  /// The body was already read by `sendRequest`, so it never fails
+  int writeToStream(Stream *stream) {
+    if (stream == nullptr) return HTTPC_ERROR_NO_STREAM;
+    const auto *data = reinterpret_cast<const uint8_t *>(this->responsePayload.data());
+    return static_cast<int>(stream->write(data, this->responsePayload.length()));
+  }
+  /// The connection is kept open if it can be reused
   void end() {
-    if (this->currentFd.has_value())
-      close(iop::unwrap(this->currentFd, IOP_CTX()));
+    if (this->client != nullptr && !(this->reuse && this->parser.keepAlive()))
+      this->client->stop();
 
-    this->authorization.clear();
-    this->responsePayload.clear();
-    this->responseHeaders.clear();
-    this->uri.clear();
+    this->headers.clear();
   }
   void addHeader(iop::StaticString key, iop::StaticString value) {
-    auto keyLower = key.toString();
-    // Headers can't be UTF8 so we cool
-    std::transform(keyLower.begin(), keyLower.end(), keyLower.begin(),
-        [](unsigned char c){ return std::tolower(c); });
-    this->headers.emplace(keyLower, std::move(value.toString()));
+    this->addHeader(key, value.toString());
   }
   void addHeader(iop::StaticString key, std::string value) {
     auto keyLower = key.toString();
     // Headers can't be UTF8 so we cool
     std::transform(keyLower.begin(), keyLower.end(), keyLower.begin(),
         [](unsigned char c){ return std::tolower(c); });
-    this->headers.emplace(keyLower, value);
+    this->headers.insert_or_assign(keyLower, value);
   }
-  void setTimeout(uint32_t ms) { (void) ms; }
+  void addHeader(const char *key, const char *value) {
+    this->addHeader(iop::StaticString(reinterpret_cast<const __FlashStringHelper *>(key)), std::string(value));
+  }
+  void setTimeout(uint32_t ms) { this->timeout = std::chrono::milliseconds(ms); }
   void setAuthorization(std::string auth) {
-    if (auth.length() == 0) return;
-    this->headers.emplace(std::string("Authorization"), std::string("Basic ") + auth);
+    if (auth.length() == 0) {
+      this->headers.erase("authorization");
+      return;
+    }
+    this->headers.insert_or_assign(std::string("authorization"), std::string("Basic ") + auth);
   }
   int sendRequest(std::string method, const uint8_t *data, size_t len) {
     this->responsePayload.clear();
-
-    const std::string_view path(this->uri.c_str() + this->uri.find("/", this->uri.find("://") + 3));
-    clientDriverLogger->debug(F("Send request to "), path);
-
-    uint32_t fd = iop::unwrap_ref(this->currentFd, IOP_CTX());
-    if (clientDriverLogger->level() == iop::LogLevel::TRACE || iop::Log::isTracing())
-      iop::Log::print(F(""), iop::LogLevel::TRACE, iop::LogType::START);
-    send__(fd, method.c_str(), method.length());
-    send__(fd, " ", 1);
-    send__(fd, path.begin(), path.length());
-    send__(fd, " HTTP/1.0\r\n", 11);
-    send__(fd, "Content-Length: ", 16);
-    const auto dataLengthStr = std::to_string(len);
-    send__(fd, dataLengthStr.c_str(), dataLengthStr.length());
-    send__(fd, "\r\n", 2);
-    for (const auto& [key, value]: this->headers) {
-      send__(fd, key.c_str(), key.length());
-      send__(fd, ": ", 2);
-      send__(fd, value.c_str(), value.length());
-      send__(fd, "\r\n", 2);
+    this->responseHeaders.clear();
+    this->parser.reset();
+    if (method == "HEAD")
+      this->parser.expectNoBody();
+    iop_assert(this->client != nullptr, F("HTTPClient::begin must be called before HTTPClient::sendRequest"));
+    auto &client = *this->client;
+
+    const auto reused = client.connected() && client.host == this->host && client.port == this->port;
+    if (!reused && !client.connect(this->host, this->port, this->timeout))
+      return HTTPC_ERROR_CONNECTION_FAILED;
+    clientDriverLogger.debug(F("Send request to "), this->path, reused ? F(" (reused connection)") : F(""));
+
+    std::string request = method + " " + this->path + " HTTP/1.1\r\n";
+    request += "host: " + this->host + ":" + std::to_string(this->port) + "\r\n";
+    request += this->reuse ? "connection: keep-alive\r\n" : "connection: close\r\n";
+    request += "content-length: " + std::to_string(len) + "\r\n";
+    for (const auto& [key, value]: this->headers)
+      request += key + ": " + value + "\r\n";
+    request += "\r\n";
+    request.append(reinterpret_cast<const char *>(data), len);
+
+    const auto deadline = std::chrono::steady_clock::now() + this->timeout;
+    if (!this->sendAll(*client.fd, request, deadline)) {
+      client.stop();
+      return HTTPC_ERROR_SEND_HEADER_FAILED;
     }
-    send__(fd, "\r\n", 2);
-    send__(fd, (char*)data, len);
-    if (clientDriverLogger->level() == iop::LogLevel::TRACE || iop::Log::isTracing())
-      iop::Log::print(F(""), iop::LogLevel::TRACE, iop::LogType::END);
-    clientDriverLogger->debug(F("Sent data"));
-    
-    auto buffer = iop::FixedString<5096>::empty();
-    
-    ssize_t size = 0;
-    auto firstLine = true;
-    auto isPayload = false;
-    
-    auto status = std::make_optional(1000);
-    std::string_view buff(buffer.get());
-    while (true) {
-      clientDriverLogger->debug(F("Try read: "), std::to_string(buffer.length()));
-
-      if (buffer.length() < buffer.size &&
-          (size = read(fd, buffer.asMut() + buffer.length(), buffer.size - buffer.length())) < 0) {
-        clientDriverLogger->error(F("Error reading from socket ("), std::to_string(size), F("): "), std::to_string(errno), F(" - "), strerror(errno)); 
-        close(fd);
-        return 500;
-      }
-      buff = buffer.get();
-      clientDriverLogger->debug(F("Len: "), std::to_string(size));
-      if (firstLine && size == 0) {
-        close(fd);
-        clientDriverLogger->warn(F("Empty request: "), std::to_string(fd), F(" "), std::string(reinterpret_cast<const char*>(data), len));
-        return status.value_or(500);
-        //continue;
+    clientDriverLogger.debug(F("Sent data"));
+
+    std::array<char, 1024> buffer;
+    bool received = false;
+    while (!this->parser.isDone() && !this->parser.hasFailed()) {
+      const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+      pollfd pfd = { *client.fd, POLLIN, 0 };
+      if (remaining.count() <= 0 || poll(&pfd, 1, static_cast<int>(remaining.count())) <= 0) {
+        clientDriverLogger.error(F("Read timeout"));
+        client.stop();
+        return HTTPC_ERROR_READ_TIMEOUT;
       }
-      
-      clientDriverLogger->debug(F("Buffer: "), buff.substr(0, buff.find("\n") - 1));
-      //if (!buff.contains(F("\n"))) continue;
-      clientDriverLogger->debug(F("Read: ("), std::to_string(size), F(") ["), std::to_string(buffer.length()), F("]: "), std::string(buffer.get()).substr(0, buff.find("\n")));
 
-      if (firstLine && buff.find("\n") == buff.npos) continue;
-
-      if (firstLine && size < 10) { // len("HTTP/1.1 ") = 9
-        clientDriverLogger->error(F("Error reading first line: "), std::to_string(size));
-        return 500;
+      const auto size = recv(*client.fd, buffer.data(), buffer.size());
+      if (size < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) continue;
+        clientDriverLogger.error(F("Error reading from socket: "), std::to_string(errno), F(" - "), strerror(errno));
+        client.stop();
+        return HTTPC_ERROR_CONNECTION_LOST;
       }
-
-      if (firstLine && size > 0) {
-        clientDriverLogger->debug(F("Found first line: "));
-
-        const std::string_view statusStr(buffer.get() + 9); // len("HTTP/1.1 ") = 9
-        const auto codeEnd = statusStr.find(" ");
-        if (codeEnd == statusStr.npos) {
-          clientDriverLogger->error(F("Bad server: "), statusStr, F(" -- "), buff);
-          return 500;
+      if (size == 0) {
+        // Kept-alive connections may be closed by the server before answering
+        if (!received) {
+          client.stop();
+          return HTTPC_ERROR_CONNECTION_LOST;
         }
-        //iop_assert(buff.contains(F("\n")), iop::StaticString(F("First: ")).toString() + std::to_string(buffer.length()) + iop::StaticString(F(" bytes don't contain newline, the path is too long\n")).toString());
-        status = std::make_optional(atoi(std::string(statusStr.begin(), 0, codeEnd).c_str()));
-        clientDriverLogger->debug(F("Status: "), std::to_string(status.value_or(500)));
-        firstLine = false;
-
-        const char* ptr = buff.begin() + buff.find("\n") + 1;
-        memmove(buffer.asMut(), ptr, strlen(ptr) + 1);
-        buff = buffer.get();
+        this->parser.finish();
+        break;
       }
-      if (!status.has_value()) {
-        clientDriverLogger->error(F("No status"));
-        return 500;
+      if (!received)
+        markPhase(iop::RequestPhase::FIRST_BYTE);
+      received = true;
+
+      auto input = std::string_view(buffer.data(), static_cast<size_t>(size));
+      while (!input.empty() && !this->parser.isDone() && !this->parser.hasFailed()) {
+        const auto step = this->parser.feed(input);
+        this->responsePayload += step.body;
+        input.remove_prefix(step.consumed);
       }
-      clientDriverLogger->debug(F("Buffer: "), buff.substr(0, buff.find("\n") - 1));
-      //if (!buff.contains(F("\n"))) continue;
-      clientDriverLogger->debug(F("Headers + Payload: "), std::string(buffer.get()).substr(0, buff.find("\n")));
-
-      while (len > 0 && buffer.length() > 0 && !isPayload) {
-        // TODO: if empty line is split into t  wo reads (because of buff len) we are screwed
-        //  || buff.contains(F("\n\n")) || buff.contains(F("\n\r\n"))
-        if (buff.find("\r\n") == 0) {
-          clientDriverLogger->debug(F("Found Payload"));
-          isPayload = true;
-
-          const char* ptr = buff.begin() + buff.find("\r\n") + 2;
-          memmove(buffer.asMut(), ptr, strlen(ptr) + 1);
-          buff = buffer.get();
-          continue;
-        } else if (buff.find("\r\n") == buff.npos) {
-          iop_panic(F("Bad software bruh"));
-        } else if (buff.find("\r\n") != buff.npos) {
-          clientDriverLogger->debug(F("Found headers (buffer length: "), std::to_string(buff.length()), F(")"));
-          for (const auto &key: this->headersToCollect) {
-            if (buff.length() < key.length()) continue;
-            std::string headerKey(buffer.get(), 0, key.length());
-            // Headers can't be UTF8 so we cool
-            std::transform(headerKey.begin(), headerKey.end(), headerKey.begin(),
-              [](unsigned char c){ return std::tolower(c); });
-            clientDriverLogger->debug(headerKey, F(" == "), key);
-            if (headerKey != key)
-              continue;
-
-            auto valueView = buff.substr(key.length() + 1); // ":"
-            while (*valueView.begin() == ' ') valueView = valueView.substr(1);
-
-            iop_assert(valueView.find("\r\n") != valueView.npos, F("Must contain endline"));
-            const std::string value(valueView, 0, valueView.find("\r\n"));
-            clientDriverLogger->debug(F("Found header "), key, F(" = "), value, F("\n"));
-            this->responseHeaders.emplace(key, value);
-
-            iop_assert(buff.find("\r\n") > 0, F("Must contain endline"));
-            const char* ptr = buff.begin() + buff.find("\r\n") + 2;
-            memmove(buffer.asMut(), ptr, strlen(ptr) + 1);
-            buff = buffer.get();
-            if (buff.find("\n") == buff.npos) iop_panic(F("Fuuuc")); //continue;
-          }
-          if (buff.find("\n") == buff.npos) {
-            clientDriverLogger->warn(F("Newline missing in buffer: "), buff);
-            return 500;
-          }
-          clientDriverLogger->debug(F("Buffer: "), buff.substr(0, buff.find("\n") - 1));
-          clientDriverLogger->debug(F("Skipping header ("), buff.substr(0, buff.find("\n") - 1), F(")"));
-          const char* ptr = buff.begin() + buff.find("\r\n") + 2;
-          memmove(buffer.asMut(), ptr, strlen(ptr) + 1);
-          buff = buffer.get();
-          if (buff.find("\n") == buff.npos) iop_panic(F("Fuuk")); //continue;
-        } else {
-          iop_panic(F("Press F to pay respect"));
-        }
-      }
-
-      clientDriverLogger->debug(F("Payload ("), std::to_string(buff.length()), F(") ["), std::to_string(size), F("]: "), std::string(buffer.get()).substr(0, buff.find("\n") == buff.npos ? buff.find("\n") : buffer.length()));
+    }
 
-      this->responsePayload += buff;
+    markPhase(iop::RequestPhase::BODY);
 
-      // TODO: For some weird reason `read` is blocking if we try to read after EOF
-      // But it's not clear what will happen if EOF is exactly at buffer.size
-      // Because it will continue, altough there isn't anything, but it's blocking on EOF
-      // But this behavior is not documented. To replicate remove:
-      // ` && len == buffer.size` and it will get stuck in the `read` above
-      if (len > 0 && buff.length() > 0 && len == buffer.size)
-        continue;
-      break;
+    if (this->parser.hasFailed()) {
+      clientDriverLogger.error(F("Unable to parse response"));
+      client.stop();
+      return HTTPC_ERROR_NO_HTTP_SERVER;
     }
+    if (!this->reuse || !this->parser.keepAlive())
+      client.stop();
 
-    clientDriverLogger->debug(F("Close client: "), std::to_string(fd), F(" "), std::string(reinterpret_cast<const char*>(data), len));
-    close(fd);
-    clientDriverLogger->info(F("Status: "), std::to_string(status.value_or(500)));
-    return iop::unwrap(status, IOP_CTX());
+    for (const auto &key: this->headersToCollect) {
+      const auto value = this->parser.header(key);
+      if (value.has_value())
+        this->responseHeaders.emplace(key, std::string(*value));
+    }
+    clientDriverLogger.info(F("Status: "), std::to_string(this->parser.status()));
+    return this->parser.status();
   }
 
-  bool begin(WiFiClient client, std::string host, uint32_t port, std::string uri) {
+  bool begin(WiFiClient &client, std::string host, uint32_t port, std::string uri) {
     return this->begin(client, std::string("http://") + host + ":" + std::to_string(port) + uri);
   }
 
-  bool begin(WiFiClient client, std::string uri_) {
+  /// Only parses the URI, the connection is opened (or reused) by `sendRequest`
+  bool begin(WiFiClient &client, std::string uri_) {
     this->end();
-    this->uri = uri_;
-    (void) client;
+    this->client = &client;
 
     std::string_view uri(uri_);
-     
-    struct sockaddr_in serv_addr;
-    int32_t fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (fd < 0) {
-      clientDriverLogger->error(F("Unable to open socket"));
-      return false;
-    }
-
     iop_assert(uri.find("http://") == 0, F("Protocol must be http (no SSL)"));
-    uri = std::string_view(uri.begin() + 7);
-    
-    const auto portIndex = uri.find(iop::StaticString(F(":")).toString());
-    uint16_t port = 443;
-    if (portIndex != uri.npos) {
-      auto end = uri.substr(portIndex + 1).find("/");
-      if (end == uri.npos) end = uri.length();
-      port = static_cast<uint16_t>(strtoul(std::string(uri.begin(), portIndex + 1, end).c_str(), nullptr, 10));
-      if (port == 0) {
-        clientDriverLogger->error(F("Unable to parse port, broken server: "), uri);
+    uri.remove_prefix(7);
+
+    auto hostEnd = uri.find("/");
+    if (hostEnd == uri.npos) hostEnd = uri.length();
+    const auto authority = uri.substr(0, hostEnd);
+    this->path = hostEnd == uri.length() ? std::string("/") : std::string(uri.substr(hostEnd));
+
+    const auto portIndex = authority.find(":");
+    this->port = 80;
+    if (portIndex != authority.npos) {
+      this->port = static_cast<uint16_t>(strtoul(std::string(authority.substr(portIndex + 1)).c_str(), nullptr, 10));
+      if (this->port == 0) {
+        clientDriverLogger.error(F("Unable to parse port, broken server: "), uri);
         return false;
       }
     }
-    clientDriverLogger->debug(F("Port: "), std::to_string(port));
-
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(port);
-
-    auto end = uri.find(":");
-    if (end == uri.npos) end = uri.find("/");
-    if (end == uri.npos) end = uri.length();
-    
-    const auto host = std::string(uri.begin(), 0, end);
-    // Convert IPv4 and IPv6 addresses from text to binary form
-    if(inet_pton(AF_INET, host.c_str(), &serv_addr.sin_addr) <= 0) {
-      close(fd);
-      clientDriverLogger->error(F("Address not supported: "), host);
-      return false;
-    }
+    this->host = std::string(authority.substr(0, portIndex));
+    clientDriverLogger.debug(F("Host: "), this->host, F(", port: "), std::to_string(this->port));
+    return true;
+  }
 
-    int32_t connection = connect(fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr));
-    if (connection < 0) {
-      clientDriverLogger->error(F("Unnable to connect: "), std::to_string(connection));
-      close(fd);
-      return false;
+private:
+  auto sendAll(const int32_t fd, const std::string_view data, const std::chrono::steady_clock::time_point deadline) -> bool {
+    size_t sent = 0;
+    while (sent < data.length()) {
+      const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+      pollfd pfd = { fd, POLLOUT, 0 };
+      if (remaining.count() <= 0 || poll(&pfd, 1, static_cast<int>(remaining.count())) <= 0) {
+        clientDriverLogger.error(F("Write timeout"));
+        return false;
+      }
+
+      const auto size = send__(fd, data.data() + sent, data.length() - sent);
+      if (size < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) continue;
+        clientDriverLogger.error(F("Error writing to socket: "), strerror(errno));
+        return false;
+      }
+      sent += static_cast<size_t>(size);
     }
-    clientDriverLogger->debug(F("Began connection: "), uri);
-    this->currentFd = std::make_optional(fd);
     return true;
   }
 };
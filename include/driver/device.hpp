@@ -14,6 +14,10 @@ public:
   auto vcc() const noexcept -> uint16_t;
   auto biggestHeapBlock() const noexcept -> size_t;
   void deepSleep(uint32_t seconds) const noexcept;
+  /// RTC memory survives resets and deep sleep. `offset` is in 4 bytes blocks,
+  /// and it only has 512 bytes. Returns false if out of bounds
+  auto rtcRead(uint32_t offset, uint32_t *data, size_t size) const noexcept -> bool;
+  auto rtcWrite(uint32_t offset, uint32_t *data, size_t size) const noexcept -> bool;
   std::array<char, 32>& binaryMD5() const noexcept;
   std::array<char, 17>& macAddress() const noexcept;
 };
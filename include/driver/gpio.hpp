@@ -1,6 +1,7 @@
 #ifndef IOP_DRIVER_PINS_HPP
 #define IOP_DRIVER_PINS_HPP
 
+#include <cstdint>
 #include <functional>
 #undef INPUT
 #undef OUTPUT
@@ -38,6 +39,9 @@ class GPIO {
 public:
   void mode(Pin pin, Mode mode) const noexcept;
   auto digitalRead(Pin pin) const noexcept -> Data;
+  void digitalWrite(Pin pin, Data data) const noexcept;
+  /// ESP8266 only has one analog pin (A0)
+  auto analogRead() const noexcept -> uint16_t;
   void alarm(Pin pin, Alarm mode, void (*func)()) const noexcept;
 };
 extern GPIO gpio;
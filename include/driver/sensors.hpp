@@ -4,17 +4,43 @@
 #include "driver/gpio.hpp"
 
 #ifdef IOP_DESKTOP
+#include <cmath>
+
+// Inert, only so sensors compile on desktop
+constexpr static float DEVICE_DISCONNECTED_C = -127;
 struct OneWire {
   OneWire(uint8_t pin) { (void) pin; }
 };
 struct DallasTemperature {
+  DallasTemperature() = default;
   DallasTemperature(OneWire *ptr) { (void) ptr; }
+  void begin() {}
+  void setWaitForConversion(bool wait) { (void) wait; }
+  void requestTemperatures() {}
+  auto isConversionComplete() -> bool { return true; }
+  auto getDeviceCount() -> uint8_t { return 0; }
+  auto getAddress(uint8_t *address, uint8_t index) -> bool {
+    (void) address;
+    (void) index;
+    return false;
+  }
+  auto getTempC(const uint8_t *address) -> float {
+    (void) address;
+    return DEVICE_DISCONNECTED_C;
+  }
 };
 struct DHT {
   DHT(uint8_t pin, uint8_t version) {
     (void) pin;
     (void) version;
   }
+  void begin() {}
+  auto readTemperature() -> float { return NAN; }
+  auto readHumidity() -> float { return NAN; }
+  auto computeHeatIndex(bool isFahrenheit = true) -> float {
+    (void) isFahrenheit;
+    return NAN;
+  }
 };
 #else
 #include <DHT.h>
@@ -0,0 +1,52 @@
+#ifndef IOP_DRIVER_SIMULATOR_HPP
+#define IOP_DRIVER_SIMULATOR_HPP
+
+#include "driver/thread.hpp"
+#include <stdint.h>
+
+namespace driver {
+/// Shape of a synthetic time series
+struct SeriesProfile {
+  float mean;
+  /// Peak distance from the mean of the diurnal cycle, negative peaks at midnight
+  float amplitude;
+  /// Length of a simulated day
+  iop::esp_time dayMillis;
+  /// How much the mean moves each simulated day
+  float driftPerDay;
+  /// Standard deviation of the gaussian noise
+  float noise;
+  float min;
+  float max;
+  /// Chance that a sample fails (NaN)
+  float failureProbability;
+  /// Chance that the series gets stuck repeating the last value for `stuckSamples`
+  float stuckProbability;
+  uint16_t stuckSamples;
+};
+
+/// Synthetic time series, used to simulate sensors on desktop. The same
+/// profile and seed always generate the same samples, on every platform
+class Series {
+  SeriesProfile profile;
+  /// xorshift32 state, never 0
+  uint32_t state;
+  float last;
+  uint16_t stuckFor;
+
+public:
+  Series() noexcept;
+  Series(SeriesProfile profile, uint32_t seed) noexcept;
+
+  /// Value at `now` (milliseconds since the simulation started)
+  auto sample(iop::esp_time now) noexcept -> float;
+
+private:
+  auto next() noexcept -> uint32_t;
+  /// In [0, 1)
+  auto uniform() noexcept -> float;
+  auto gaussian() noexcept -> float;
+};
+} // namespace driver
+
+#endif
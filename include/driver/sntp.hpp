@@ -0,0 +1,22 @@
+#ifndef IOP_DRIVER_SNTP_HPP
+#define IOP_DRIVER_SNTP_HPP
+
+#include <stdint.h>
+#include <optional>
+
+namespace driver {
+/// Keeps the system clock synchronized with NTP servers. On desktop the host
+/// clock stands in for them, as the OS already keeps it synchronized
+class Sntp {
+public:
+  /// Starts synchronizing in the background, every `intervalMillis`
+  void setup(uint32_t intervalMillis) const noexcept;
+  /// Unix time in milliseconds, if the clock was synchronized since the last
+  /// call. None otherwise, never blocks
+  auto synchronized() const noexcept -> std::optional<uint64_t>;
+};
+
+extern Sntp sntp;
+} // namespace driver
+
+#endif
@@ -13,6 +13,7 @@ class __FlashStringHelper;
 #define strstr_P(a, b) strstr(a, b)
 #define strlen_P(a) strlen(a)
 #define memmove_P(dest, orig, len) memmove((void *) dest, (const void *) orig, len)
+#define memcpy_P memcpy
 #define strcmp_P(a, b) strcmp(a, b)
 #else
 #include "WString.h"
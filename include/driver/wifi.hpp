@@ -32,6 +32,10 @@ class IPAddress {
     public:
         // Constructors
         IPAddress(uint8_t first_octet, uint8_t second_octet, uint8_t third_octet, uint8_t fourth_octet): octets{first_octet, second_octet, third_octet, fourth_octet} {}
+
+        std::string toString() const {
+            return std::to_string(octets[0]) + "." + std::to_string(octets[1]) + "." + std::to_string(octets[2]) + "." + std::to_string(octets[3]);
+        }
 };
 
 class WifiCredentials;
@@ -83,14 +87,17 @@ public:
     (void)subnet;
   }
 
-  std::string localIP() {
-    return std::string("192.168.0.1"));
+  IPAddress localIP() {
+    return IPAddress(192, 168, 0, 1);
   }
 
-  std::string softAPIP() {
-    return std::string("127.0.0.1"));
+  IPAddress softAPIP() {
+    return IPAddress(127, 0, 0, 1);
   }
 };
+
+/// Stands for ESP8266's global `WiFi`, the station is always connected
+extern Wifi WiFi;
 #else
 #include "ESP8266WiFi.h"
 #endif
@@ -0,0 +1,48 @@
+#ifndef IOP_EVENT_ENCODING_HPP
+#define IOP_EVENT_ENCODING_HPP
+
+#include "sensors.hpp"
+#include "core/utils.hpp"
+#include <array>
+#include <stdint.h>
+
+// Versioned packed encoding, documented at docs/EVENTS.md. The event layout is
+// generated from the sensors list, so it's identified by a fingerprint
+constexpr static uint8_t binaryEventSchema = 5;
+constexpr static size_t binaryHeaderSize = 4; // Schema + layout + event count
+
+constexpr static auto binaryFieldSize(const sensor::FieldType type) noexcept -> size_t {
+  return type == sensor::FieldType::UINT16 ? sizeof(uint16_t) : sizeof(float);
+}
+
+constexpr static auto binaryEventLayoutSize() noexcept -> size_t {
+  size_t size = sizeof(uint16_t) + sizeof(uint32_t); // acquisition_millis + captured_at
+  for (const auto &field: eventFields)
+    size += field.capacity * binaryFieldSize(field.type);
+  return size;
+}
+
+/// FNV-1a of the field names, types and capacities, folded to 16 bits
+constexpr static auto binaryEventLayout() noexcept -> uint16_t {
+  uint32_t hash = 2166136261U;
+  const auto mix = [&hash](const uint8_t byte) {
+    hash = (hash ^ byte) * 16777619U;
+  };
+  for (const auto &field: eventFields) {
+    for (const char *ch = field.name; *ch != '\0'; ++ch) // NOLINT *-pro-bounds-pointer-arithmetic
+      mix(static_cast<uint8_t>(*ch));
+    mix(static_cast<uint8_t>(field.type));
+    mix(field.capacity);
+  }
+  return static_cast<uint16_t>((hash >> 16) ^ (hash & 0xFFFF));
+}
+
+constexpr static size_t binaryEventSize = binaryEventLayoutSize();
+constexpr static uint16_t binaryEventLayoutId = binaryEventLayout();
+
+/// Writes the header and `events` to `buffer`, returns the payload's length.
+/// They must fit it, at most `(buffer.size() - binaryHeaderSize) / binaryEventSize`
+/// events (and `UINT8_MAX`)
+auto encodeEvents(iop::Span<const Event> events, std::array<char, 1024> &buffer) noexcept -> size_t;
+
+#endif
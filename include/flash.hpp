@@ -2,6 +2,7 @@
 #define IOP_FLASH_HPP
 
 #include "core/log.hpp"
+#include "sensors.hpp"
 #include "utils.hpp"
 #include <optional>
 
@@ -26,6 +27,21 @@ public:
   void removeWifiConfig() const noexcept;
   void writeWifiConfig(const WifiCredentials &config) const noexcept;
 
+  /// Store-and-forward queue for measurements that couldn't be uploaded.
+  ///
+  /// It's a bounded ring of `config::eventQueueCapacity` events, stored after
+  /// the credentials. When full the oldest event is overwritten, and counted
+  /// in `droppedEvents`. On desktop it only lives in RAM.
+  void enqueueEvent(const Event &event) const noexcept;
+  auto oldestEvent() const noexcept -> std::optional<Event>;
+  /// Index 0 is the oldest event
+  auto queuedEvent(uint16_t index) const noexcept -> std::optional<Event>;
+  void dequeueEvent() const noexcept;
+  /// Removes the `count` oldest events
+  void dequeueEvents(uint16_t count) const noexcept;
+  auto queuedEvents() const noexcept -> uint16_t;
+  auto droppedEvents() const noexcept -> uint32_t;
+
   ~Flash() { IOP_TRACE(); }
   Flash(Flash const &other) noexcept = default;
   Flash(Flash &&other) noexcept = default;
@@ -16,6 +16,9 @@
 #undef LED_BUILTIN
 #endif
 
+#include "aggregator.hpp"
+#include "report.hpp"
+#include "clock.hpp"
 #include "configuration.hpp"
 #include "flash.hpp"
 #include "sensors.hpp"
@@ -37,6 +40,8 @@ private:
   Sensors sensors;
 
   iop::esp_time nextMeasurement;
+  iop::esp_time nextSummary;
+  iop::esp_time nextQueuedEvent;
   iop::esp_time nextYieldLog;
   iop::esp_time nextHandleConnectionLost;
 
@@ -49,7 +54,9 @@ public:
 private:
   void handleInterrupt(const InterruptEvent event, const std::optional<AuthToken> &maybeToken) const noexcept;
   void handleCredentials() noexcept;
-  void handleMeasurements(const AuthToken &token) noexcept;
+  void handleMeasurements(const AuthToken &token, iop::esp_time now) noexcept;
+  void handleQueuedEvents(const AuthToken &token, iop::esp_time now) noexcept;
+  void handleOutbound(const AuthToken &token) noexcept;
 
 public:
   auto operator=(EventLoop const &other) noexcept -> EventLoop & {
@@ -63,6 +70,8 @@ public:
     this->logger = other.logger;
     this->flash_ = other.flash_;
     this->nextMeasurement = other.nextMeasurement;
+    this->nextSummary = other.nextSummary;
+    this->nextQueuedEvent = other.nextQueuedEvent;
     this->nextYieldLog = other.nextYieldLog;
     this->nextHandleConnectionLost = other.nextHandleConnectionLost;
     return *this;
@@ -75,6 +84,8 @@ public:
     this->logger = other.logger;
     this->flash_ = other.flash_;
     this->nextMeasurement = other.nextMeasurement;
+    this->nextSummary = other.nextSummary;
+    this->nextQueuedEvent = other.nextQueuedEvent;
     this->nextYieldLog = other.nextYieldLog;
     this->nextHandleConnectionLost = other.nextHandleConnectionLost;
     return *this;
@@ -84,8 +95,8 @@ public:
       : credentialsServer(logLevel_),
         api_(std::move(uri), logLevel_),
         logger(logLevel_, F("LOOP")), flash_(logLevel_),
-        sensors(config::soilResistivityPower, config::soilTemperature, config::airTempAndHumidity, config::dhtVersion),
-        nextMeasurement(0), nextYieldLog(0), nextHandleConnectionLost(0) {
+        sensors(),
+        nextMeasurement(0), nextSummary(0), nextQueuedEvent(0), nextYieldLog(0), nextHandleConnectionLost(0) {
     IOP_TRACE();
   }
   EventLoop(EventLoop const &other) noexcept
@@ -95,6 +106,8 @@ public:
         flash_(other.flash_),
         sensors(other.sensors),
         nextMeasurement(other.nextMeasurement),
+        nextSummary(other.nextSummary),
+        nextQueuedEvent(other.nextQueuedEvent),
         nextYieldLog(other.nextYieldLog),
         nextHandleConnectionLost(other.nextHandleConnectionLost) {
     IOP_TRACE();
@@ -103,6 +116,8 @@ public:
       : credentialsServer(other.credentialsServer), api_(other.api_),
         logger(other.logger), flash_(other.flash_), sensors(other.sensors),
         nextMeasurement(other.nextMeasurement),
+        nextSummary(other.nextSummary),
+        nextQueuedEvent(other.nextQueuedEvent),
         nextYieldLog(other.nextYieldLog),
         nextHandleConnectionLost(other.nextHandleConnectionLost) {
     IOP_TRACE();
@@ -139,12 +154,23 @@ class Unused4KbSysStack {
   static_assert(sizeof(StackStruct) <= 4096);
 
 public:
+#ifdef IOP_DESKTOP
+  // There is no unused system stack on desktop, so it's static memory instead
+  alignas(StackStruct) static inline std::array<uint8_t, 4096> desktopStack = {};
+  Unused4KbSysStack() noexcept: data(reinterpret_cast<StackStruct *>(desktopStack.data())) {
+    memset(desktopStack.data(), 0, desktopStack.size());
+  }
+  void reset() noexcept {
+    memset(desktopStack.data(), 0, desktopStack.size());
+  }
+#else
   Unused4KbSysStack() noexcept: data(reinterpret_cast<StackStruct *>(0x3FFFE000)) {
     memset((void*)0x3FFFE000, 0, 4096);
   }
   void reset() noexcept {
     memset((void*)0x3FFFE000, 0, 4096);
   }
+#endif
   auto response() noexcept -> std::variant<iop::Response, int> & {
     if (!this->data->response.has_value())
       this->data->response = std::make_optional(0);
@@ -189,6 +215,16 @@ public:
       this->data->updater = std::make_optional(ESP8266HTTPUpdate());
     return iop::unwrap_mut(this->data->updater, IOP_CTX());
   }
+  #else
+  // Desktop's client allocates freely, so it lives outside of the stack
+  auto client() noexcept -> WiFiClient & {
+    static WiFiClient client;
+    return client;
+  }
+  auto http() noexcept -> HTTPClient & {
+    static HTTPClient http;
+    return http;
+  }
   #endif
   auto mac() noexcept -> std::array<char, 17> & {
     return this->data->mac;
@@ -0,0 +1,82 @@
+#ifndef IOP_OUTBOUND_HPP
+#define IOP_OUTBOUND_HPP
+
+#include <array>
+#include <optional>
+#include <stdint.h>
+#include <string_view>
+
+/// Kinds of requests waiting to be sent, in priority order. Authentication and
+/// events aren't queued, as their callers need the results, `EventLoop::loop`
+/// sends them between both kinds
+enum class OutboundKind : uint8_t {
+  PANIC = 0,
+  LOG,
+};
+
+/// A request waiting to be sent. `payload` views the queue's storage, so it's
+/// only valid until the queue changes
+struct Outbound {
+  uint32_t id;
+  OutboundKind kind;
+  std::string_view payload;
+};
+
+/// Requests waiting to be sent, highest priority first (oldest first among the
+/// same kind). Payloads live in a fixed buffer, so memory is bounded.
+///
+/// Requests of the same kind are coalesced into one: logs are concatenated and
+/// repeated panics dropped. When full, lower priority requests are evicted,
+/// newest first, to make room for higher priority ones
+class OutboundQueue {
+public:
+  constexpr static uint16_t capacity = 768;
+  constexpr static uint8_t maxRequests = 8;
+
+private:
+  struct Entry {
+    uint32_t id;
+    OutboundKind kind;
+    uint16_t offset;
+    uint16_t length;
+    /// Returned by `front`, so it may be being sent and can't grow anymore
+    bool sealed;
+  };
+
+  std::array<char, capacity> buffer;
+  /// Ordered by offset, so the buffer is always compact
+  std::array<Entry, maxRequests> entries;
+  uint8_t count;
+  uint16_t used;
+  uint32_t nextId;
+  uint32_t dropped_;
+
+public:
+  OutboundQueue() noexcept;
+
+  /// False if it doesn't fit, even after evicting lower priority requests
+  auto push(OutboundKind kind, std::string_view payload) noexcept -> bool;
+  /// The request to send next. It won't be coalesced anymore
+  auto front() noexcept -> std::optional<Outbound>;
+  auto nextKind() const noexcept -> std::optional<OutboundKind>;
+  /// Removes by id, as requests may be pushed (or coalesced) while one is sent.
+  /// False if it was already evicted
+  auto remove(uint32_t id) noexcept -> bool;
+
+  auto isEmpty() const noexcept -> bool { return this->count == 0; }
+  auto size() const noexcept -> uint8_t { return this->count; }
+  auto bytes() const noexcept -> uint16_t { return this->used; }
+  /// Requests that didn't fit, or were evicted, since boot
+  auto dropped() const noexcept -> uint32_t { return this->dropped_; }
+
+private:
+  auto coalesce(OutboundKind kind, std::string_view payload) noexcept -> bool;
+  /// Grows the newest request
+  void append(std::string_view payload) noexcept;
+  auto frontIndex() const noexcept -> std::optional<uint8_t>;
+  auto evictFor(OutboundKind kind, size_t length) noexcept -> bool;
+  void erase(uint8_t index) noexcept;
+  auto view(const Entry &entry) const noexcept -> std::string_view;
+};
+
+#endif
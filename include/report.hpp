@@ -0,0 +1,35 @@
+#ifndef IOP_REPORT_HPP
+#define IOP_REPORT_HPP
+
+#include "aggregator.hpp"
+#include "driver/thread.hpp"
+#include "utils.hpp"
+#include <optional>
+
+/// How many summaries were sent and how many were suppressed because nothing
+/// relevant changed, since boot
+struct ReportCounters {
+  uint32_t sent;
+  uint32_t suppressed;
+};
+
+/// Decides if a summary is worth sending. In stable conditions readings only
+/// move within sensor noise, so they are suppressed until some field leaves
+/// its deadband (`sensor::Field::deadband`) or `config::reportHeartbeat` expires
+class ReportPolicy {
+  /// Averages of the last summary sent, fields are compared against it
+  std::optional<Event> reference;
+  iop::esp_time lastReport;
+  ReportCounters counters_;
+
+public:
+  ReportPolicy() noexcept;
+
+  auto shouldReport(const Summary &summary, iop::esp_time now) const noexcept -> bool;
+  /// `mean` becomes the reference for the next summaries
+  void reported(const Event &mean, iop::esp_time now) noexcept;
+  void suppressed() noexcept;
+  auto counters() const noexcept -> ReportCounters;
+};
+
+#endif
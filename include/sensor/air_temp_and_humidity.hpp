@@ -0,0 +1,48 @@
+#ifndef IOP_SENSOR_AIR_TEMP_AND_HUMIDITY_HPP
+#define IOP_SENSOR_AIR_TEMP_AND_HUMIDITY_HPP
+
+#include "configuration.hpp"
+#include "driver/sensors.hpp"
+#include "sensor/field.hpp"
+#include <array>
+
+namespace sensor {
+/// DHT family (DHT11, DHT21, DHT22...), measures air temperature and humidity
+template <gpio::Pin pin, uint8_t version>
+class AirTempAndHumidity {
+  DHT dht;
+
+public:
+  constexpr static std::array<Field, 3> fields = {{
+    { "air_temperature_celsius", FieldType::FLOAT32, 1, config::airTemperatureDeadbandCelsius, 0 },
+    { "air_humidity_percentage", FieldType::FLOAT32, 1, config::airHumidityDeadbandPercentage, 0 },
+    { "air_heat_index_celsius", FieldType::FLOAT32, 1, config::airHeatIndexDeadbandCelsius, 0 },
+  }};
+  /// DHT reads are synchronous, but each one is bounded by the sensor
+  constexpr static iop::esp_time budgetMillis = 250;
+
+  AirTempAndHumidity() noexcept: dht(static_cast<uint8_t>(pin), version) {
+    IOP_TRACE();
+  }
+
+  void setup() noexcept {
+    IOP_TRACE();
+    this->dht.begin();
+  }
+
+  void start() noexcept {
+    IOP_TRACE();
+  }
+
+  auto poll(const iop::esp_time elapsed, const iop::Span<float> values) noexcept -> bool {
+    IOP_TRACE();
+    (void)elapsed;
+    values[0] = this->dht.readTemperature();
+    values[1] = this->dht.readHumidity();
+    values[2] = this->dht.computeHeatIndex(false);
+    return true;
+  }
+};
+} // namespace sensor
+
+#endif
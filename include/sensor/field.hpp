@@ -0,0 +1,25 @@
+#ifndef IOP_SENSOR_FIELD_HPP
+#define IOP_SENSOR_FIELD_HPP
+
+#include <cstdint>
+
+namespace sensor {
+/// How a value is encoded in binary payloads, values are always `float` in RAM
+enum class FieldType : uint8_t { FLOAT32, UINT16 };
+
+/// Describes a value measured by a sensor. The event layout, its serializers,
+/// the aggregation and the report policy are generated from these
+struct Field {
+  /// Key used in JSON payloads
+  const char *name;
+  FieldType type;
+  /// Fields bigger than 1 are arrays, missing values are NaN
+  uint8_t capacity;
+  /// Changes smaller than this are considered noise, see `ReportPolicy`
+  float deadband;
+  /// Index of the first value in `EventStorage::values`, filled by `SensorRegistry`
+  uint8_t offset;
+};
+} // namespace sensor
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef IOP_SENSOR_REGISTRY_HPP
+#define IOP_SENSOR_REGISTRY_HPP
+
+#include "core/log.hpp"
+#include "core/utils.hpp"
+#include "driver/thread.hpp"
+#include "sensor/field.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+namespace sensor {
+/// How many values a sensor fills, the sum of its fields' capacities
+template <size_t N>
+constexpr auto channelsOf(const std::array<Field, N> &fields) noexcept -> uint8_t {
+  uint8_t channels = 0;
+  for (const auto &field: fields)
+    channels += field.capacity;
+  return channels;
+}
+
+template <size_t N, size_t M>
+constexpr void appendFields(std::array<Field, N> &result, size_t &index,
+                            uint8_t &offset, const std::array<Field, M> &fields) noexcept {
+  for (auto field: fields) {
+    field.offset = offset;
+    offset += field.capacity;
+    result[index++] = field;
+  }
+}
+
+/// Fields of every sensor, in order, with their offsets in the event
+template <typename... Sensors>
+constexpr auto concatenateFields() noexcept -> std::array<Field, (Sensors::fields.size() + ... + 0)> {
+  std::array<Field, (Sensors::fields.size() + ... + 0)> result{};
+  size_t index = 0;
+  uint8_t offset = 0;
+  (appendFields(result, index, offset, Sensors::fields), ...);
+  (void)index;
+  (void)offset;
+  return result;
+}
+
+/// Index of the first value of each sensor in the event
+template <typename... Sensors>
+constexpr auto sensorOffsets() noexcept -> std::array<uint8_t, sizeof...(Sensors)> {
+  std::array<uint8_t, sizeof...(Sensors)> result{};
+  const std::array<uint8_t, sizeof...(Sensors)> channels = {channelsOf(Sensors::fields)...};
+  uint8_t offset = 0;
+  for (size_t index = 0; index < channels.size(); ++index) {
+    result[index] = offset;
+    offset += channels[index];
+  }
+  return result;
+}
+
+/// Compile-time list of the sensors connected to the device. The event layout
+/// (`Reading`) and the field table used by the serializers are generated from
+/// it, so sensors that aren't listed cost no flash nor RAM.
+///
+/// Every sensor type must provide:
+///
+/// - `constexpr static std::array<Field, N> fields`, offsets are left as 0
+/// - `constexpr static iop::esp_time budgetMillis`, its worst-case latency
+/// - `void setup() noexcept`
+/// - `void start() noexcept`, begins a measurement
+/// - `auto poll(iop::esp_time elapsed, iop::Span<float> values) noexcept -> bool`,
+///   never blocks. Fills `values` (one per field slot) and returns true when done
+///
+/// All sensors are sampled at the same time, so a measurement takes as long as
+/// the slowest one, not the sum of them.
+template <typename... Sensors>
+class SensorRegistry {
+  static_assert(sizeof...(Sensors) < 32, "Pending sensors are tracked by a 32 bits mask");
+
+public:
+  constexpr static auto fields = concatenateFields<Sensors...>();
+  constexpr static uint8_t channels = (channelsOf(Sensors::fields) + ... + 0);
+  constexpr static iop::esp_time acquisitionBudgetMillis = std::max({static_cast<iop::esp_time>(0), Sensors::budgetMillis...});
+
+  /// Generated event layout. It's trivially copyable, so it can be stored in flash
+  struct Reading {
+    std::array<float, channels> values;
+    /// Unix time (in seconds) when the measurement started, 0 if unknown.
+    /// Sensors don't know the time, so the caller fills it (check `Clock`)
+    uint32_t capturedAt;
+    /// How long the sensors took to collect this event
+    uint16_t acquisitionMillis;
+  };
+
+private:
+  constexpr static auto offsets = sensorOffsets<Sensors...>();
+
+  std::tuple<Sensors...> sensors;
+  bool measuring;
+  /// Bitflags of the sensors that still have to finish the current measurement
+  uint32_t pending;
+  iop::esp_time measurementStart;
+  Reading reading;
+
+public:
+  SensorRegistry() noexcept: sensors(), measuring(false), pending(0), measurementStart(0), reading() {
+    IOP_TRACE();
+  }
+
+  void setup() noexcept {
+    IOP_TRACE();
+    std::apply([](auto &...sensor) { (sensor.setup(), ...); }, this->sensors);
+  }
+
+  /// Begins a new measurement, noop if one is already running
+  void start() noexcept {
+    IOP_TRACE();
+    if (this->measuring)
+      return;
+
+    this->measuring = true;
+    this->reading.values.fill(NAN);
+    this->reading.capturedAt = 0;
+    this->pending = (1UL << sizeof...(Sensors)) - 1;
+    this->measurementStart = driver::thisThread.now();
+    std::apply([](auto &...sensor) { (sensor.start(), ...); }, this->sensors);
+  }
+
+  /// Advances the measurement started by `start`, never blocks. Returns the
+  /// reading once every sensor finishes, None otherwise
+  auto poll() noexcept -> std::optional<Reading> {
+    IOP_TRACE();
+    if (!this->measuring)
+      return std::nullopt;
+
+    // Unsigned subtraction handles `millis()` overflow
+    const auto elapsed = driver::thisThread.now() - this->measurementStart;
+    this->pollEach(elapsed, std::index_sequence_for<Sensors...>());
+    if (this->pending != 0)
+      return std::nullopt;
+
+    this->measuring = false;
+    const auto total = driver::thisThread.now() - this->measurementStart;
+    this->reading.acquisitionMillis = static_cast<uint16_t>(std::min<iop::esp_time>(total, UINT16_MAX));
+    return this->reading;
+  }
+
+  auto isMeasuring() const noexcept -> bool {
+    IOP_TRACE();
+    return this->measuring;
+  }
+
+private:
+  template <size_t... Index>
+  void pollEach(const iop::esp_time elapsed, std::index_sequence<Index...>) noexcept {
+    (this->pollSensor<Index>(elapsed), ...);
+    (void)elapsed;
+  }
+
+  template <size_t Index>
+  void pollSensor(const iop::esp_time elapsed) noexcept {
+    constexpr uint32_t bit = 1UL << Index;
+    if ((this->pending & bit) == 0)
+      return;
+
+    using Sensor = std::tuple_element_t<Index, std::tuple<Sensors...>>;
+    // NOLINTNEXTLINE *-pro-bounds-pointer-arithmetic
+    const auto values = iop::Span<float>(this->reading.values.data() + std::get<Index>(offsets), channelsOf(Sensor::fields));
+    if (std::get<Index>(this->sensors).poll(elapsed, values))
+      this->pending &= ~bit;
+  }
+};
+} // namespace sensor
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef IOP_SENSOR_SIMULATED_HPP
+#define IOP_SENSOR_SIMULATED_HPP
+
+#include "configuration.hpp"
+#include "driver/simulator.hpp"
+#include "sensor/registry.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace sensor {
+/// Synthetic time series of each known field. Unknown fields are flat and noisy
+inline auto simulationOf(const char *field) noexcept -> driver::SeriesProfile {
+  IOP_TRACE();
+  auto profile = (driver::SeriesProfile){};
+  profile.dayMillis = config::simulatorDayMillis;
+  profile.failureProbability = config::simulatorFailureProbability;
+  profile.stuckProbability = config::simulatorStuckProbability;
+  profile.stuckSamples = config::simulatorStuckSamples;
+  profile.noise = 0.1F;
+  profile.min = -INFINITY;
+  profile.max = INFINITY;
+
+  if (strcmp(field, "air_temperature_celsius") == 0) {
+    profile.mean = 24;
+    profile.amplitude = 6;
+    profile.noise = 0.2F;
+  } else if (strcmp(field, "air_humidity_percentage") == 0) {
+    // Drier at noon, slowly drying over the days
+    profile.mean = 65;
+    profile.amplitude = -15;
+    profile.driftPerDay = -1;
+    profile.noise = 1;
+    profile.min = 0;
+    profile.max = 100;
+  } else if (strcmp(field, "air_heat_index_celsius") == 0) {
+    profile.mean = 25;
+    profile.amplitude = 7;
+    profile.noise = 0.3F;
+  } else if (strcmp(field, "soil_temperatures_celsius") == 0) {
+    profile.mean = 21;
+    profile.amplitude = 2;
+  } else if (strcmp(field, "soil_resistivity_raw") == 0) {
+    // Resistivity grows as the soil dries
+    profile.mean = 700;
+    profile.driftPerDay = 20;
+    profile.noise = 5;
+    profile.min = 0;
+    profile.max = 1023;
+  }
+  return profile;
+}
+
+/// Stands in for `Sensor` on desktop: same fields and latency budget, but the
+/// values come from deterministic synthetic time series (`driver::Series`)
+/// seeded by `config::simulatorSeed`
+template <typename Sensor>
+class Simulated {
+  constexpr static uint8_t channels = channelsOf(Sensor::fields);
+  std::array<driver::Series, channels> series;
+
+public:
+  constexpr static auto fields = Sensor::fields;
+  constexpr static iop::esp_time budgetMillis = Sensor::budgetMillis;
+
+  Simulated() noexcept: series() {
+    IOP_TRACE();
+    uint8_t channel = 0;
+    for (const auto &field: fields) {
+      for (uint8_t slot = 0; slot < field.capacity; ++slot) {
+        this->series[channel] = driver::Series(simulationOf(field.name), seedOf(field.name, slot));
+        channel++;
+      }
+    }
+  }
+
+  void setup() noexcept { IOP_TRACE(); }
+  void start() noexcept { IOP_TRACE(); }
+
+  /// Takes as long as the real sensor's worst case
+  auto poll(const iop::esp_time elapsed, const iop::Span<float> values) noexcept -> bool {
+    IOP_TRACE();
+    if (elapsed < budgetMillis)
+      return false;
+
+    const auto now = driver::thisThread.now();
+    uint8_t channel = 0;
+    for (const auto &field: fields) {
+      for (uint8_t slot = 0; slot < field.capacity; ++slot) {
+        auto value = this->series[channel].sample(now);
+        if (field.type == FieldType::UINT16)
+          value = std::round(value);
+        values[channel] = value;
+        channel++;
+      }
+    }
+    return true;
+  }
+
+private:
+  /// FNV-1a of the field name, so the series don't depend on the sensors' order
+  static auto seedOf(const char *field, const uint8_t slot) noexcept -> uint32_t {
+    uint32_t hash = 2166136261UL ^ config::simulatorSeed;
+    for (; *field != '\0'; ++field) { // NOLINT *-pro-bounds-pointer-arithmetic
+      hash ^= static_cast<uint8_t>(*field);
+      hash *= 16777619UL;
+    }
+    hash ^= slot;
+    hash *= 16777619UL;
+    return hash;
+  }
+};
+} // namespace sensor
+
+#endif
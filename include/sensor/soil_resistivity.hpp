@@ -0,0 +1,61 @@
+#ifndef IOP_SENSOR_SOIL_RESISTIVITY_HPP
+#define IOP_SENSOR_SOIL_RESISTIVITY_HPP
+
+#include "configuration.hpp"
+#include "driver/gpio.hpp"
+#include "sensor/field.hpp"
+#include <array>
+
+namespace sensor {
+/// Resistive soil probe (FC28 + LM393) connected to A0, `power` feeds it only
+/// while measuring to slow down the electrodes' corrosion
+template <gpio::Pin power>
+class SoilResistivity {
+  uint32_t sum;
+  uint8_t samples;
+
+public:
+  /// Probe must be powered for a while before its readings become stable
+  constexpr static iop::esp_time settleMillis = 2000;
+  constexpr static iop::esp_time sampleIntervalMillis = 500;
+  constexpr static uint8_t sampleCount = 3;
+
+  constexpr static std::array<Field, 1> fields = {{
+    { "soil_resistivity_raw", FieldType::UINT16, 1, config::soilResistivityDeadbandRaw, 0 },
+  }};
+  constexpr static iop::esp_time budgetMillis = settleMillis + (sampleCount - 1) * sampleIntervalMillis;
+
+  SoilResistivity() noexcept: sum(0), samples(0) {
+    IOP_TRACE();
+  }
+
+  void setup() noexcept {
+    IOP_TRACE();
+    gpio::gpio.mode(power, gpio::Mode::OUTPUT);
+  }
+
+  void start() noexcept {
+    IOP_TRACE();
+    this->sum = 0;
+    this->samples = 0;
+    gpio::gpio.digitalWrite(power, gpio::Data::HIGH);
+  }
+
+  auto poll(const iop::esp_time elapsed, const iop::Span<float> values) noexcept -> bool {
+    IOP_TRACE();
+    if (elapsed < settleMillis + this->samples * sampleIntervalMillis)
+      return false;
+
+    this->sum += gpio::gpio.analogRead();
+    this->samples++;
+    if (this->samples < sampleCount)
+      return false;
+
+    gpio::gpio.digitalWrite(power, gpio::Data::LOW);
+    values[0] = static_cast<float>(this->sum / this->samples);
+    return true;
+  }
+};
+} // namespace sensor
+
+#endif
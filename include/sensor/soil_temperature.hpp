@@ -0,0 +1,89 @@
+#ifndef IOP_SENSOR_SOIL_TEMPERATURE_HPP
+#define IOP_SENSOR_SOIL_TEMPERATURE_HPP
+
+#include "configuration.hpp"
+#include "driver/sensors.hpp"
+#include "sensor/field.hpp"
+#include <array>
+#include <cmath>
+
+namespace sensor {
+/// DS18B20 probes sharing a OneWire bus, up to `maxProbes` are read
+template <gpio::Pin pin, uint8_t maxProbes = 4>
+class SoilTemperature {
+  DallasTemperature sensor;
+  /// ROM addresses of the probes on the bus, found at setup so reads don't
+  /// enumerate the bus every time
+  std::array<std::array<uint8_t, 8>, maxProbes> addresses;
+  uint8_t probes;
+  /// Set when a probe fails to answer, the bus is scanned again before the
+  /// next measurement
+  bool rescan;
+
+public:
+  /// Probes that didn't answer are NaN
+  constexpr static std::array<Field, 1> fields = {{
+    { "soil_temperatures_celsius", FieldType::FLOAT32, maxProbes, config::soilTemperatureDeadbandCelsius, 0 },
+  }};
+  /// Conversion at 12 bits, if it doesn't finish in time it's read anyway
+  constexpr static iop::esp_time budgetMillis = 750;
+
+  SoilTemperature() noexcept: sensor(), addresses(), probes(0), rescan(false) {
+    IOP_TRACE();
+    // DallasTemperature keeps a pointer to the bus, so it must outlive it
+    static OneWire oneWire(static_cast<uint8_t>(pin));
+    this->sensor = DallasTemperature(&oneWire);
+  }
+
+  void setup() noexcept {
+    IOP_TRACE();
+    this->scan();
+    // Conversions are started by `start` and checked by `poll`
+    this->sensor.setWaitForConversion(false);
+  }
+
+  void start() noexcept {
+    IOP_TRACE();
+    if (this->rescan)
+      this->scan();
+    this->sensor.requestTemperatures();
+  }
+
+  auto poll(const iop::esp_time elapsed, const iop::Span<float> values) noexcept -> bool {
+    IOP_TRACE();
+    // If the conversion doesn't complete in its budget we read anyway, so a
+    // broken probe can't stall the measurements
+    if (!this->sensor.isConversionComplete() && elapsed < budgetMillis)
+      return false;
+
+    for (uint8_t index = 0; index < this->probes; ++index) {
+      const auto celsius = this->sensor.getTempC(this->addresses.at(index).data());
+      if (celsius == DEVICE_DISCONNECTED_C) {
+        this->rescan = true;
+        continue;
+      }
+      values[index] = celsius;
+    }
+    return true;
+  }
+
+private:
+  /// Enumerates the bus, it's slow so we only do it at setup or if a probe fails
+  void scan() noexcept {
+    IOP_TRACE();
+    this->sensor.begin();
+    this->probes = 0;
+
+    const auto found = this->sensor.getDeviceCount();
+    for (uint8_t index = 0; index < found && this->probes < maxProbes; ++index) {
+      if (this->sensor.getAddress(this->addresses.at(this->probes).data(), index))
+        this->probes++;
+    }
+
+    // Without probes there is nothing to cache, so we keep looking for them
+    this->rescan = this->probes == 0;
+  }
+};
+} // namespace sensor
+
+#endif
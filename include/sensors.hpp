@@ -1,72 +1,60 @@
 #ifndef IOP_SENSORS_HPP
 #define IOP_SENSORS_HPP
 
+#include "configuration.hpp"
 #include "utils.hpp"
-#include <memory>
-#include "driver/sensors.hpp"
+#include "sensor/registry.hpp"
+#include "sensor/air_temp_and_humidity.hpp"
+#include "sensor/soil_resistivity.hpp"
+#include "sensor/soil_temperature.hpp"
+#include "sensor/simulated.hpp"
 
-/// Abstracts away sensors access, providing a cohesive state. It's
-/// completely synchronous.
-class Sensors {
-#ifdef IOP_SENSORS
-  gpio::Pin soilResistivityPower;
-  // We use a shared_ptr because we have a self-reference to this and
-  // DallasTemperature only copies itself. So moving would mean
-  // 'soilTemperatureSensor' points to a unique_ptr that it doesn't own, so
-  // only copies are allowed. This is the simplest way. UNSAFE: SELF_REF
-  //std::shared_ptr<OneWire> soilTemperatureOneWireBus;
-  DallasTemperature soilTemperatureSensor;
-  DHT airTempAndHumiditySensor;
+/// Sensors connected to this device. New hardware only needs a type in
+/// `include/sensor` (check `sensor::SensorRegistry`) and an entry here, events
+/// and their serializers are generated from this list. Desktop builds simulate
+/// them (check `sensor::Simulated`)
+#if defined(IOP_SENSORS) && defined(IOP_DESKTOP)
+using Sensors = sensor::SensorRegistry<
+    sensor::Simulated<sensor::AirTempAndHumidity<config::airTempAndHumidity, config::dhtVersion>>,
+    sensor::Simulated<sensor::SoilResistivity<config::soilResistivityPower>>,
+    sensor::Simulated<sensor::SoilTemperature<config::soilTemperature>>>;
+#elif defined(IOP_SENSORS)
+using Sensors = sensor::SensorRegistry<
+    sensor::AirTempAndHumidity<config::airTempAndHumidity, config::dhtVersion>,
+    sensor::SoilResistivity<config::soilResistivityPower>,
+    sensor::SoilTemperature<config::soilTemperature>>;
+#else
+using Sensors = sensor::SensorRegistry<>;
 #endif
 
+/// Generated from the sensors list. Values are laid out as described by
+/// `eventFields`, missing readings are NaN
+using EventStorage = Sensors::Reading;
+constexpr static auto eventFields = Sensors::fields;
+constexpr static uint8_t eventChannels = Sensors::channels;
+
+class Event {
 public:
-  Sensors(const gpio::Pin soilResistivityPower,
-          const gpio::Pin soilTemperature, const gpio::Pin dht,
-          const uint8_t dhtVersion) noexcept
-#ifdef IOP_SENSORS
-      : soilResistivityPower(soilResistivityPower),
-        soilTemperatureSensor(),
-        airTempAndHumiditySensor(static_cast<uint8_t>(dht), dhtVersion) {
+  EventStorage storage;
+  ~Event() noexcept { IOP_TRACE(); }
+  Event() noexcept : storage{} { IOP_TRACE(); }
+  explicit Event(EventStorage storage) noexcept : storage(storage) {
     IOP_TRACE();
-    static OneWire oneWire(static_cast<uint8_t>(soilTemperature));
-    this->soilTemperatureSensor = DallasTemperature(&oneWire);
-#else
-{
-  IOP_TRACE();
-  (void) soilResistivityPower;
-  (void) soilTemperature;
-  (void) dht;
-  (void) dhtVersion;
-#endif
   }
-  void setup() noexcept;
-  auto measure() noexcept -> Event;
-  ~Sensors() noexcept { IOP_TRACE(); }
-
-  Sensors(Sensors const &other)
-#ifdef IOP_SENSORS
-      : soilResistivityPower(other.soilResistivityPower),
-        soilTemperatureOneWireBus(other.soilTemperatureOneWireBus),
-        soilTemperatureSensor(other.soilTemperatureSensor),
-        airTempAndHumiditySensor(other.airTempAndHumiditySensor)
-#endif
-  {
+  Event(Event const &ev) noexcept : storage(ev.storage) { IOP_TRACE(); }
+  Event(Event &&ev) noexcept : storage(ev.storage) { IOP_TRACE(); }
+  auto operator=(Event const &ev) noexcept -> Event & {
     IOP_TRACE();
+    if (this == &ev)
+      return *this;
+    this->storage = ev.storage;
+    return *this;
   }
-  Sensors(Sensors &&other) = delete;
-  auto operator=(Sensors const &other) -> Sensors & {
+  auto operator=(Event &&ev) noexcept -> Event & {
     IOP_TRACE();
-    if (this == &other)
-      return *this;
-#ifdef IOP_SENSORS
-    this->soilResistivityPower = other.soilResistivityPower;
-    this->soilTemperatureOneWireBus = other.soilTemperatureOneWireBus;
-    this->soilTemperatureSensor = other.soilTemperatureSensor;
-    this->airTempAndHumiditySensor = other.airTempAndHumiditySensor;
-#endif
+    this->storage = ev.storage;
     return *this;
   }
-  auto operator=(Sensors &&other) -> Sensors & = delete;
 };
 
-#endif
\ No newline at end of file
+#endif
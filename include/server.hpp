@@ -1,6 +1,7 @@
 #ifndef IOP_SERVER_HPP
 #define IOP_SERVER_HPP
 
+#include "core/network.hpp"
 #include "driver/server.hpp"
 #include "driver/wifi.hpp"
 #include "driver/thread.hpp"
@@ -40,9 +41,13 @@ private:
   /// Connects to WiFi
   auto connect(std::string_view ssid, std::string_view password) const noexcept
       -> void;
-  /// Uses IoP credentials to generate an authentication token for the device
-  auto authenticate(std::string_view username, std::string_view password,
-                    const Api &api) const noexcept -> std::optional<AuthToken>;
+  /// Starts generating an authentication token for the device with IoP
+  /// credentials, the captive portal keeps being served meanwhile
+  void authenticate(std::string_view username, std::string_view password,
+                    const Api &api) const noexcept;
+  /// Token generated by `authenticate`, once the server answers
+  auto authenticated(const Api &api) const noexcept -> std::optional<AuthToken>;
+  void authenticationFailed(iop::NetworkStatus status) const noexcept;
 
 public:
   explicit CredentialsServer(const iop::LogLevel &logLevel) noexcept
@@ -20,8 +20,10 @@
 #define IOP_NETWORK_LOGGING
 #endif
 
-// (Un)Comment this line to toggle sensors dependency
-#ifndef IOP_DESKTOP
+// (Un)Comment this line to toggle sensors dependency. On desktop they are simulated
+#ifdef IOP_DESKTOP
+#define IOP_SENSORS
+#else
 //#define IOP_SENSORS
 #endif
 
@@ -34,6 +36,10 @@
 // (Un)Comment this line to toggle over the air updates (OTA) dependency
 #define IOP_OTA
 
+// (Un)Comment this line to toggle the binary encoding for events (JSON is
+// still used as a fallback if the server doesn't support it)
+//#define IOP_BINARY_EVENTS
+
 // If IOP_MONITOR is not defined the Api methods will be short-circuited
 // If IOP_MOCK_MONITOR is defined, then the methods will run normally
 // and pretend the request didn't fail
@@ -104,35 +110,4 @@ public:
       -> WifiCredentials & = default;
 };
 
-struct EventStorage {
-  float airTemperatureCelsius;
-  float airHumidityPercentage;
-  float airHeatIndexCelsius;
-  uint16_t soilResistivityRaw;
-  float soilTemperatureCelsius;
-};
-
-class Event {
-public:
-  EventStorage storage;
-  ~Event() noexcept { IOP_TRACE(); }
-  explicit Event(EventStorage storage) noexcept : storage(storage) {
-    IOP_TRACE();
-  }
-  Event(Event const &ev) noexcept : storage(ev.storage) { IOP_TRACE(); }
-  Event(Event &&ev) noexcept : storage(ev.storage) { IOP_TRACE(); }
-  auto operator=(Event const &ev) noexcept -> Event & {
-    IOP_TRACE();
-    if (this == &ev)
-      return *this;
-    this->storage = ev.storage;
-    return *this;
-  }
-  auto operator=(Event &&ev) noexcept -> Event & {
-    IOP_TRACE();
-    this->storage = ev.storage;
-    return *this;
-  }
-};
-
 #endif
\ No newline at end of file
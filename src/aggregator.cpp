@@ -0,0 +1,79 @@
+#include "aggregator.hpp"
+#include <algorithm>
+#include <cmath>
+
+void FieldSummary::add(const float value) noexcept {
+  IOP_TRACE();
+  // Failed reads are NaN, they would poison every statistic
+  if (std::isnan(value))
+    return;
+
+  if (this->count == 0) {
+    this->min = value;
+    this->max = value;
+  } else {
+    this->min = std::min(this->min, value);
+    this->max = std::max(this->max, value);
+  }
+
+  this->count++;
+  const auto delta = value - this->mean;
+  this->mean += delta / static_cast<float>(this->count);
+  this->m2 += delta * (value - this->mean);
+}
+
+auto FieldSummary::variance() const noexcept -> float {
+  IOP_TRACE();
+  if (this->count == 0)
+    return 0;
+  return this->m2 / static_cast<float>(this->count);
+}
+
+Aggregator::Aggregator() noexcept: summary_((Summary){}) {
+  IOP_TRACE();
+}
+
+void Aggregator::add(const Event &event) noexcept {
+  IOP_TRACE();
+  auto &summary = this->summary_;
+
+  summary.samples++;
+  const auto capturedAt = event.storage.capturedAt;
+  if (capturedAt != 0) {
+    if (summary.from == 0)
+      summary.from = capturedAt;
+    summary.to = capturedAt;
+  }
+  for (uint8_t index = 0; index < eventChannels; ++index)
+    summary.channels.at(index).add(event.storage.values.at(index));
+  summary.acquisitionMillis.add(static_cast<float>(event.storage.acquisitionMillis));
+}
+
+auto Aggregator::summary() const noexcept -> const Summary & {
+  IOP_TRACE();
+  return this->summary_;
+}
+
+auto Aggregator::isEmpty() const noexcept -> bool {
+  IOP_TRACE();
+  return this->summary_.samples == 0;
+}
+
+void Aggregator::reset() noexcept {
+  IOP_TRACE();
+  this->summary_ = (Summary){};
+}
+
+auto Aggregator::mean() const noexcept -> Event {
+  IOP_TRACE();
+  const auto &summary = this->summary_;
+
+  auto storage = (EventStorage){};
+  for (uint8_t index = 0; index < eventChannels; ++index) {
+    const auto &channel = summary.channels.at(index);
+    storage.values.at(index) = channel.count ? channel.mean : NAN;
+  }
+  storage.acquisitionMillis = static_cast<uint16_t>(std::lround(summary.acquisitionMillis.mean));
+  storage.capturedAt = summary.from + (summary.to - summary.from) / 2;
+  return Event(storage);
+}
@@ -3,6 +3,8 @@
 #include "generated/certificates.hpp"
 #include "utils.hpp"
 #include <string>
+#include <algorithm>
+#include <cmath>
 #include "loop.hpp"
 #include "ArduinoJson.h"
 
@@ -13,8 +15,30 @@
 
 #include "driver/client.hpp"
 #include "driver/server.hpp"
+#include "core/upgrade.hpp"
+#include "event_encoding.hpp"
 #include "cont.h"
 
+// Lives in the BSS, so its memory is bounded and always available
+static OutboundQueue outbound;
+
+static auto pathOf(const OutboundKind kind) noexcept -> iop::StaticString {
+  switch (kind) {
+  case OutboundKind::PANIC:
+    return F("/v1/panic");
+  case OutboundKind::LOG:
+    return F("/v1/log");
+  }
+  return F("/v1/log");
+}
+
+static_assert(OutboundQueue::capacity <= 1024, "Queued requests must fit Api::makeJson's buffer");
+
+// Survives the deep sleep of `halt`, check `UpgradeAttempts`
+static iop::UpgradeAttempts upgradeAttempts(config::upgradeMaxAttempts);
+// After the TLS session, check `TlsSessionCache`
+constexpr static uint32_t upgradeRtcOffset = 64;
+
 auto Api::makeJson(const iop::StaticString name, const JsonCallback &func) const noexcept
     -> std::optional<std::reference_wrapper<std::array<char, 1024>>> {
   IOP_TRACE();
@@ -36,6 +60,132 @@ auto Api::makeJson(const iop::StaticString name, const JsonCallback &func) const
   return std::make_optional(std::ref(fixed));
 }
 
+/// How many values of the field are meaningful, trailing NaNs are omitted
+static auto fieldLength(const sensor::Field &field, const EventStorage &storage) noexcept -> uint8_t {
+  auto length = field.capacity;
+  while (length > 0 && std::isnan(storage.values.at(field.offset + length - 1)))
+    length--;
+  return length;
+}
+
+/// Failed readings (NaN) become null
+template <typename Slot>
+static void setJsonValue(Slot slot, const sensor::FieldType type, const float value) noexcept {
+  if (std::isnan(value)) {
+    slot.set(static_cast<const char *>(nullptr));
+  } else if (type == sensor::FieldType::UINT16) {
+    slot.set(static_cast<uint16_t>(value));
+  } else {
+    slot.set(value);
+  }
+}
+
+/// Unknown timestamps (0) are null, the server uses the time it arrived instead
+template <typename Slot>
+static void setJsonTimestamp(Slot slot, const uint32_t timestamp) noexcept {
+  if (timestamp == 0) {
+    slot.set(nullptr);
+  } else {
+    slot.set(timestamp);
+  }
+}
+
+static void fillEventJson(JsonObject obj, const Event &event) noexcept {
+  for (const auto &field: eventFields) {
+    if (field.capacity == 1) {
+      setJsonValue(obj[field.name], field.type, event.storage.values.at(field.offset));
+      continue;
+    }
+
+    auto array = obj.createNestedArray(field.name);
+    const auto length = fieldLength(field, event.storage);
+    for (uint8_t index = 0; index < length; ++index)
+      setJsonValue(array.addElement(), field.type, event.storage.values.at(field.offset + index));
+  }
+  obj["acquisition_millis"] = event.storage.acquisitionMillis;
+  setJsonTimestamp(obj["captured_at"], event.storage.capturedAt);
+}
+
+static void fillLoginJson(JsonDocument &doc, const std::string_view username, const std::string_view password) noexcept {
+  doc["email"] = username;
+  doc["password"] = password;
+}
+
+static void fillFieldSummaryJson(JsonObject obj, const FieldSummary &field) noexcept {
+  obj["n"] = field.count;
+  // Without samples the statistics are meaningless
+  if (field.count == 0)
+    return;
+  obj["min"] = field.min;
+  obj["max"] = field.max;
+  obj["mean"] = field.mean;
+  obj["var"] = field.variance();
+}
+
+static_assert(config::eventBatchPayloadBudget <= 1024, "Batch payload must fit Api::makeJson's buffer");
+
+auto Api::eventsFittingBatch(const iop::Span<const Event> events) const noexcept -> size_t {
+  IOP_TRACE();
+
+  auto &doc = unused4KbSysStack.json();
+  doc.clear();
+  auto array = doc.to<JsonArray>();
+
+  // Each event is measured once, the array adds its brackets and the commas
+  size_t size = 2;
+  size_t count = 0;
+  for (const auto &event: events) {
+    auto obj = array.createNestedObject();
+    fillEventJson(obj, event);
+    size += measureJson(obj) + (count > 0 ? 1 : 0);
+    // measureJson doesn't account for the null terminator
+    if (doc.overflowed() || size >= config::eventBatchPayloadBudget)
+      break;
+    count++;
+  }
+  return count;
+}
+
+#ifdef IOP_BINARY_EVENTS
+constexpr static size_t binaryEventsPerBatch =
+    std::min<size_t>(UINT8_MAX, (config::eventBatchPayloadBudget - binaryHeaderSize) / binaryEventSize);
+static_assert(binaryEventsPerBatch > 0, "A binary event doesn't fit the batch payload budget");
+
+// If the server answers 415 (Unsupported Media Type) we use JSON until reboot
+static bool binaryEventsRejected = false;
+
+auto Api::registerEventsBinary(const AuthToken &authToken, const iop::StaticString path,
+                               const iop::Span<const Event> events) const noexcept
+    -> std::optional<iop::NetworkStatus> {
+  IOP_TRACE();
+  iop_assert(events.size() <= binaryEventsPerBatch, F("Too many events for a binary payload"));
+
+  auto &buffer = unused4KbSysStack.text();
+  const auto length = encodeEvents(events, buffer);
+  const auto payload = std::string_view(buffer.data(), length);
+
+  const auto token = iop::to_view(authToken);
+  auto const & maybeResp = this->network().httpPost(token, path, payload, F("application/vnd.iop.events"));
+
+#ifndef IOP_MOCK_MONITOR
+  if (iop::is_err(maybeResp)) {
+    const auto code = iop::unwrap_err_ref(maybeResp, IOP_CTX());
+    if (code == HTTP_CODE_UNSUPPORTED_MEDIA_TYPE) {
+      this->logger.warn(F("Server doesn't support binary events, falling back to JSON"));
+      binaryEventsRejected = true;
+      return std::optional<iop::NetworkStatus>();
+    }
+
+    this->logger.error(F("Unexpected response at Api::registerEventsBinary: "), std::to_string(code));
+    return iop::NetworkStatus::BROKEN_SERVER;
+  }
+  return iop::unwrap_ok_ref(maybeResp, IOP_CTX()).status;
+#else
+  return iop::NetworkStatus::OK;
+#endif
+}
+#endif
+
 #ifdef IOP_ONLINE
 #ifndef IOP_DESKTOP
 static void upgradeScheduler() noexcept {
@@ -90,7 +240,9 @@ auto Api::reportPanic(const AuthToken &authToken,
     };
     maybeJson = this->makeJson(F("Api::reportPanic"), make);
 
-    if (!maybeJson.has_value()) {
+    // It's sent through the queue, so it must fit there too
+    if (!maybeJson.has_value() || strlen(maybeJson->get().data()) > OutboundQueue::capacity) {
+      maybeJson.reset();
       iop_assert(msg.length() / 2 != 0, F("Message would be empty, function is broken"));
       msg = msg.substr(0, msg.length() / 2);
       continue;
@@ -102,54 +254,137 @@ auto Api::reportPanic(const AuthToken &authToken,
     return iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW;
   const auto &json = iop::unwrap(maybeJson, IOP_CTX()).get();
 
+  // Panics have the highest priority, so it's sent right away, unless it's
+  // backing off. Then it stays queued and repeated reports are coalesced
+  if (!outbound.push(OutboundKind::PANIC, json.data()))
+    return iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW;
+  return this->drain(authToken).value_or(iop::NetworkStatus::CONNECTION_ISSUES);
+}
+
+auto Api::registerEvents(const AuthToken &authToken,
+                         const iop::Span<const Event> events) const noexcept
+    -> BatchStatus {
+  IOP_TRACE();
+  this->logger.debug(F("Send events: "), std::to_string(events.size()));
+
   const auto token = iop::to_view(authToken);
-  auto const & maybeResp = this->network().httpPost(token, F("/v1/panic"), json.data());
+  auto status = BatchStatus { iop::NetworkStatus::OK, 0 };
+  while (status.sent < events.size()) {
+// MQTT 3.1.1 has no content type, so the broker couldn't tell them apart
+#if defined(IOP_BINARY_EVENTS) && !defined(IOP_MQTT)
+    if (!binaryEventsRejected) {
+      const auto batch = events.subspan(status.sent, binaryEventsPerBatch);
+      const auto maybeStatus = this->registerEventsBinary(authToken, F("/v1/events"), batch);
+      if (maybeStatus.has_value()) {
+        status.status = iop::unwrap_ref(maybeStatus, IOP_CTX());
+        if (status.status != iop::NetworkStatus::OK)
+          return status;
+        status.sent += batch.size();
+        continue;
+      }
+    }
+#endif
 
-#ifndef IOP_MOCK_MONITOR
-  if (iop::is_err(maybeResp)) {
-    const auto code = std::to_string(iop::unwrap_err_ref(maybeResp, IOP_CTX()));
-    this->logger.error(F("Unexpected response at Api::reportPanic: "), code);
-    return iop::NetworkStatus::BROKEN_SERVER;
-  }
-  return iop::unwrap_ok_ref(maybeResp, IOP_CTX()).status;
+    const auto count = this->eventsFittingBatch(events.subspan(status.sent));
+    if (count == 0) {
+      this->logger.error(F("Event doesn't fit batch payload budget"));
+      status.status = iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW;
+      return status;
+    }
+
+    const auto batch = events.subspan(status.sent, count);
+    const auto make = [batch](JsonDocument &doc) {
+      auto array = doc.to<JsonArray>();
+      for (const auto &event: batch)
+        fillEventJson(array.createNestedObject(), event);
+    };
+    auto maybeJson = this->makeJson(F("Api::registerEvents"), make);
+    if (!maybeJson.has_value()) {
+      status.status = iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW;
+      return status;
+    }
+    const auto &json = iop::unwrap(maybeJson, IOP_CTX()).get();
+
+#ifdef IOP_MQTT
+    status.status = this->network().publish(token, F("/v1/events"), json.data());
+    if (status.status != iop::NetworkStatus::OK)
+      return status;
 #else
-  return iop::NetworkStatus::OK;
+    auto const & maybeResp = this->network().httpPost(token, F("/v1/events"), json.data());
+
+#ifndef IOP_MOCK_MONITOR
+    if (iop::is_err(maybeResp)) {
+      const auto code = std::to_string(iop::unwrap_err_ref(maybeResp, IOP_CTX()));
+      this->logger.error(F("Unexpected response at Api::registerEvents: "), code);
+      status.status = iop::NetworkStatus::BROKEN_SERVER;
+      return status;
+    }
+    status.status = iop::unwrap_ok_ref(maybeResp, IOP_CTX()).status;
+    if (status.status != iop::NetworkStatus::OK)
+      return status;
+#endif
 #endif
+    status.sent += count;
+  }
+  return status;
 }
 
-auto Api::registerEvent(const AuthToken &authToken,
-                        const Event &event) const noexcept
+auto Api::registerSummary(const AuthToken &authToken,
+                          const Summary &summary,
+                          const ReportCounters &counters) const noexcept
     -> iop::NetworkStatus {
   IOP_TRACE();
-  this->logger.debug(F("Send event"));
-
-  const auto make = [&event](JsonDocument &doc) {
-    doc["air_temperature_celsius"] = event.storage.airTemperatureCelsius;
-    doc["air_humidity_percentage"] = event.storage.airHumidityPercentage;
-    doc["air_heat_index_celsius"] = event.storage.airHeatIndexCelsius;
-    doc["soil_temperature_celsius"] = event.storage.soilTemperatureCelsius;
-    doc["soil_resistivity_raw"] = event.storage.soilResistivityRaw;
+  this->logger.debug(F("Send summary of samples: "), std::to_string(summary.samples));
+
+  const auto make = [&summary, &counters](JsonDocument &doc) {
+    doc["samples"] = summary.samples;
+    setJsonTimestamp(doc["from"], summary.from);
+    setJsonTimestamp(doc["to"], summary.to);
+    auto reports = doc.createNestedObject("reports");
+    reports["sent"] = counters.sent;
+    reports["suppressed"] = counters.suppressed;
+    for (const auto &field: eventFields) {
+      if (field.capacity == 1) {
+        fillFieldSummaryJson(doc.createNestedObject(field.name), summary.channels.at(field.offset));
+        continue;
+      }
+
+      // Trailing values that were never read are omitted
+      uint8_t length = 0;
+      for (uint8_t index = 0; index < field.capacity; ++index) {
+        if (summary.channels.at(field.offset + index).count > 0)
+          length = static_cast<uint8_t>(index + 1);
+      }
+      auto array = doc.createNestedArray(field.name);
+      for (uint8_t index = 0; index < length; ++index)
+        fillFieldSummaryJson(array.createNestedObject(), summary.channels.at(field.offset + index));
+    }
+    fillFieldSummaryJson(doc.createNestedObject("acquisition_millis"), summary.acquisitionMillis);
   };
-  // 256 bytes is more than enough (we checked, it doesn't get to 200 bytes)
-  auto maybeJson = this->makeJson(F("Api::registerEvent"), make);
+  auto maybeJson = this->makeJson(F("Api::registerSummary"), make);
   if (!maybeJson.has_value())
     return iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW;
   const auto &json = iop::unwrap(maybeJson, IOP_CTX()).get();
 
   const auto token = iop::to_view(authToken);
-  auto const & maybeResp = this->network().httpPost(token, F("/v1/event"), json.data());
+#ifdef IOP_MQTT
+  return this->network().publish(token, F("/v1/summary"), json.data());
+#else
+  auto const & maybeResp = this->network().httpPost(token, F("/v1/summary"), json.data());
 
 #ifndef IOP_MOCK_MONITOR
   if (iop::is_err(maybeResp)) {
     const auto code = std::to_string(iop::unwrap_err_ref(maybeResp, IOP_CTX()));
-    this->logger.error(F("Unexpected response at Api::registerEvent: "), code);
+    this->logger.error(F("Unexpected response at Api::registerSummary: "), code);
     return iop::NetworkStatus::BROKEN_SERVER;
   }
   return iop::unwrap_ok_ref(maybeResp, IOP_CTX()).status;
 #else
   return iop::NetworkStatus::OK;
 #endif
+#endif
 }
+
 auto Api::authenticate(std::string_view username,
                        std::string_view password) const noexcept
     -> std::variant<AuthToken, iop::NetworkStatus> {
@@ -164,8 +399,7 @@ auto Api::authenticate(std::string_view username,
 
   const auto make = [username, password](JsonDocument &doc) {
     IOP_TRACE();
-    doc["email"] = username;
-    doc["password"] = password;
+    fillLoginJson(doc, username, password);
   };
   auto maybeJson = this->makeJson(F("Api::authenticate"), make);
 
@@ -173,7 +407,78 @@ auto Api::authenticate(std::string_view username,
     return iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW;
   const auto &json = iop::unwrap(maybeJson, IOP_CTX()).get();
   
-  auto const & maybeResp = this->network().httpPost(F("/v1/user/login"), json.data());
+  // The token is streamed straight into its buffer
+  auto const & maybeResp = this->network().httpPost(F("/v1/user/login"), json.data(), unused4KbSysStack.token());
+  return this->tokenOf(maybeResp);
+}
+
+// Must outlive the login started by `Api::startAuthentication`, sized like
+// `makeJson`'s buffer
+static std::array<char, 1024> loginBody;
+// Stored by `onLogin`, until `Api::authenticated` takes it
+static std::optional<std::variant<iop::Response, int>> loginResponse;
+
+static void onLogin(const std::variant<iop::Response, int> &result) noexcept {
+  if (iop::is_err(result)) {
+    loginResponse.emplace(iop::unwrap_err_ref(result, IOP_CTX()));
+    return;
+  }
+  // The payload views the token's buffer, so it's still valid
+  const auto &resp = iop::unwrap_ok_ref(result, IOP_CTX());
+  if (resp.payload.has_value()) {
+    loginResponse.emplace(iop::Response(resp.status, *resp.payload));
+  } else {
+    loginResponse.emplace(iop::Response(resp.status));
+  }
+}
+
+auto Api::startAuthentication(std::string_view username,
+                              std::string_view password) const noexcept
+    -> iop::NetworkStatus {
+  IOP_TRACE();
+
+  this->logger.debug(F("Start authenticating IoP user: "), username);
+
+  if (!username.length() || !password.length()) {
+    this->logger.debug(F("Empty username or password, at Api::startAuthentication"));
+    return iop::NetworkStatus::FORBIDDEN;
+  }
+
+  const auto make = [username, password](JsonDocument &doc) {
+    IOP_TRACE();
+    fillLoginJson(doc, username, password);
+  };
+  auto maybeJson = this->makeJson(F("Api::startAuthentication"), make);
+
+  if (!maybeJson.has_value())
+    return iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW;
+  // `makeJson`'s buffer is reused while the request is in flight
+  loginBody = iop::unwrap(maybeJson, IOP_CTX()).get();
+  loginResponse.reset();
+
+  const auto started = this->network().start(iop::HttpMethod::POST, std::nullopt, F("/v1/user/login"),
+                                             iop::to_view(loginBody), F("application/json"),
+                                             unused4KbSysStack.token(), onLogin);
+  if (iop::is_err(started))
+    return iop::unwrap_err_ref(started, IOP_CTX());
+  return iop::NetworkStatus::OK;
+}
+
+auto Api::authenticated() const noexcept
+    -> std::optional<std::variant<AuthToken, iop::NetworkStatus>> {
+  IOP_TRACE();
+  this->network().poll();
+  if (!loginResponse.has_value())
+    return std::nullopt;
+
+  const auto resp = std::move(iop::unwrap_mut(loginResponse, IOP_CTX()));
+  loginResponse.reset();
+  return std::make_optional(this->tokenOf(resp));
+}
+
+auto Api::tokenOf(const std::variant<iop::Response, int> &maybeResp) const noexcept
+    -> std::variant<AuthToken, iop::NetworkStatus> {
+  IOP_TRACE();
 
 #ifndef IOP_MOCK_MONITOR
   if (iop::is_err(maybeResp)) {
@@ -200,11 +505,12 @@ auto Api::authenticate(std::string_view username,
   }
   if (payload.length() != 64) {
     this->logger.error(F("Auth token does not occupy 64 bytes: size = "), std::to_string(payload.length()));
+    return iop::NetworkStatus::BROKEN_SERVER;
   }
 
-  memcpy(unused4KbSysStack.token().data(), payload.c_str(), 64);
   return unused4KbSysStack.token();
 #else
+  (void)maybeResp;
   return AuthToken::empty();
 #endif
 }
@@ -215,6 +521,9 @@ auto Api::registerLog(const AuthToken &authToken,
   IOP_TRACE();
   const auto token = iop::to_view(authToken);
   this->logger.debug(F("Register log. Token: "), token, F(". Log: "), log);
+#ifdef IOP_MQTT
+  return this->network().publish(token, F("/v1/log"), log);
+#else
   auto const & maybeResp = this->network().httpPost(token, F("/v1/log"), std::move(log));
 
 #ifndef IOP_MOCK_MONITOR
@@ -228,6 +537,62 @@ auto Api::registerLog(const AuthToken &authToken,
 #else
   return iop::NetworkStatus::OK;
 #endif
+#endif
+}
+
+auto Api::enqueueLog(const std::string_view log) const noexcept -> bool {
+  IOP_TRACE();
+  return outbound.push(OutboundKind::LOG, log);
+}
+
+auto Api::nextOutbound() const noexcept -> std::optional<OutboundKind> {
+  IOP_TRACE();
+  const auto kind = outbound.nextKind();
+  if (!kind.has_value() || this->network().retryIn(pathOf(*kind)) > 0)
+    return std::nullopt;
+  return kind;
+}
+
+auto Api::drain(const AuthToken &token) const noexcept -> std::optional<iop::NetworkStatus> {
+  IOP_TRACE();
+  if (!this->nextOutbound().has_value())
+    return std::nullopt;
+  auto maybeRequest = outbound.front();
+  const auto request = iop::unwrap(maybeRequest, IOP_CTX());
+
+  // Copied, as the queue may change while it's sent (the network logger pushes to it)
+  auto &buffer = unused4KbSysStack.text();
+  memcpy(buffer.data(), request.payload.data(), request.payload.length());
+  const auto payload = std::string_view(buffer.data(), request.payload.length());
+
+  this->logger.debug(F("Sending queued request, queued: "), std::to_string(outbound.size()),
+                     F(", bytes: "), std::to_string(outbound.bytes()), F(", dropped: "), std::to_string(outbound.dropped()));
+  const auto status = this->send(token, pathOf(request.kind), payload);
+  if (status != iop::NetworkStatus::CONNECTION_ISSUES && status != iop::NetworkStatus::BROKEN_SERVER)
+    outbound.remove(request.id);
+  return status;
+}
+
+auto Api::send(const AuthToken &token, const iop::StaticString path, const std::string_view payload) const noexcept
+    -> iop::NetworkStatus {
+  IOP_TRACE();
+#ifdef IOP_MQTT
+  // Queued panics and logs
+  return this->network().publish(iop::to_view(token), path, payload);
+#else
+  auto const & maybeResp = this->network().httpPost(iop::to_view(token), path, payload);
+
+#ifndef IOP_MOCK_MONITOR
+  if (iop::is_err(maybeResp)) {
+    const auto code = std::to_string(iop::unwrap_err_ref(maybeResp, IOP_CTX()));
+    this->logger.error(F("Unexpected response at Api::send: "), code);
+    return iop::NetworkStatus::BROKEN_SERVER;
+  }
+  return iop::unwrap_ok_ref(maybeResp, IOP_CTX()).status;
+#else
+  return iop::NetworkStatus::OK;
+#endif
+#endif
 }
 
 #ifdef IOP_DESKTOP
@@ -240,16 +605,51 @@ auto Api::upgrade(const AuthToken &token) const noexcept
   IOP_TRACE();
   this->logger.debug(F("Upgrading sketch"));
 
+  static bool restored = false;
+  if (!restored) {
+    iop::UpgradeAttempts::Persisted persisted = {};
+    if (driver::device.rtcRead(upgradeRtcOffset, persisted.data(), sizeof(persisted)))
+      upgradeAttempts.restore(persisted);
+    restored = true;
+  }
+
+  // A known bad image isn't even probed for, the server offers it in every response
+  const auto &md5 = driver::device.binaryMD5();
+  const auto known = iop::Network::latestVersion();
+  if (known.has_value() && !upgradeAttempts.shouldDownload(*known)) {
+    this->logger.warn(F("Ignoring upgrade that already failed: "), std::string_view(known->data(), known->size()));
+    return iop::NetworkStatus::OK;
+  }
+
+  // Only the headers are sent, the server answers 304 if the current version is the latest
+  const iop::StaticString path = F("/v1/update");
+  const auto &maybeResp = this->network().httpHead(iop::to_view(token), path, std::string_view(md5.data(), md5.size()));
+  if (iop::is_err(maybeResp)) {
+    const auto code = iop::unwrap_err_ref(maybeResp, IOP_CTX());
+    if (code == HTTP_CODE_NOT_MODIFIED) {
+      this->logger.debug(F("Already at the latest version"));
+      return iop::NetworkStatus::OK;
+    }
+    this->logger.error(F("Unexpected response at Api::upgrade: "), std::to_string(code));
+    return iop::NetworkStatus::BROKEN_SERVER;
+  }
+  const auto status = iop::unwrap_ok_ref(maybeResp, IOP_CTX()).status;
+  if (status != iop::NetworkStatus::OK)
+    return status;
+
+  // Servers that don't say which version they offer are trusted, as before
+  const auto offered = iop::Network::latestVersion();
+  if (offered.has_value() && (*offered == md5 || !upgradeAttempts.shouldDownload(*offered))) {
+    this->logger.debug(F("No new version offered"));
+    return iop::NetworkStatus::OK;
+  }
+
   #ifdef IOP_DESKTOP
   (void) token;
+  this->logger.info(F("Upgrade offered, but unsupported on desktop"));
+  return iop::NetworkStatus::OK;
   #else
-  const iop::StaticString path = F("/v1/update");
-
-  #ifndef IOP_DESKTOP
   const auto uri = String(this->uri().get()) + path.get();
-  #else
-  const auto uri = std::string(this->uri().asCharPtr()) + path.asCharPtr();
-  #endif
 
   auto &client = iop::Network::wifiClient();
 
@@ -258,31 +658,36 @@ auto Api::upgrade(const AuthToken &token) const noexcept
   ESPhttpUpdate.closeConnectionsOnUpdate(true);
   ESPhttpUpdate.rebootOnUpdate(true);
   //ESPhttpUpdate.setLedPin(LED_BUILTIN);
-  const auto result = ESPhttpUpdate.updateFS(client, uri, "");
+  // Sent as x-ESP8266-version, so the server may still answer 304
+  const auto version = std::string(md5.data(), md5.size());
+  const auto result = ESPhttpUpdate.updateFS(client, uri, version.c_str());
 
-#ifdef IOP_MOCK_MONITOR
+  #ifdef IOP_MOCK_MONITOR
+  (void) result;
   return iop::NetworkStatus::OK;
-#endif
-
-switch (result) {
+  #else
+  switch (result) {
   case HTTP_UPDATE_NO_UPDATES:
   case HTTP_UPDATE_OK:
     return iop::NetworkStatus::OK;
   case HTTP_UPDATE_FAILED:
-  #ifndef IOP_DESKTOP
     // TODO(pc): properly handle ESPhttpUpdate.getLastError()
     this->logger.error(F("Update failed: "),
                        iop::to_view(ESPhttpUpdate.getLastErrorString()));
-  #endif
+    if (offered.has_value()) {
+      upgradeAttempts.failed(*offered);
+      auto persisted = upgradeAttempts.persist();
+      driver::device.rtcWrite(upgradeRtcOffset, persisted.data(), sizeof(persisted));
+      this->logger.warn(F("Upgrade failed (attempts): "), std::to_string(upgradeAttempts.failuresOf(*offered)));
+    }
     return iop::NetworkStatus::BROKEN_SERVER;
   }
-  #ifndef IOP_DESKTOP
   // TODO(pc): properly handle ESPhttpUpdate.getLastError()
   this->logger.error(F("Update failed (UNKNOWN): "),
                      iop::to_view(ESPhttpUpdate.getLastErrorString()));
+  return iop::NetworkStatus::BROKEN_SERVER;
   #endif
   #endif
-  return iop::NetworkStatus::BROKEN_SERVER;
 }
 #else
 auto Api::loggerLevel() const noexcept -> iop::LogLevel {
@@ -305,12 +710,22 @@ auto Api::reportPanic(const AuthToken &authToken,
   IOP_TRACE();
   return iop::NetworkStatus::OK;
 }
-auto Api::registerEvent(const AuthToken &token,
-                        const Event &event) const noexcept
+auto Api::registerEvents(const AuthToken &token,
+                         const iop::Span<const Event> events) const noexcept
+    -> BatchStatus {
+  (void)*this;
+  (void)token;
+  IOP_TRACE();
+  return BatchStatus { iop::NetworkStatus::OK, events.size() };
+}
+auto Api::registerSummary(const AuthToken &token,
+                          const Summary &summary,
+                          const ReportCounters &counters) const noexcept
     -> iop::NetworkStatus {
   (void)*this;
   (void)token;
-  (void)event;
+  (void)summary;
+  (void)counters;
   IOP_TRACE();
   return iop::NetworkStatus::OK;
 }
@@ -323,6 +738,28 @@ auto Api::authenticate(std::string_view username,
   IOP_TRACE();
   return (AuthToken){0};
 }
+// Set by `Api::startAuthentication`, taken by `Api::authenticated`
+static bool loginStarted = false;
+auto Api::startAuthentication(std::string_view username,
+                              std::string_view password) const noexcept
+    -> iop::NetworkStatus {
+  (void)*this;
+  (void)std::move(username);
+  (void)std::move(password);
+  IOP_TRACE();
+  loginStarted = true;
+  return iop::NetworkStatus::OK;
+}
+auto Api::authenticated() const noexcept
+    -> std::optional<std::variant<AuthToken, iop::NetworkStatus>> {
+  (void)*this;
+  IOP_TRACE();
+  // Like the real one, there is only an answer to a started login
+  if (!loginStarted)
+    return std::nullopt;
+  loginStarted = false;
+  return std::make_optional(std::variant<AuthToken, iop::NetworkStatus>((AuthToken){0}));
+}
 auto Api::registerLog(const AuthToken &authToken,
                       std::string_view log) const noexcept
     -> iop::NetworkStatus {
@@ -333,6 +770,24 @@ auto Api::registerLog(const AuthToken &authToken,
   return iop::NetworkStatus::OK;
 }
 
+auto Api::enqueueLog(const std::string_view log) const noexcept -> bool {
+  (void)*this;
+  (void)log;
+  IOP_TRACE();
+  return true;
+}
+auto Api::nextOutbound() const noexcept -> std::optional<OutboundKind> {
+  (void)*this;
+  IOP_TRACE();
+  return std::nullopt;
+}
+auto Api::drain(const AuthToken &token) const noexcept -> std::optional<iop::NetworkStatus> {
+  (void)*this;
+  (void)token;
+  IOP_TRACE();
+  return std::nullopt;
+}
+
 auto Api::setup() const noexcept -> void {}
 #endif
 
@@ -0,0 +1,81 @@
+#include "clock.hpp"
+#include "configuration.hpp"
+#include "driver/sntp.hpp"
+#include <cstdlib>
+#include <type_traits>
+
+/// Synchronizations closer than this don't measure drift reliably
+constexpr static iop::esp_time minimumDriftWindow = 10 * 60 * 1000;
+/// Crystals drift by tens of ppm, anything bigger means the clock was stepped
+constexpr static int64_t maximumDriftPpm = 1000;
+
+/// Unsigned subtraction handles `millis()` overflow, as long as both are
+/// closer than half of its range
+static auto signedDelta(const iop::esp_time to, const iop::esp_time from) noexcept -> int64_t {
+  return static_cast<int64_t>(static_cast<std::make_signed_t<iop::esp_time>>(to - from));
+}
+
+Clock::Clock() noexcept: synchronized_(false), anchorMillis(0), anchorUnixMillis(0), driftPpm_(0), hasDrift(false) {
+  IOP_TRACE();
+}
+
+void Clock::setup() const noexcept {
+  IOP_TRACE();
+  driver::sntp.setup(config::timeSyncInterval);
+}
+
+auto Clock::handle(const iop::esp_time now) noexcept -> bool {
+  IOP_TRACE();
+  const auto maybeUnixMillis = driver::sntp.synchronized();
+  if (!maybeUnixMillis.has_value())
+    return false;
+
+  this->synchronized(now, *maybeUnixMillis);
+  return true;
+}
+
+void Clock::synchronized(const iop::esp_time now, const uint64_t unixMillis) noexcept {
+  IOP_TRACE();
+  if (this->synchronized_) {
+    const auto elapsed = signedDelta(now, this->anchorMillis);
+    const auto error = static_cast<int64_t>(unixMillis - this->anchorUnixMillis) - elapsed;
+
+    if (elapsed >= static_cast<int64_t>(minimumDriftWindow)) {
+      const auto measured = error * 1000000 / elapsed;
+      if (std::llabs(measured) <= maximumDriftPpm) {
+        // Smooths NTP jitter
+        this->driftPpm_ = static_cast<int32_t>(this->hasDrift ? (this->driftPpm_ + measured) / 2 : measured);
+        this->hasDrift = true;
+      }
+    }
+  }
+
+  this->synchronized_ = true;
+  this->anchorMillis = now;
+  this->anchorUnixMillis = unixMillis;
+}
+
+auto Clock::isSynchronized() const noexcept -> bool {
+  IOP_TRACE();
+  return this->synchronized_;
+}
+
+auto Clock::driftPpm() const noexcept -> int32_t {
+  IOP_TRACE();
+  return this->driftPpm_;
+}
+
+auto Clock::unixMillis(const iop::esp_time monotonic) const noexcept -> uint64_t {
+  IOP_TRACE();
+  if (!this->synchronized_)
+    return 0;
+
+  const auto delta = signedDelta(monotonic, this->anchorMillis);
+  const auto corrected = delta + delta * this->driftPpm_ / 1000000;
+  return this->anchorUnixMillis + static_cast<uint64_t>(corrected);
+}
+
+auto Clock::unixSeconds(const iop::esp_time monotonic) const noexcept -> uint32_t {
+  IOP_TRACE();
+  return static_cast<uint32_t>(this->unixMillis(monotonic) / 1000);
+}
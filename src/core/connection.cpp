@@ -0,0 +1,44 @@
+#include "core/connection.hpp"
+#include "core/log.hpp"
+
+namespace iop {
+ConnectionManager::ConnectionManager(const iop::esp_time idleTimeout, const uint16_t maxRequests) noexcept
+    : idleTimeout(idleTimeout), maxRequests(maxRequests), lastUsed(0), served(0), stats_({0, 0, 0}) {
+  IOP_TRACE();
+}
+
+auto ConnectionManager::canReuse(const iop::esp_time now, const bool connected) const noexcept -> bool {
+  IOP_TRACE();
+  // Unsigned subtraction handles `millis()` overflow
+  return connected && this->served < this->maxRequests && now - this->lastUsed < this->idleTimeout;
+}
+
+void ConnectionManager::sent(const iop::esp_time now, const bool reused) noexcept {
+  IOP_TRACE();
+  if (!reused)
+    this->served = 0;
+  this->served++;
+  this->lastUsed = now;
+
+  this->stats_.requests++;
+  if (reused)
+    this->stats_.reused++;
+}
+
+void ConnectionManager::reconnected() noexcept {
+  IOP_TRACE();
+  this->stats_.reconnected++;
+}
+
+auto ConnectionManager::stats() const noexcept -> ConnectionStats {
+  IOP_TRACE();
+  return this->stats_;
+}
+
+auto ConnectionManager::hitRate() const noexcept -> uint8_t {
+  IOP_TRACE();
+  if (this->stats_.requests == 0)
+    return 0;
+  return static_cast<uint8_t>(static_cast<uint64_t>(this->stats_.reused) * 100 / this->stats_.requests);
+}
+} // namespace iop
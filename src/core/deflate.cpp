@@ -0,0 +1,170 @@
+#include "core/deflate.hpp"
+#include "core/log.hpp"
+
+namespace iop {
+constexpr static size_t minMatch = 3;
+constexpr static size_t maxMatch = 258;
+
+// RFC 1951, section 3.2.5
+constexpr static uint16_t lengthBase[] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr static uint8_t lengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                          2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr static uint16_t distanceBase[] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                            33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                            1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr static uint8_t distanceExtra[] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                            6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static auto hashOf(const std::string_view input, const size_t pos) noexcept -> uint16_t {
+  const uint32_t value = static_cast<uint8_t>(input[pos]) << 16 | static_cast<uint8_t>(input[pos + 1]) << 8 | static_cast<uint8_t>(input[pos + 2]);
+  // Knuth's multiplicative hash
+  return static_cast<uint16_t>((value * 2654435761UL) >> (32 - Deflate::hashBits)) & ((1 << Deflate::hashBits) - 1);
+}
+
+static auto crc32(const std::string_view input) noexcept -> uint32_t {
+  // Bitwise, a table would cost 1KB
+  uint32_t crc = 0xFFFFFFFF;
+  for (const auto c: input) {
+    crc ^= static_cast<uint8_t>(c);
+    for (uint8_t bit = 0; bit < 8; ++bit)
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+Deflate::Deflate() noexcept: head({}), output(nullptr, 0), length(0), overflow(false), bits(0), bitCount(0) {
+  IOP_TRACE();
+}
+
+auto Deflate::gzip(const std::string_view input, const Span<char> output) noexcept -> std::optional<size_t> {
+  IOP_TRACE();
+  // Positions must fit `head`
+  if (input.length() >= UINT16_MAX)
+    return std::nullopt;
+
+  this->head.fill(0);
+  this->output = output;
+  this->length = 0;
+  this->overflow = false;
+  this->bits = 0;
+  this->bitCount = 0;
+
+  // Deflate, no modification time, no flags, unknown OS
+  constexpr uint8_t header[] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+  for (const auto byte: header)
+    this->writeByte(byte);
+
+  // Final block, fixed Huffman codes
+  this->writeBits(1, 1);
+  this->writeBits(1, 2);
+
+  size_t pos = 0;
+  while (pos < input.length() && !this->overflow) {
+    size_t matchLength = 0;
+    size_t distance = 0;
+
+    if (pos + minMatch <= input.length()) {
+      const auto hash = hashOf(input, pos);
+      const auto candidate = this->head.at(hash);
+      this->head.at(hash) = static_cast<uint16_t>(pos + 1);
+
+      // Hashes collide, so the match must be checked
+      if (candidate != 0 && pos - (candidate - 1) <= window) {
+        const auto start = static_cast<size_t>(candidate - 1);
+        while (matchLength < maxMatch && pos + matchLength < input.length() &&
+               input[start + matchLength] == input[pos + matchLength])
+          matchLength++;
+        distance = pos - start;
+      }
+    }
+
+    if (matchLength < minMatch) {
+      this->literal(static_cast<uint8_t>(input[pos]));
+      pos++;
+      continue;
+    }
+
+    this->match(matchLength, distance);
+    // Skipped positions are indexed too, so later matches may start at them
+    for (size_t skipped = pos + 1; skipped < pos + matchLength && skipped + minMatch <= input.length(); ++skipped)
+      this->head.at(hashOf(input, skipped)) = static_cast<uint16_t>(skipped + 1);
+    pos += matchLength;
+  }
+
+  // End of block
+  this->literal(256);
+  this->flushBits();
+
+  this->writeUint32(crc32(input));
+  this->writeUint32(static_cast<uint32_t>(input.length()));
+
+  if (this->overflow)
+    return std::nullopt;
+  return this->length;
+}
+
+void Deflate::literal(const uint16_t symbol) noexcept {
+  // RFC 1951, section 3.2.6
+  if (symbol < 144) {
+    this->writeCode(0x30 + symbol, 8);
+  } else if (symbol < 256) {
+    this->writeCode(0x190 + symbol - 144, 9);
+  } else if (symbol < 280) {
+    this->writeCode(symbol - 256, 7);
+  } else {
+    this->writeCode(0xC0 + symbol - 280, 8);
+  }
+}
+
+void Deflate::match(const size_t length, const size_t distance) noexcept {
+  size_t code = 0;
+  while (code + 1 < sizeof(lengthBase) / sizeof(lengthBase[0]) && lengthBase[code + 1] <= length)
+    code++;
+  this->literal(static_cast<uint16_t>(257 + code));
+  this->writeBits(static_cast<uint32_t>(length - lengthBase[code]), lengthExtra[code]);
+
+  code = 0;
+  while (code + 1 < sizeof(distanceBase) / sizeof(distanceBase[0]) && distanceBase[code + 1] <= distance)
+    code++;
+  this->writeCode(static_cast<uint16_t>(code), 5);
+  this->writeBits(static_cast<uint32_t>(distance - distanceBase[code]), distanceExtra[code]);
+}
+
+void Deflate::writeCode(const uint16_t code, const uint8_t count) noexcept {
+  uint32_t reversed = 0;
+  for (uint8_t bit = 0; bit < count; ++bit)
+    reversed |= ((code >> bit) & 1U) << (count - 1 - bit);
+  this->writeBits(reversed, count);
+}
+
+void Deflate::writeBits(const uint32_t value, const uint8_t count) noexcept {
+  this->bits |= value << this->bitCount;
+  this->bitCount = static_cast<uint8_t>(this->bitCount + count);
+  while (this->bitCount >= 8) {
+    this->writeByte(static_cast<uint8_t>(this->bits & 0xFF));
+    this->bits >>= 8;
+    this->bitCount = static_cast<uint8_t>(this->bitCount - 8);
+  }
+}
+
+void Deflate::writeByte(const uint8_t byte) noexcept {
+  if (this->length >= this->output.size()) {
+    this->overflow = true;
+    return;
+  }
+  this->output[this->length++] = static_cast<char>(byte);
+}
+
+void Deflate::writeUint32(const uint32_t value) noexcept {
+  for (uint8_t byte = 0; byte < 4; ++byte)
+    this->writeByte(static_cast<uint8_t>(value >> (byte * 8)));
+}
+
+void Deflate::flushBits() noexcept {
+  if (this->bitCount > 0)
+    this->writeByte(static_cast<uint8_t>(this->bits & 0xFF));
+  this->bits = 0;
+  this->bitCount = 0;
+}
+} // namespace iop
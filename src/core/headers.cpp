@@ -0,0 +1,107 @@
+#include "core/headers.hpp"
+
+namespace iop {
+HeaderBuilder::HeaderBuilder() noexcept: headers({}), staticLength(0), length(0), uri_({}), authorization_({}) {
+  IOP_TRACE();
+}
+
+void HeaderBuilder::setup(const MD5Hash &md5, const MacAddress &mac) noexcept {
+  IOP_TRACE();
+  this->length = 0;
+  const auto fits = this->append(F("VERSION")) && this->append(std::string_view(md5.data(), md5.size())) &&
+                    this->append(F("MAC_ADDRESS")) && this->append(std::string_view(mac.data(), mac.size()));
+  iop_assert(fits, F("HeaderBuilder::capacity is too small for the static headers"));
+  this->staticLength = this->length;
+}
+
+auto HeaderBuilder::setUri(const StaticString base, const StaticString path) noexcept -> bool {
+  IOP_TRACE();
+  const auto baseLength = base.length();
+  const auto pathLength = path.length();
+  if (baseLength + pathLength > uriCapacity)
+    return false;
+
+  char *pathStart = this->uri_.data() + baseLength; // NOLINT *-pro-bounds-pointer-arithmetic
+  memmove_P(this->uri_.data(), base.asCharPtr(), baseLength);
+  memmove_P(pathStart, path.asCharPtr(), pathLength);
+  this->uri_.at(baseLength + pathLength) = '\0';
+  return true;
+}
+
+auto HeaderBuilder::setAuthorization(const std::optional<std::string_view> token) noexcept -> bool {
+  IOP_TRACE();
+  const auto tok = token.value_or(std::string_view());
+  if (tok.length() > tokenCapacity)
+    return false;
+
+  memcpy(this->authorization_.data(), tok.data(), tok.length());
+  this->authorization_.at(tok.length()) = '\0';
+  return true;
+}
+
+auto HeaderBuilder::setDeviceStats(const size_t freeStack, const size_t freeHeap, const size_t biggestFreeBlock,
+                                   const uint16_t vcc, const iop::esp_time timeRunning) noexcept -> bool {
+  IOP_TRACE();
+  this->length = this->staticLength;
+  return this->append(F("FREE_STACK")) && this->append(static_cast<uint64_t>(freeStack)) &&
+         this->append(F("FREE_HEAP")) && this->append(static_cast<uint64_t>(freeHeap)) &&
+         this->append(F("BIGGEST_FREE_BLOCK")) && this->append(static_cast<uint64_t>(biggestFreeBlock)) &&
+         this->append(F("VCC")) && this->append(static_cast<uint64_t>(vcc)) &&
+         this->append(F("TIME_RUNNING")) && this->append(static_cast<uint64_t>(timeRunning));
+}
+
+auto HeaderBuilder::setIfNoneMatch(const std::string_view etag) noexcept -> bool {
+  IOP_TRACE();
+  const iop::StaticString name(F("If-None-Match"));
+  // Entity tags are quoted
+  if (this->length + name.length() + 1 + etag.length() + 3 > capacity)
+    return false;
+  this->append(name);
+
+  this->headers.at(this->length++) = '"';
+  memcpy(this->headers.data() + this->length, etag.data(), etag.length()); // NOLINT *-pro-bounds-pointer-arithmetic
+  this->length += etag.length();
+  this->headers.at(this->length++) = '"';
+  this->headers.at(this->length++) = '\0';
+  return true;
+}
+
+auto HeaderBuilder::append(const StaticString str) noexcept -> bool {
+  const auto len = str.length();
+  if (this->length + len + 1 > capacity)
+    return false;
+
+  char *end = this->headers.data() + this->length; // NOLINT *-pro-bounds-pointer-arithmetic
+  memmove_P(end, str.asCharPtr(), len);
+  this->length += len;
+  this->headers.at(this->length++) = '\0';
+  return true;
+}
+
+auto HeaderBuilder::append(const std::string_view str) noexcept -> bool {
+  if (this->length + str.length() + 1 > capacity)
+    return false;
+
+  memcpy(this->headers.data() + this->length, str.data(), str.length()); // NOLINT *-pro-bounds-pointer-arithmetic
+  this->length += str.length();
+  this->headers.at(this->length++) = '\0';
+  return true;
+}
+
+auto HeaderBuilder::append(uint64_t number) noexcept -> bool {
+  // Digits are generated backwards
+  std::array<char, 20> digits = {};
+  size_t count = 0;
+  do {
+    digits.at(count++) = static_cast<char>('0' + number % 10);
+    number /= 10;
+  } while (number > 0);
+
+  if (this->length + count + 1 > capacity)
+    return false;
+  while (count > 0)
+    this->headers.at(this->length++) = digits.at(--count);
+  this->headers.at(this->length++) = '\0';
+  return true;
+}
+} // namespace iop
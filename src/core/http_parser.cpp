@@ -0,0 +1,291 @@
+#include "core/http_parser.hpp"
+#include "core/log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace iop {
+static auto equalsIgnoreCase(const std::string_view a, const std::string_view b) noexcept -> bool {
+  if (a.length() != b.length())
+    return false;
+  for (size_t index = 0; index < a.length(); ++index) {
+    // Headers can't be UTF8, so ASCII is enough
+    const auto lower = [](const char ch) { return ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch - 'A' + 'a') : ch; };
+    if (lower(a[index]) != lower(b[index]))
+      return false;
+  }
+  return true;
+}
+
+static auto containsIgnoreCase(const std::string_view haystack, const std::string_view needle) noexcept -> bool {
+  for (size_t index = 0; index + needle.length() <= haystack.length(); ++index) {
+    if (equalsIgnoreCase(haystack.substr(index, needle.length()), needle))
+      return true;
+  }
+  return false;
+}
+
+static auto trim(std::string_view str) noexcept -> std::string_view {
+  while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+    str.remove_prefix(1);
+  while (!str.empty() && (str.back() == ' ' || str.back() == '\t' || str.back() == '\r'))
+    str.remove_suffix(1);
+  return str;
+}
+
+HttpResponseParser::HttpResponseParser() noexcept: state_(State::STATUS_LINE), status_(0), contentLength_(),
+    chunked(false), keepAlive_(false), untilClose(false), bodyless(false),
+    remaining(0), line({}), lineLength(0), headers({}), headersCount(0) {
+  IOP_TRACE();
+}
+
+void HttpResponseParser::reset() noexcept {
+  IOP_TRACE();
+  this->state_ = State::STATUS_LINE;
+  this->status_ = 0;
+  this->contentLength_.reset();
+  this->chunked = false;
+  this->keepAlive_ = false;
+  this->untilClose = false;
+  this->bodyless = false;
+  this->remaining = 0;
+  this->lineLength = 0;
+  for (uint8_t index = 0; index < this->headersCount; ++index) {
+    this->headers.at(index).found = false;
+    this->headers.at(index).length = 0;
+  }
+}
+
+auto HttpResponseParser::collect(const char *name) noexcept -> bool {
+  IOP_TRACE();
+  if (this->headersCount >= maxCollectedHeaders)
+    return false;
+  auto &header = this->headers.at(this->headersCount++);
+  header.name = name;
+  header.length = 0;
+  header.found = false;
+  return true;
+}
+
+auto HttpResponseParser::feed(const std::string_view input) noexcept -> Step {
+  IOP_TRACE();
+  Step step = {0, std::string_view()};
+
+  while (step.consumed < input.length() && this->state_ != State::DONE && this->state_ != State::FAILED) {
+    const auto rest = input.substr(step.consumed);
+
+    if (this->state_ == State::BODY || this->state_ == State::CHUNK_DATA) {
+      // One body slice per step, so the caller doesn't need to buffer them
+      if (step.body.data() != nullptr)
+        break;
+
+      const auto length = this->untilClose ? rest.length() : std::min(this->remaining, rest.length());
+      step.body = rest.substr(0, length);
+      step.consumed += length;
+      if (this->untilClose)
+        continue;
+
+      this->remaining -= length;
+      if (this->remaining == 0)
+        this->state_ = this->state_ == State::BODY ? State::DONE : State::CHUNK_DATA_END;
+      continue;
+    }
+
+    const auto end = rest.find('\n');
+    const auto segment = end == std::string_view::npos ? rest : rest.substr(0, end + 1);
+    step.consumed += segment.length();
+
+    // Lines are only copied if they are split between reads
+    if (end == std::string_view::npos || this->lineLength > 0) {
+      if (this->lineLength + segment.length() > lineCapacity) {
+        this->state_ = State::FAILED;
+        break;
+      }
+      memcpy(this->line.data() + this->lineLength, segment.data(), segment.length()); // NOLINT *-pro-bounds-pointer-arithmetic
+      this->lineLength += segment.length();
+      if (end == std::string_view::npos)
+        break;
+
+      const auto length = this->lineLength;
+      this->lineLength = 0;
+      this->processLine(std::string_view(this->line.data(), length));
+    } else {
+      this->processLine(segment);
+    }
+  }
+  return step;
+}
+
+void HttpResponseParser::finish() noexcept {
+  IOP_TRACE();
+  if (this->state_ == State::BODY && this->untilClose) {
+    this->state_ = State::DONE;
+  } else if (this->state_ != State::DONE) {
+    this->state_ = State::FAILED;
+  }
+}
+
+auto HttpResponseParser::header(const std::string_view name) const noexcept -> std::optional<std::string_view> {
+  IOP_TRACE();
+  for (uint8_t index = 0; index < this->headersCount; ++index) {
+    const auto &header = this->headers.at(index);
+    if (header.found && equalsIgnoreCase(header.name, name))
+      return std::string_view(header.value.data(), header.length);
+  }
+  return std::nullopt;
+}
+
+void HttpResponseParser::processLine(std::string_view line) noexcept {
+  // Lines end with CRLF, but a bare LF is tolerated
+  line.remove_suffix(1);
+  if (!line.empty() && line.back() == '\r')
+    line.remove_suffix(1);
+
+  switch (this->state_) {
+  case State::STATUS_LINE:
+    this->processStatusLine(line);
+    break;
+  case State::HEADERS:
+    if (line.empty()) {
+      this->endHeaders();
+    } else {
+      this->processHeader(line);
+    }
+    break;
+  case State::CHUNK_SIZE:
+    this->processChunkSize(line);
+    break;
+  case State::CHUNK_DATA_END:
+    this->state_ = line.empty() ? State::CHUNK_SIZE : State::FAILED;
+    break;
+  case State::TRAILERS:
+    // Trailers are ignored
+    if (line.empty())
+      this->state_ = State::DONE;
+    break;
+  case State::BODY:
+  case State::CHUNK_DATA:
+  case State::DONE:
+  case State::FAILED:
+    break;
+  }
+}
+
+void HttpResponseParser::processStatusLine(const std::string_view line) noexcept {
+  // HTTP/1.1 200 OK
+  constexpr size_t codeStart = 9; // len("HTTP/1.1 ")
+  if (line.length() < codeStart + 3 || line.substr(0, 7) != "HTTP/1." || line[8] != ' ') {
+    this->state_ = State::FAILED;
+    return;
+  }
+
+  uint16_t status = 0;
+  for (const auto ch: line.substr(codeStart, 3)) {
+    if (ch < '0' || ch > '9') {
+      this->state_ = State::FAILED;
+      return;
+    }
+    status = static_cast<uint16_t>(status * 10 + (ch - '0'));
+  }
+
+  this->status_ = status;
+  // HTTP/1.1 keeps the connection alive by default, HTTP/1.0 closes it
+  this->keepAlive_ = line[7] == '1';
+  this->state_ = State::HEADERS;
+}
+
+void HttpResponseParser::processHeader(const std::string_view line) noexcept {
+  const auto colon = line.find(':');
+  if (colon == std::string_view::npos || colon == 0) {
+    this->state_ = State::FAILED;
+    return;
+  }
+  const auto name = trim(line.substr(0, colon));
+  const auto value = trim(line.substr(colon + 1));
+
+  if (equalsIgnoreCase(name, "Content-Length")) {
+    size_t length = 0;
+    for (const auto ch: value) {
+      if (ch < '0' || ch > '9' || length > SIZE_MAX / 10) {
+        this->state_ = State::FAILED;
+        return;
+      }
+      length = length * 10 + static_cast<size_t>(ch - '0');
+    }
+    this->contentLength_ = length;
+  } else if (equalsIgnoreCase(name, "Transfer-Encoding")) {
+    this->chunked = containsIgnoreCase(value, "chunked");
+  } else if (equalsIgnoreCase(name, "Connection")) {
+    if (containsIgnoreCase(value, "close")) {
+      this->keepAlive_ = false;
+    } else if (containsIgnoreCase(value, "keep-alive")) {
+      this->keepAlive_ = true;
+    }
+  }
+
+  for (uint8_t index = 0; index < this->headersCount; ++index) {
+    auto &header = this->headers.at(index);
+    if (!equalsIgnoreCase(header.name, name))
+      continue;
+    header.found = true;
+    header.length = static_cast<uint8_t>(std::min(value.length(), headerValueCapacity));
+    memcpy(header.value.data(), value.data(), header.length);
+  }
+}
+
+void HttpResponseParser::processChunkSize(const std::string_view line) noexcept {
+  // Chunk extensions (after ';') are ignored
+  const auto digits = trim(line.substr(0, line.find(';')));
+  if (digits.empty()) {
+    this->state_ = State::FAILED;
+    return;
+  }
+
+  size_t size = 0;
+  for (const auto ch: digits) {
+    uint8_t digit = 0;
+    if (ch >= '0' && ch <= '9') {
+      digit = static_cast<uint8_t>(ch - '0');
+    } else if (ch >= 'a' && ch <= 'f') {
+      digit = static_cast<uint8_t>(ch - 'a' + 10);
+    } else if (ch >= 'A' && ch <= 'F') {
+      digit = static_cast<uint8_t>(ch - 'A' + 10);
+    } else {
+      this->state_ = State::FAILED;
+      return;
+    }
+    if (size > SIZE_MAX / 16) {
+      this->state_ = State::FAILED;
+      return;
+    }
+    size = size * 16 + digit;
+  }
+
+  this->remaining = size;
+  this->state_ = size == 0 ? State::TRAILERS : State::CHUNK_DATA;
+}
+
+void HttpResponseParser::endHeaders() noexcept {
+  // Informational responses (like 100 Continue) are followed by the real one
+  if (this->status_ >= 100 && this->status_ < 200) {
+    this->state_ = State::STATUS_LINE;
+    return;
+  }
+
+  // No Content and Not Modified never have a body
+  constexpr uint16_t noContent = 204;
+  constexpr uint16_t notModified = 304;
+  if (this->bodyless || this->status_ == noContent || this->status_ == notModified) {
+    this->state_ = State::DONE;
+  } else if (this->chunked) {
+    this->state_ = State::CHUNK_SIZE;
+  } else if (this->contentLength_.has_value()) {
+    this->remaining = *this->contentLength_;
+    this->state_ = this->remaining == 0 ? State::DONE : State::BODY;
+  } else {
+    this->untilClose = true;
+    this->keepAlive_ = false;
+    this->state_ = State::BODY;
+  }
+}
+} // namespace iop
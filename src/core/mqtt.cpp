@@ -0,0 +1,614 @@
+#include "core/mqtt.hpp"
+#include "core/log.hpp"
+#include "driver/client.hpp"
+
+#include <cstring>
+
+static auto logger() noexcept -> iop::Log & {
+  static iop::Log logger_(iop::LogLevel::WARN, F("MQTT"));
+  return logger_;
+}
+
+/// Bigger isn't representable by the remaining length
+constexpr static size_t maxRemainingLength = 268435455;
+/// Only used while connecting, so it never clashes with a publish in flight
+constexpr static uint16_t subscribeId = 1;
+
+/// Appends to a span, remembering if it overflowed
+class Writer {
+  iop::Span<char> output;
+  size_t length;
+  bool overflow;
+
+public:
+  explicit Writer(const iop::Span<char> output) noexcept: output(output), length(0), overflow(false) {}
+
+  void byte(const uint8_t byte) noexcept {
+    if (this->length >= this->output.size()) {
+      this->overflow = true;
+      return;
+    }
+    this->output.begin()[this->length++] = static_cast<char>(byte); // NOLINT *-pro-bounds-pointer-arithmetic
+  }
+  void u16(const uint16_t value) noexcept {
+    this->byte(static_cast<uint8_t>(value >> 8));
+    this->byte(static_cast<uint8_t>(value & 0xFF));
+  }
+  void raw(const std::string_view data) noexcept {
+    if (this->output.size() - std::min(this->length, this->output.size()) < data.length()) {
+      this->overflow = true;
+      return;
+    }
+    memcpy(this->output.begin() + this->length, data.data(), data.length()); // NOLINT *-pro-bounds-pointer-arithmetic
+    this->length += data.length();
+  }
+  /// Length prefixed
+  void string(const std::string_view data) noexcept {
+    if (data.length() > UINT16_MAX) {
+      this->overflow = true;
+      return;
+    }
+    this->u16(static_cast<uint16_t>(data.length()));
+    this->raw(data);
+  }
+  void header(const iop::MqttPacketType type, const uint8_t flags, size_t remaining) noexcept {
+    if (remaining > maxRemainingLength) {
+      this->overflow = true;
+      return;
+    }
+    this->byte(static_cast<uint8_t>(static_cast<uint8_t>(type) << 4 | flags));
+    do {
+      auto digit = static_cast<uint8_t>(remaining % 128);
+      remaining /= 128;
+      if (remaining > 0)
+        digit |= 0x80;
+      this->byte(digit);
+    } while (remaining > 0);
+  }
+
+  auto finish() const noexcept -> std::optional<size_t> {
+    if (this->overflow)
+      return std::nullopt;
+    return this->length;
+  }
+};
+
+/// Consumes a span, remembering if it ran out
+class Reader {
+  std::string_view input;
+  bool failed_;
+
+public:
+  explicit Reader(const std::string_view input) noexcept: input(input), failed_(false) {}
+
+  auto byte() noexcept -> uint8_t {
+    if (this->input.empty()) {
+      this->failed_ = true;
+      return 0;
+    }
+    const auto byte = static_cast<uint8_t>(this->input.front());
+    this->input.remove_prefix(1);
+    return byte;
+  }
+  auto u16() noexcept -> uint16_t {
+    const auto high = this->byte();
+    return static_cast<uint16_t>(high << 8 | this->byte());
+  }
+  auto string() noexcept -> std::string_view {
+    const auto length = this->u16();
+    if (this->failed_ || length > this->input.length()) {
+      this->failed_ = true;
+      return std::string_view();
+    }
+    const auto string = this->input.substr(0, length);
+    this->input.remove_prefix(length);
+    return string;
+  }
+  auto rest() const noexcept -> std::string_view { return this->input; }
+  auto failed() const noexcept -> bool { return this->failed_; }
+};
+
+/// Size of the fixed header and the remaining length, none if incomplete,
+/// zero if malformed
+static auto fixedHeaderOf(const std::string_view input) noexcept -> std::optional<std::pair<size_t, size_t>> {
+  size_t remaining = 0;
+  size_t multiplier = 1;
+  for (size_t index = 1; index < 5; ++index) {
+    if (index >= input.length())
+      return std::nullopt;
+    const auto digit = static_cast<uint8_t>(input.at(index));
+    remaining += (digit & 0x7F) * multiplier;
+    multiplier *= 128;
+    if ((digit & 0x80) == 0)
+      return std::make_pair(index + 1, remaining);
+  }
+  return std::make_pair(static_cast<size_t>(0), static_cast<size_t>(0));
+}
+
+/// FNV-1a
+static auto hashOf(const std::string_view topic, const std::string_view payload) noexcept -> uint32_t {
+  uint32_t hash = 2166136261U;
+  for (const auto c: topic)
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619U;
+  for (const auto c: payload)
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619U;
+  return hash;
+}
+
+namespace iop {
+auto MqttCodec::connect(const MqttConnect &connect, const Span<char> output) noexcept -> std::optional<size_t> {
+  IOP_TRACE();
+  const auto hasUsername = !connect.username.empty();
+  const auto hasPassword = !connect.password.empty();
+  // Protocol name, level, flags and keep-alive
+  size_t remaining = 10 + 2 + connect.clientId.length();
+  if (hasUsername)
+    remaining += 2 + connect.username.length();
+  if (hasPassword)
+    remaining += 2 + connect.password.length();
+
+  uint8_t flags = connect.cleanSession ? 0x02 : 0;
+  if (hasUsername)
+    flags |= 0x80;
+  if (hasPassword)
+    flags |= 0x40;
+
+  Writer writer(output);
+  writer.header(MqttPacketType::CONNECT, 0, remaining);
+  writer.string("MQTT");
+  // Protocol level of MQTT 3.1.1
+  writer.byte(4);
+  writer.byte(flags);
+  writer.u16(connect.keepAlive);
+  writer.string(connect.clientId);
+  if (hasUsername)
+    writer.string(connect.username);
+  if (hasPassword)
+    writer.string(connect.password);
+  return writer.finish();
+}
+
+auto MqttCodec::connack(const bool sessionPresent, const uint8_t code, const Span<char> output) noexcept -> std::optional<size_t> {
+  Writer writer(output);
+  writer.header(MqttPacketType::CONNACK, 0, 2);
+  writer.byte(sessionPresent ? 1 : 0);
+  writer.byte(code);
+  return writer.finish();
+}
+
+auto MqttCodec::publish(const MqttMessage &message, const Span<char> output) noexcept -> std::optional<size_t> {
+  IOP_TRACE();
+  if (message.qos > 2)
+    return std::nullopt;
+  const auto flags = static_cast<uint8_t>((message.dup ? 0x08 : 0) | message.qos << 1 | (message.retain ? 0x01 : 0));
+  const auto remaining = 2 + message.topic.length() + (message.qos > 0 ? 2 : 0) + message.payload.length();
+
+  Writer writer(output);
+  writer.header(MqttPacketType::PUBLISH, flags, remaining);
+  writer.string(message.topic);
+  if (message.qos > 0)
+    writer.u16(message.packetId);
+  writer.raw(message.payload);
+  return writer.finish();
+}
+
+auto MqttCodec::puback(const uint16_t packetId, const Span<char> output) noexcept -> std::optional<size_t> {
+  Writer writer(output);
+  writer.header(MqttPacketType::PUBACK, 0, 2);
+  writer.u16(packetId);
+  return writer.finish();
+}
+
+auto MqttCodec::subscribe(const MqttSubscription &subscription, const Span<char> output) noexcept -> std::optional<size_t> {
+  Writer writer(output);
+  // The flags of SUBSCRIBE are reserved, but must be 2
+  writer.header(MqttPacketType::SUBSCRIBE, 0x02, 2 + 2 + subscription.topic.length() + 1);
+  writer.u16(subscription.packetId);
+  writer.string(subscription.topic);
+  writer.byte(subscription.qos);
+  return writer.finish();
+}
+
+auto MqttCodec::suback(const uint16_t packetId, const uint8_t qos, const Span<char> output) noexcept -> std::optional<size_t> {
+  Writer writer(output);
+  writer.header(MqttPacketType::SUBACK, 0, 3);
+  writer.u16(packetId);
+  writer.byte(qos);
+  return writer.finish();
+}
+
+auto MqttCodec::pingreq(const Span<char> output) noexcept -> std::optional<size_t> {
+  Writer writer(output);
+  writer.header(MqttPacketType::PINGREQ, 0, 0);
+  return writer.finish();
+}
+
+auto MqttCodec::pingresp(const Span<char> output) noexcept -> std::optional<size_t> {
+  Writer writer(output);
+  writer.header(MqttPacketType::PINGRESP, 0, 0);
+  return writer.finish();
+}
+
+auto MqttCodec::disconnect(const Span<char> output) noexcept -> std::optional<size_t> {
+  Writer writer(output);
+  writer.header(MqttPacketType::DISCONNECT, 0, 0);
+  return writer.finish();
+}
+
+auto MqttCodec::decode(const std::string_view input) noexcept -> std::variant<MqttPacket, MqttDecodeError> {
+  if (input.empty())
+    return MqttDecodeError::INCOMPLETE;
+  const auto type = static_cast<uint8_t>(input.front()) >> 4;
+  if (type < static_cast<uint8_t>(MqttPacketType::CONNECT) || type > static_cast<uint8_t>(MqttPacketType::DISCONNECT))
+    return MqttDecodeError::MALFORMED;
+
+  const auto header = fixedHeaderOf(input);
+  if (!header.has_value())
+    return MqttDecodeError::INCOMPLETE;
+  const auto [headerSize, remaining] = *header;
+  if (headerSize == 0)
+    return MqttDecodeError::MALFORMED;
+  if (input.length() < headerSize + remaining)
+    return MqttDecodeError::INCOMPLETE;
+
+  const auto flags = static_cast<uint8_t>(static_cast<uint8_t>(input.front()) & 0x0F);
+  return MqttPacket { static_cast<MqttPacketType>(type), flags, input.substr(headerSize, remaining), headerSize + remaining };
+}
+
+auto MqttCodec::connectOf(const MqttPacket &packet) noexcept -> std::optional<MqttConnect> {
+  if (packet.type != MqttPacketType::CONNECT)
+    return std::nullopt;
+  Reader reader(packet.body);
+  const auto protocol = reader.string();
+  const auto level = reader.byte();
+  const auto flags = reader.byte();
+  MqttConnect connect = {};
+  connect.keepAlive = reader.u16();
+  connect.cleanSession = (flags & 0x02) != 0;
+  connect.clientId = reader.string();
+  // Will topic and message are ignored
+  if ((flags & 0x04) != 0) {
+    reader.string();
+    reader.string();
+  }
+  if ((flags & 0x80) != 0)
+    connect.username = reader.string();
+  if ((flags & 0x40) != 0)
+    connect.password = reader.string();
+  if (reader.failed() || protocol != "MQTT" || level != 4)
+    return std::nullopt;
+  return connect;
+}
+
+auto MqttCodec::connackOf(const MqttPacket &packet) noexcept -> std::optional<std::pair<bool, uint8_t>> {
+  if (packet.type != MqttPacketType::CONNACK || packet.body.length() != 2)
+    return std::nullopt;
+  return std::make_pair((packet.body.front() & 0x01) != 0, static_cast<uint8_t>(packet.body.back()));
+}
+
+auto MqttCodec::messageOf(const MqttPacket &packet) noexcept -> std::optional<MqttMessage> {
+  if (packet.type != MqttPacketType::PUBLISH)
+    return std::nullopt;
+  MqttMessage message = {};
+  message.dup = (packet.flags & 0x08) != 0;
+  message.qos = static_cast<uint8_t>((packet.flags >> 1) & 0x03);
+  message.retain = (packet.flags & 0x01) != 0;
+  if (message.qos > 2)
+    return std::nullopt;
+
+  Reader reader(packet.body);
+  message.topic = reader.string();
+  if (message.qos > 0)
+    message.packetId = reader.u16();
+  message.payload = reader.rest();
+  if (reader.failed())
+    return std::nullopt;
+  return message;
+}
+
+auto MqttCodec::subscriptionOf(const MqttPacket &packet) noexcept -> std::optional<MqttSubscription> {
+  if (packet.type != MqttPacketType::SUBSCRIBE || packet.flags != 0x02)
+    return std::nullopt;
+  Reader reader(packet.body);
+  MqttSubscription subscription = {};
+  subscription.packetId = reader.u16();
+  subscription.topic = reader.string();
+  subscription.qos = reader.byte();
+  if (reader.failed())
+    return std::nullopt;
+  return subscription;
+}
+
+auto MqttCodec::packetIdOf(const MqttPacket &packet) noexcept -> std::optional<uint16_t> {
+  if (packet.type != MqttPacketType::PUBACK && packet.type != MqttPacketType::SUBACK)
+    return std::nullopt;
+  Reader reader(packet.body);
+  const auto packetId = reader.u16();
+  if (reader.failed())
+    return std::nullopt;
+  return packetId;
+}
+
+MqttSession::MqttSession(const uint16_t keepAlive) noexcept
+    : keepAlive(keepAlive), lastId(subscribeId), unacked(std::nullopt), unackedHash(0), lastSent(0), pingSent(0), pinging(false) {
+  IOP_TRACE();
+}
+
+auto MqttSession::publishing(const std::string_view topic, const std::string_view payload) noexcept -> std::pair<uint16_t, bool> {
+  const auto hash = hashOf(topic, payload);
+  if (this->unacked.has_value() && this->unackedHash == hash)
+    return std::make_pair(*this->unacked, true);
+
+  // 0 is invalid and `subscribeId` is taken
+  this->lastId = this->lastId == UINT16_MAX ? subscribeId + 1 : this->lastId + 1;
+  this->unacked = this->lastId;
+  this->unackedHash = hash;
+  return std::make_pair(this->lastId, false);
+}
+
+auto MqttSession::acked(const uint16_t packetId) noexcept -> bool {
+  if (this->unacked != packetId)
+    return false;
+  this->unacked.reset();
+  return true;
+}
+
+void MqttSession::connected(const esp_time now) noexcept {
+  this->lastSent = now;
+  this->pinging = false;
+}
+
+void MqttSession::sent(const esp_time now) noexcept { this->lastSent = now; }
+
+void MqttSession::pinged(const esp_time now) noexcept {
+  this->pinging = true;
+  this->pingSent = now;
+  this->lastSent = now;
+}
+
+void MqttSession::ponged() noexcept { this->pinging = false; }
+
+auto MqttSession::shouldPing(const esp_time now) const noexcept -> bool {
+  return this->keepAlive > 0 && !this->pinging && now - this->lastSent >= static_cast<esp_time>(this->keepAlive) * 500;
+}
+
+auto MqttSession::isDead(const esp_time now) const noexcept -> bool {
+  return this->keepAlive > 0 && this->pinging && now - this->pingSent >= static_cast<esp_time>(this->keepAlive) * 1000;
+}
+
+MqttClient::MqttClient(WiFiClient &client, const uint16_t keepAlive, const esp_time timeout) noexcept
+    : client(&client), session(keepAlive), timeout(timeout), handler(nullptr), output({}), input({}), inputLength(0), skip(0),
+      connected_(false) {
+  IOP_TRACE();
+}
+
+auto MqttClient::connect(const std::string_view host, const uint16_t port, const MqttConnect &connect,
+                         const std::optional<std::string_view> subscription) noexcept -> MqttStatus {
+  IOP_TRACE();
+  if (this->isConnected())
+    return MqttStatus::OK;
+  this->drop();
+
+  // Arduino's client needs it null terminated
+  std::array<char, 64> host_ = {};
+  if (host.length() >= host_.size())
+    return MqttStatus::CLIENT_BUFFER_OVERFLOW;
+  memcpy(host_.data(), host.data(), host.length());
+  if (!this->client->connect(host_.data(), port)) {
+    logger().warn(F("Unable to connect to "), host);
+    return MqttStatus::CONNECTION_ISSUES;
+  }
+
+  // Persistent session, so the broker keeps the subscriptions and queues what's
+  // published to them while offline
+  auto packet = connect;
+  packet.cleanSession = false;
+  packet.keepAlive = this->session.keepAliveSeconds();
+  auto status = this->send(MqttCodec::connect(packet, this->output));
+  if (status != MqttStatus::OK)
+    return status;
+
+  const auto connack = this->receive(MqttPacketType::CONNACK, 0);
+  if (iop::is_err(connack))
+    return iop::unwrap_err_ref(connack, IOP_CTX());
+  const auto &ack = iop::unwrap_ok_ref(connack, IOP_CTX());
+  if (ack.code != 0) {
+    logger().error(F("Broker refused connection: "), std::to_string(ack.code));
+    this->drop();
+    // 3 is server unavailable, 4 and 5 are bad credentials
+    if (ack.code == 3)
+      return MqttStatus::CONNECTION_ISSUES;
+    if (ack.code == 4 || ack.code == 5)
+      return MqttStatus::FORBIDDEN;
+    return MqttStatus::BROKEN_SERVER;
+  }
+  this->connected_ = true;
+  this->session.connected(driver::thisThread.now());
+  logger().debug(F("Connected, session present: "), std::to_string(ack.sessionPresent));
+
+  if (ack.sessionPresent || !subscription.has_value())
+    return MqttStatus::OK;
+
+  status = this->send(MqttCodec::subscribe(MqttSubscription { subscribeId, *subscription, 1 }, this->output));
+  if (status != MqttStatus::OK)
+    return status;
+  const auto suback = this->receive(MqttPacketType::SUBACK, subscribeId);
+  if (iop::is_err(suback))
+    return iop::unwrap_err_ref(suback, IOP_CTX());
+  if (iop::unwrap_ok_ref(suback, IOP_CTX()).code == 0x80) {
+    logger().error(F("Broker refused subscription to "), *subscription);
+    return MqttStatus::FORBIDDEN;
+  }
+  return MqttStatus::OK;
+}
+
+auto MqttClient::publish(const std::string_view topic, const std::string_view payload) noexcept -> MqttStatus {
+  IOP_TRACE();
+  if (!this->isConnected())
+    return MqttStatus::CONNECTION_ISSUES;
+
+  const auto [packetId, dup] = this->session.publishing(topic, payload);
+  const auto status = this->send(MqttCodec::publish(MqttMessage { topic, payload, packetId, 1, false, dup }, this->output));
+  if (status != MqttStatus::OK)
+    return status;
+
+  const auto puback = this->receive(MqttPacketType::PUBACK, packetId);
+  if (iop::is_err(puback))
+    return iop::unwrap_err_ref(puback, IOP_CTX());
+  this->session.acked(packetId);
+  return MqttStatus::OK;
+}
+
+void MqttClient::poll() noexcept {
+  IOP_TRACE();
+  if (!this->isConnected())
+    return;
+
+  const auto received = this->receive(std::nullopt, 0);
+  if (iop::is_err(received) && iop::unwrap_err_ref(received, IOP_CTX()) != MqttStatus::OK)
+    return;
+
+  const auto now = driver::thisThread.now();
+  if (this->session.isDead(now)) {
+    logger().warn(F("Broker didn't answer ping, reconnecting"));
+    this->drop();
+  } else if (this->session.shouldPing(now) && this->send(MqttCodec::pingreq(this->output)) == MqttStatus::OK) {
+    this->session.pinged(now);
+  }
+}
+
+void MqttClient::disconnect() noexcept {
+  IOP_TRACE();
+  if (this->isConnected())
+    this->send(MqttCodec::disconnect(this->output));
+  this->drop();
+}
+
+auto MqttClient::isConnected() noexcept -> bool {
+  return this->connected_ && this->client->connected();
+}
+
+auto MqttClient::send(const std::optional<size_t> size) noexcept -> MqttStatus {
+  if (!size.has_value()) {
+    logger().error(F("Packet doesn't fit MqttClient::outputCapacity"));
+    return MqttStatus::CLIENT_BUFFER_OVERFLOW;
+  }
+  const auto written = this->client->write(reinterpret_cast<const uint8_t *>(this->output.data()), *size);
+  if (written != *size) {
+    logger().warn(F("Unable to send packet"));
+    this->drop();
+    return MqttStatus::CONNECTION_ISSUES;
+  }
+  this->session.sent(driver::thisThread.now());
+  return MqttStatus::OK;
+}
+
+auto MqttClient::receive(const std::optional<MqttPacketType> until, const uint16_t packetId) noexcept
+    -> std::variant<Ack, MqttStatus> {
+  const auto start = driver::thisThread.now();
+  while (true) {
+    while (this->inputLength > 0) {
+      const auto input = std::string_view(this->input.data(), this->inputLength);
+      const auto decoded = MqttCodec::decode(input);
+      if (iop::is_err(decoded) && iop::unwrap_err_ref(decoded, IOP_CTX()) == MqttDecodeError::MALFORMED) {
+        logger().error(F("Malformed packet"));
+        this->drop();
+        return MqttStatus::BROKEN_SERVER;
+      }
+      if (iop::is_err(decoded)) {
+        const auto header = fixedHeaderOf(input);
+        if (this->inputLength < this->input.size() || !header.has_value())
+          break;
+        // Only the retained upgrade is expected, and it's tiny
+        logger().warn(F("Discarding packet that doesn't fit MqttClient::inputCapacity"));
+        this->skip = header->first + header->second - this->inputLength;
+        this->inputLength = 0;
+        break;
+      }
+
+      const auto &packet = iop::unwrap_ok_ref(decoded, IOP_CTX());
+      std::optional<Ack> ack;
+      if (until.has_value() && packet.type == *until && (packetId == 0 || MqttCodec::packetIdOf(packet) == packetId)) {
+        const auto connack = MqttCodec::connackOf(packet);
+        const auto code = packet.type == MqttPacketType::SUBACK && packet.body.length() > 2 ? packet.body.at(2) : 0;
+        ack = Ack { packetId, connack.has_value() && connack->first, connack.has_value() ? connack->second : static_cast<uint8_t>(code) };
+      } else {
+        // Failures drop the connection, and the input with it
+        const auto status = this->handle(packet);
+        if (status != MqttStatus::OK)
+          return status;
+      }
+
+      const auto size = packet.size;
+      memmove(this->input.data(), this->input.data() + size, this->inputLength - size);
+      this->inputLength -= size;
+      if (ack.has_value())
+        return *ack;
+    }
+
+    if (!this->client->connected()) {
+      logger().warn(F("Broker closed the connection"));
+      this->drop();
+      return MqttStatus::CONNECTION_ISSUES;
+    }
+    if (this->client->available() <= 0) {
+      if (!until.has_value())
+        return MqttStatus::OK;
+      if (driver::thisThread.now() - start >= this->timeout) {
+        logger().warn(F("Broker timed out"));
+        this->drop();
+        return MqttStatus::CONNECTION_ISSUES;
+      }
+      driver::thisThread.yield();
+      continue;
+    }
+
+    auto *const free = reinterpret_cast<uint8_t *>(this->input.data() + this->inputLength);
+    const auto read = this->client->read(free, this->input.size() - this->inputLength);
+    if (read <= 0)
+      continue;
+    auto length = static_cast<size_t>(read);
+    if (this->skip > 0) {
+      const auto discarded = std::min(length, this->skip);
+      memmove(this->input.data(), this->input.data() + discarded, length - discarded);
+      this->skip -= discarded;
+      length -= discarded;
+    }
+    this->inputLength += length;
+  }
+}
+
+auto MqttClient::handle(const MqttPacket &packet) noexcept -> MqttStatus {
+  switch (packet.type) {
+  case MqttPacketType::PUBLISH: {
+    const auto message = MqttCodec::messageOf(packet);
+    if (!message.has_value()) {
+      logger().error(F("Invalid PUBLISH"));
+      this->drop();
+      return MqttStatus::BROKEN_SERVER;
+    }
+    logger().debug(F("Received message at "), message->topic);
+    if (this->handler != nullptr)
+      this->handler(message->topic, message->payload);
+    // Acknowledged after it's handled, otherwise it could be lost
+    if (message->qos > 0)
+      return this->send(MqttCodec::puback(message->packetId, this->output));
+    return MqttStatus::OK;
+  }
+  case MqttPacketType::PINGRESP:
+    this->session.ponged();
+    return MqttStatus::OK;
+  default:
+    // Acknowledgements of something that already timed out
+    logger().debug(F("Ignoring packet: "), std::to_string(static_cast<uint8_t>(packet.type)));
+    return MqttStatus::OK;
+  }
+}
+
+void MqttClient::drop() noexcept {
+  this->client->stop();
+  this->connected_ = false;
+  this->inputLength = 0;
+  this->skip = 0;
+}
+} // namespace iop
@@ -8,13 +8,164 @@
 #include "driver/client.hpp"
 #include "core/panic.hpp"
 #include "core/cert_store.hpp"
+#include "core/tls_session.hpp"
+#include "core/headers.hpp"
+#include "core/retry.hpp"
+#include "core/deflate.hpp"
+#include "core/timing.hpp"
+#include "core/mqtt.hpp"
+#include "core/request.hpp"
 #include "string.h"
 #include "loop.hpp"
 
 constexpr static iop::UpgradeHook defaultHook(iop::UpgradeHook::defaultHook);
 
 static iop::UpgradeHook hook(defaultHook);
+static std::optional<iop::MD5Hash> latestVersion_;
 static iop::CertStore * maybeCertStore = nullptr;;
+static iop::ConnectionManager connection(config::connectionIdleTimeout, config::connectionMaxRequests);
+// Lives in the BSS, so building requests doesn't touch the heap
+static iop::HeaderBuilder requestHeaders;
+static iop::RetryPolicy retry(config::retryBaseDelay, config::retryMaxDelay, config::circuitBreakerThreshold,
+                              config::circuitBreakerCooldown);
+#ifdef IOP_COMPRESSION
+static iop::Deflate deflate;
+// Bigger bodies are sent uncompressed
+static std::array<char, 1024> compressedBody;
+static bool compressionSupported = true;
+static iop::CompressionStats compression = { 0, 0, 0 };
+#endif
+#ifdef IOP_NETWORK_TIMING
+static iop::NetworkTimings timings;
+#endif
+// Requests started by `Network::start` share the client with the blocking
+// ones, another TLS session wouldn't fit in RAM. So they can't overlap
+static auto asyncRequest() noexcept -> iop::HttpRequest & {
+  static iop::HttpRequest request(unused4KbSysStack.client());
+  return request;
+}
+static iop::RequestCallback asyncCallback = nullptr;
+static uint32_t asyncId = 0;
+static iop::esp_time asyncStartedAt = 0;
+// Retries are keyed by it, `requestHeaders` is reused while it's in flight
+static std::array<char, iop::HeaderBuilder::uriCapacity + 1> asyncEndpoint;
+
+#ifdef IOP_MQTT
+// Separate from the HTTP client, since both connections stay open
+#ifdef IOP_SSL
+static BearSSL::WiFiClientSecure mqttWifiClient;
+#else
+static WiFiClient mqttWifiClient;
+#endif
+static iop::MqttClient mqtt(mqttWifiClient, config::mqttKeepAlive, 60 * 1000);
+static std::array<char, 64> mqttTopic;
+static std::array<char, 64> mqttUpdateTopic;
+#endif
+
+/// Writes the response body straight into a fixed buffer, instead of
+/// `HTTPClient::getString` that allocates it all in the heap. Whatever doesn't
+/// fit is still read, so the connection can be reused, but it's discarded
+class BodyStream : public Stream {
+  iop::Span<char> buffer;
+  size_t length;
+  bool overflow;
+
+public:
+  explicit BodyStream(const iop::Span<char> buffer) noexcept: buffer(buffer), length(0), overflow(false) {}
+
+  auto write(const uint8_t byte) noexcept -> size_t override { return this->write(&byte, 1); }
+  auto write(const uint8_t *data, const size_t size) noexcept -> size_t override {
+    const auto unused = this->buffer.subspan(this->length);
+    const auto count = size < unused.size() ? size : unused.size();
+    if (count > 0)
+      memcpy(unused.begin(), data, count);
+    this->length += count;
+    // Without a buffer the body is discarded, it isn't an overflow
+    this->overflow |= count < size && !this->buffer.isEmpty();
+    return size;
+  }
+  auto available() noexcept -> int override { return 0; }
+  auto read() noexcept -> int override { return -1; }
+  auto peek() noexcept -> int override { return -1; }
+  void flush() noexcept override {}
+
+  auto view() const noexcept -> std::string_view { return std::string_view(this->buffer.begin(), this->length); }
+  auto overflowed() const noexcept -> bool { return this->overflow; }
+};
+
+/// Failures that must be retried later, the others mean the server answered
+static auto failureOf(const int code) noexcept -> std::optional<iop::RetryFailure> {
+  if (code == HTTPC_ERROR_NO_HTTP_SERVER || code == HTTPC_ERROR_ENCODING || code >= HTTP_CODE_INTERNAL_SERVER_ERROR)
+    return iop::RetryFailure::BROKEN_SERVER;
+  if (code < 0 || code == HTTP_CODE_TOO_MANY_REQUESTS)
+    return iop::RetryFailure::TRANSIENT;
+  return std::nullopt;
+}
+
+/// Only delay-seconds are supported, HTTP-dates are ignored
+static auto retryAfterOf(const char *header) noexcept -> std::optional<iop::esp_time> {
+  if (*header == '\0')
+    return std::nullopt;
+  char *end = nullptr;
+  const auto seconds = strtoul(header, &end, 10);
+  if (end == nullptr || *end != '\0')
+    return std::nullopt;
+  return static_cast<iop::esp_time>(seconds) * 1000;
+}
+
+#ifdef IOP_NETWORK_TIMING
+#ifndef IOP_DESKTOP
+/// HTTPClient resolves the host inside `sendRequest`. Resolving it before (lwIP
+/// caches it) tells the DNS lookup apart from the rest
+static void resolve(const std::string_view uri) noexcept {
+  const auto scheme = uri.find("://");
+  if (scheme == std::string_view::npos)
+    return;
+  auto host = uri.substr(scheme + 3);
+  host = host.substr(0, host.find_first_of(":/"));
+
+  std::array<char, 64> name = {};
+  if (host.length() >= name.size())
+    return;
+  memcpy(name.data(), host.data(), host.length());
+  IPAddress address;
+  WiFi.hostByName(name.data(), address);
+  iop::requestTimer().mark(iop::RequestPhase::DNS, driver::thisThread.now());
+}
+#endif
+
+/// Closes the last phase and records the request
+static void recordTiming(const iop::Log &logger, const std::string_view path) noexcept {
+  auto &timer = iop::requestTimer();
+  if (!timer.isRunning())
+    return;
+  timer.mark(iop::RequestPhase::BODY, driver::thisThread.now());
+  const auto timing = timer.stop();
+  timings.record(path, timing);
+  logger.debug(F("Timing (ms) of "), path, F(", DNS: "), std::to_string(timing.at(0)), F(", connect: "),
+               std::to_string(timing.at(1)), F(", TLS: "), std::to_string(timing.at(2)), F(", first byte: "),
+               std::to_string(timing.at(3)), F(", body: "), std::to_string(timing.at(4)));
+}
+#endif
+
+/// Every response carries the MD5 of the latest firmware
+static void checkUpgrade(const iop::Log &logger, const std::string_view upgrade) noexcept {
+  if (upgrade.length() == 32) {
+    iop::MD5Hash latest;
+    memcpy(latest.data(), upgrade.data(), latest.size());
+    latestVersion_ = latest;
+  }
+  if (upgrade.length() > 0 && memcmp(upgrade.data(), driver::device.binaryMD5().data(), 32) != 0) {
+    logger.info(F("Scheduled upgrade"));
+    hook.schedule();
+  }
+}
+
+/// Errors of a kept-alive connection that the server closed while idle
+static auto isStaleConnection(const int code) noexcept -> bool {
+  return code == HTTPC_ERROR_SEND_HEADER_FAILED || code == HTTPC_ERROR_SEND_PAYLOAD_FAILED ||
+         code == HTTPC_ERROR_NOT_CONNECTED || code == HTTPC_ERROR_CONNECTION_LOST;
+}
 
 namespace iop {
 void UpgradeHook::defaultHook() noexcept { IOP_TRACE(); }
@@ -29,6 +180,7 @@ auto Network::takeUpgradeHook() noexcept -> UpgradeHook {
   hook = defaultHook;
   return old;
 }
+auto Network::latestVersion() noexcept -> std::optional<MD5Hash> { return latestVersion_; }
 
 auto Network::isConnected() noexcept -> bool {
   IOP_TRACE();
@@ -47,18 +199,34 @@ auto Network::setup() const noexcept -> void {
     return;
   initialized = true;
 
-  unused4KbSysStack.http().setReuse(false);
+  // Requests in bursts share the connection, check `ConnectionManager`
+  unused4KbSysStack.http().setReuse(true);
+
+  const char *headers[] = {PSTR("LATEST_VERSION"), PSTR("Retry-After")};
+  unused4KbSysStack.http().collectHeaders(headers, 2);
+  // Compared in RAM, so they can't be PSTRs
+  asyncRequest().collect("LATEST_VERSION");
+  asyncRequest().collect("Retry-After");
+  requestHeaders.setup(driver::device.binaryMD5(), driver::device.macAddress());
 
-  const char *headers[] = {PSTR("LATEST_VERSION")};
-  unused4KbSysStack.http().collectHeaders(headers, 1);
+  // Each device must back off differently, otherwise they retry in sync
+  uint32_t seed = static_cast<uint32_t>(driver::thisThread.now());
+  for (const auto c: driver::device.macAddress()) {
+    seed ^= static_cast<uint8_t>(c);
+    seed *= 16777619UL;
+  }
+  retry.seed(seed);
 
   unused4KbSysStack.client().setNoDelay(false);
-  unused4KbSysStack.client().setSync(true);
 
 #ifdef IOP_SSL
   iop_assert(maybeCertStore != nullptr, F("Must call Network::setCertStore before Network::setup for SSL support"));
   //unused4KbSysStack.client().setCertStore(maybeCertStore);
   unused4KbSysStack.client().setInsecure(); // TODO: remove this (what the frick)
+#ifdef IOP_MQTT
+  mqttWifiClient.setInsecure();
+#endif
+  TlsSessionCache::setup();
 #endif
 
   WiFi.persistent(false);
@@ -104,12 +272,39 @@ static auto methodToString(const HttpMethod &method) noexcept
 }
 
 auto Network::wifiClient() noexcept -> WiFiClient & { return unused4KbSysStack.client(); }
+auto Network::connectionStats() noexcept -> ConnectionStats { return connection.stats(); }
+#ifdef IOP_COMPRESSION
+auto Network::compressionStats() noexcept -> CompressionStats { return compression; }
+#else
+auto Network::compressionStats() noexcept -> CompressionStats { return (CompressionStats) { 0, 0, 0 }; }
+#endif
+auto Network::retryState() noexcept -> RetryState { return retry.state(driver::thisThread.now()); }
+#ifdef IOP_NETWORK_TIMING
+auto Network::timingMetrics(const Span<char> output) noexcept -> std::optional<std::string_view> {
+  return timings.serialize(output);
+}
+#else
+auto Network::timingMetrics(const Span<char> output) noexcept -> std::optional<std::string_view> {
+  (void)output;
+  return std::nullopt;
+}
+#endif
+auto Network::jitter(const esp_time delay) noexcept -> esp_time { return retry.jitter(delay); }
+
+auto Network::retryIn(const StaticString path) const noexcept -> esp_time {
+  IOP_TRACE();
+  if (!requestHeaders.setUri(this->uri(), path))
+    return 0;
+  return retry.waitFor(std::string_view(requestHeaders.uri()), driver::thisThread.now());
+}
 
 // Returns Response if it can understand what the server sent, int is the raw
 // response given by ESP8266HTTPClient
 auto Network::httpRequest(const HttpMethod method_,
                           const std::optional<std::string_view> &token, StaticString path,
-                          const std::optional<std::string_view> &data) const noexcept
+                          const std::optional<std::string_view> &data,
+                          StaticString contentType, const Span<char> body,
+                          const std::optional<std::string_view> &ifNoneMatch) const noexcept
     -> std::variant<Response, int> const & {
   IOP_TRACE();
   Network::setup();
@@ -119,13 +314,35 @@ auto Network::httpRequest(const HttpMethod method_,
     return unused4KbSysStack.response();
   }
 
-  #ifdef IOP_DESKTOP
-  const auto uri = this->uri().toString() + path.asCharPtr();
-  #else
-  const auto uri = String(this->uri().get()) + path.get();
-  #endif
+  if (asyncRequest().isInFlight()) {
+    this->logger.warn(F("Another request is in flight, unable to send "), path);
+    unused4KbSysStack.response() = Response(NetworkStatus::CONNECTION_ISSUES);
+    return unused4KbSysStack.response();
+  }
+
+  if (!requestHeaders.setUri(this->uri(), path)) {
+    this->logger.error(F("URI doesn't fit HeaderBuilder::uriCapacity: "), path);
+    unused4KbSysStack.response() = Response(NetworkStatus::CLIENT_BUFFER_OVERFLOW);
+    return unused4KbSysStack.response();
+  }
+  if (!requestHeaders.setAuthorization(token)) {
+    this->logger.error(F("Token doesn't fit HeaderBuilder::tokenCapacity"));
+    unused4KbSysStack.response() = Response(NetworkStatus::CLIENT_BUFFER_OVERFLOW);
+    return unused4KbSysStack.response();
+  }
   const auto method = iop::unwrap_ref(methodToString(method_), IOP_CTX());
 
+  // Points to `requestHeaders`, it's valid until the next request
+  const auto endpoint = std::string_view(requestHeaders.uri());
+  const auto now = driver::thisThread.now();
+  if (!retry.attempt(endpoint, now)) {
+    const auto state = retry.state(now);
+    this->logger.warn(F("Backing off "), endpoint, F(", next attempt in (ms): "), std::to_string(retry.waitFor(endpoint, now)),
+                      state.breakerOpen ? F(", circuit breaker is open") : F(""));
+    unused4KbSysStack.response() = Response(NetworkStatus::CONNECTION_ISSUES);
+    return unused4KbSysStack.response();
+  }
+
   std::string_view data_;
   if (data.has_value())
     data_ = iop::unwrap_ref(data, IOP_CTX());
@@ -134,65 +351,129 @@ auto Network::httpRequest(const HttpMethod method_,
 
   // TODO: this may log sensitive information, network logging is currently
   // capped at info because of that, right
-  if (data.has_value())
-    this->logger.debug(iop::unwrap_ref(data, IOP_CTX()));
+  if (data.has_value() && iop::isAllPrintable(data_))
+    this->logger.debug(data_);
 
-  if (token.has_value()) {
-    const auto tok = iop::unwrap_ref(token, IOP_CTX());
-    unused4KbSysStack.http().setAuthorization(std::string(tok).c_str());
-  } else {
-    // We have to clear the authorization, it persists between requests
-    unused4KbSysStack.http().setAuthorization("");
+  bool compressed = false;
+#ifdef IOP_COMPRESSION
+  if (compressionSupported && data_.length() >= config::compressionThreshold) {
+    const auto length = deflate.gzip(data_, compressedBody);
+    if (length.has_value() && *length < data_.length()) {
+      compression.requests++;
+      compression.bytesIn += static_cast<uint32_t>(data_.length());
+      compression.bytesOut += static_cast<uint32_t>(*length);
+      this->logger.debug(F("Compressed body to (bytes): "), std::to_string(*length), F(", ratio since boot: "),
+                         std::to_string(static_cast<uint64_t>(compression.bytesOut) * 100 / compression.bytesIn), F("%"));
+      data_ = std::string_view(compressedBody.data(), *length);
+      compressed = true;
+    }
   }
+#endif
 
   // We can afford bigger timeouts since we shouldn't make frequent requests
   constexpr uint32_t oneMinuteMs = 60 * 1000;
   unused4KbSysStack.http().setTimeout(oneMinuteMs);
 
   logMemory(this->logger);
-  // Currently only JSON is supported
-  if (data.has_value())
-    unused4KbSysStack.http().addHeader(F("Content-Type"), F("application/json"));
 
-  // Authentication headers, identifies device and detects updates, perf
-  // monitoring
-  {
-    auto str = String();
-    str.concat(driver::device.binaryMD5().begin(), 32);
-    unused4KbSysStack.http().addHeader(F("VERSION"), str);
-
-    str.clear();
-    str.concat(driver::device.macAddress().begin(), 17);
-    unused4KbSysStack.http().addHeader(F("MAC_ADDRESS"), str);
-  }
- 
-  unused4KbSysStack.http().addHeader(F("FREE_STACK"), std::to_string(driver::device.availableStack()).c_str());
-  unused4KbSysStack.http().addHeader(F("FREE_HEAP"), std::to_string(driver::device.availableHeap()).c_str());
-  unused4KbSysStack.http().addHeader(F("BIGGEST_FREE_BLOCK"), std::to_string(driver::device.biggestHeapBlock()).c_str());
-  unused4KbSysStack.http().addHeader(F("VCC"), std::to_string(driver::device.vcc()).c_str());
-  unused4KbSysStack.http().addHeader(F("TIME_RUNNING"), std::to_string(driver::thisThread.now()).c_str());
+  auto reused = connection.canReuse(now, Network::wifiClient().connected());
+  if (!reused && Network::wifiClient().connected()) {
+    this->logger.debug(F("Closing kept-alive connection"));
+    Network::wifiClient().stop();
+  }
+
+#ifdef IOP_NETWORK_TIMING
+  iop::requestTimer().start(driver::thisThread.now());
+#ifndef IOP_DESKTOP
+  if (!reused)
+    resolve(endpoint);
+#endif
+#endif
 
+  // `Network::start` makes it asynchronous
+  Network::wifiClient().setSync(true);
   this->logger.debug(F("Begin"));
-  if (!unused4KbSysStack.http().begin(Network::wifiClient(), uri)) {
-    this->logger.warn(F("Failed to begin http connection to "), iop::to_view(uri));
+  if (!unused4KbSysStack.http().begin(Network::wifiClient(), requestHeaders.uri())) {
+    this->logger.warn(F("Failed to begin http connection to "), std::string_view(requestHeaders.uri()));
     unused4KbSysStack.response() = Response(NetworkStatus::CONNECTION_ISSUES);
     return unused4KbSysStack.response();
   }
   this->logger.trace(F("Began HTTP connection"));
 
+  // `begin` clears the headers of the previous request, so they must come after it.
+  // The authorization persists between requests, so it's always set, even if empty
+  unused4KbSysStack.http().setAuthorization(requestHeaders.authorization());
+  if (data.has_value())
+    unused4KbSysStack.http().addHeader(F("Content-Type"), std::move(contentType).get());
+  if (compressed)
+    unused4KbSysStack.http().addHeader(F("Content-Encoding"), F("gzip"));
+
+  // Authentication headers, identifies device and detects updates, perf
+  // monitoring
+  const auto fits = requestHeaders.setDeviceStats(driver::device.availableStack(), driver::device.availableHeap(),
+                                           driver::device.biggestHeapBlock(), driver::device.vcc(), now);
+  iop_assert(fits, F("HeaderBuilder::capacity is too small"));
+  if (ifNoneMatch.has_value() && !requestHeaders.setIfNoneMatch(*ifNoneMatch)) {
+    this->logger.error(F("Entity tag doesn't fit HeaderBuilder::capacity"));
+    unused4KbSysStack.http().end();
+    unused4KbSysStack.response() = Response(NetworkStatus::CLIENT_BUFFER_OVERFLOW);
+    return unused4KbSysStack.response();
+  }
+  requestHeaders.forEach([](const char *name, const char *value) {
+    unused4KbSysStack.http().addHeader(name, value);
+  });
+
   const auto *const data__ = reinterpret_cast<const uint8_t *>(data_.begin());
 
   this->logger.debug(F("Making HTTP request"));
-  const auto code =
-      unused4KbSysStack.http().sendRequest(method.toString().c_str(), data__, data_.length());
-  this->logger.debug(F("Made HTTP request")); 
+  if (!reused)
+    TlsSessionCache::beforeHandshake();
+  auto code = unused4KbSysStack.http().sendRequest(method.toString().c_str(), data__, data_.length());
+  if (reused && isStaleConnection(code)) {
+    // Servers drop the request when closing an idle connection, so it's safe to send it again
+    this->logger.debug(F("Kept-alive connection was closed by the server, reconnecting"));
+    Network::wifiClient().stop();
+    connection.reconnected();
+    reused = false;
+    TlsSessionCache::beforeHandshake();
+#ifdef IOP_NETWORK_TIMING
+    iop::requestTimer().start(driver::thisThread.now());
+#endif
+    code = unused4KbSysStack.http().sendRequest(method.toString().c_str(), data__, data_.length());
+  }
+#ifdef IOP_NETWORK_TIMING
+  iop::requestTimer().mark(RequestPhase::FIRST_BYTE, driver::thisThread.now());
+#endif
+  if (!reused)
+    TlsSessionCache::afterHandshake(code != HTTPC_ERROR_CONNECTION_FAILED);
+  connection.sent(now, reused);
+  const auto handshakes = TlsSessionCache::stats();
+  this->logger.debug(F("Made HTTP request, connection reuse rate: "), std::to_string(connection.hitRate()),
+                     F("%, TLS handshakes resumed: "), std::to_string(handshakes.resumed),
+                     F(", full: "), std::to_string(handshakes.full));
+
+  const auto failure = failureOf(code);
+  if (failure.has_value()) {
+    const auto retryAfter = unused4KbSysStack.http().header(PSTR("Retry-After"));
+    retry.failed(endpoint, now, *failure, retryAfterOf(retryAfter.c_str()));
+    this->logger.warn(F("Request failed, retrying "), endpoint, F(" in (ms): "), std::to_string(retry.waitFor(endpoint, now)));
+  } else {
+    retry.succeeded(endpoint);
+  }
+
+#ifdef IOP_COMPRESSION
+  if (compressed && code == HTTP_CODE_UNSUPPORTED_MEDIA_TYPE) {
+    // Otherwise the caller would think it's its Content-Type that isn't supported
+    this->logger.warn(F("Server doesn't support gzipped bodies, sending them uncompressed until reboot"));
+    compressionSupported = false;
+    unused4KbSysStack.http().end();
+    return this->httpRequest(method_, token, path, data, contentType, body, ifNoneMatch);
+  }
+#endif
 
   // Handle system upgrade request
   const auto upgrade = unused4KbSysStack.http().header(PSTR("LATEST_VERSION"));
-  if (upgrade.length() > 0 && memcmp(upgrade.c_str(), driver::device.binaryMD5().data(), 32) != 0) {
-    this->logger.info(F("Scheduled upgrade"));
-    hook.schedule();
-  }
+  checkUpgrade(this->logger, std::string_view(upgrade.c_str(), upgrade.length()));
 
   const auto rawStatus = this->rawStatus(code);
   const auto rawStatusStr = Network::rawStatusToString(rawStatus);
@@ -200,10 +481,12 @@ auto Network::httpRequest(const HttpMethod method_,
   this->logger.info(F("Response code ("), std::to_string(code), F("): "), rawStatusStr);
 
   constexpr const int32_t maxPayloadSizeAcceptable = 2048;
-  if (unused4KbSysStack.http().getSize() > maxPayloadSizeAcceptable) {
+  // Answers to HEAD describe a body that isn't sent
+  const auto headless = method_ == HttpMethod::HEAD;
+  const auto size = headless ? 0 : unused4KbSysStack.http().getSize();
+  if (size > maxPayloadSizeAcceptable) {
     unused4KbSysStack.http().end();
-    const auto lengthStr = std::to_string(unused4KbSysStack.http().getSize());
-    this->logger.error(F("Payload from server was too big: "), lengthStr);
+    this->logger.error(F("Payload from server was too big: "), std::to_string(size));
     unused4KbSysStack.response() = Response(NetworkStatus::BROKEN_SERVER);
     return unused4KbSysStack.response();
   }
@@ -213,17 +496,271 @@ auto Network::httpRequest(const HttpMethod method_,
   if (maybeApiStatus.has_value()) {
     // The payload is always downloaded, since we check for its size and the
     // origin is trusted. If it's there it's supposed to be there.
-    auto payload = unused4KbSysStack.http().getString();
+    BodyStream stream(body);
+    const auto written = headless ? 0 : unused4KbSysStack.http().writeToStream(&stream);
     unused4KbSysStack.http().end();
-    this->logger.debug(F("Payload (") , std::to_string(payload.length()), F("): "), iop::to_view(payload));
-    // TODO: every response occupies 2x the size because we convert String -> std::string
-    unused4KbSysStack.response() = Response(iop::unwrap_ref(maybeApiStatus, IOP_CTX()), std::string(payload.c_str()));
+#ifdef IOP_NETWORK_TIMING
+    recordTiming(this->logger, endpoint.substr(this->uri().length()));
+#endif
+
+    // Empty bodies may be reported as a closed connection
+    if (written < 0 && size != 0) {
+      this->logger.error(F("Unable to read payload: "), std::to_string(written));
+      unused4KbSysStack.response() = Response(NetworkStatus::CONNECTION_ISSUES);
+      return unused4KbSysStack.response();
+    }
+    if (stream.overflowed()) {
+      this->logger.error(F("Payload doesn't fit the buffer ("), std::to_string(body.size()), F(" bytes)"));
+      unused4KbSysStack.response() = Response(NetworkStatus::BROKEN_SERVER);
+      return unused4KbSysStack.response();
+    }
+
+    const auto status = iop::unwrap_ref(maybeApiStatus, IOP_CTX());
+    if (body.isEmpty()) {
+      unused4KbSysStack.response() = Response(status);
+      return unused4KbSysStack.response();
+    }
+    const auto payload = stream.view();
+    this->logger.debug(F("Payload (") , std::to_string(payload.length()), F("): "), payload);
+    unused4KbSysStack.response() = Response(status, payload);
     return unused4KbSysStack.response();
   }
   unused4KbSysStack.http().end();
+#ifdef IOP_NETWORK_TIMING
+  recordTiming(this->logger, endpoint.substr(this->uri().length()));
+#endif
   unused4KbSysStack.response() = code;
   return unused4KbSysStack.response();
 }
+
+auto Network::start(const HttpMethod method_, const std::optional<std::string_view> &token, const StaticString path,
+                    const std::optional<std::string_view> &data, const StaticString contentType, const Span<char> body,
+                    const RequestCallback callback) const noexcept -> std::variant<RequestHandle, NetworkStatus> {
+  IOP_TRACE();
+  Network::setup();
+
+  if (!Network::isConnected())
+    return NetworkStatus::CONNECTION_ISSUES;
+  if (asyncRequest().isInFlight()) {
+    this->logger.warn(F("Another request is in flight, unable to start "), path);
+    return NetworkStatus::CONNECTION_ISSUES;
+  }
+
+  if (!requestHeaders.setUri(this->uri(), path)) {
+    this->logger.error(F("URI doesn't fit HeaderBuilder::uriCapacity: "), path);
+    return NetworkStatus::CLIENT_BUFFER_OVERFLOW;
+  }
+  const auto endpoint = std::string_view(requestHeaders.uri());
+  const auto now = driver::thisThread.now();
+  memcpy(asyncEndpoint.data(), endpoint.data(), endpoint.length() + 1);
+
+  const auto method = iop::unwrap_ref(methodToString(method_), IOP_CTX());
+  auto fits = asyncRequest().begin(std::string_view(method.asCharPtr(), method.length()), endpoint);
+  if (method_ == HttpMethod::HEAD)
+    asyncRequest().expectNoBody();
+
+  // Like HTTPClient::setAuthorization
+  const auto token_ = token.value_or(std::string_view());
+  std::array<char, 6 + HeaderBuilder::tokenCapacity> authorization;
+  if (!token_.empty() && token_.length() <= HeaderBuilder::tokenCapacity) {
+    memcpy(authorization.data(), "Basic ", 6);
+    memcpy(authorization.data() + 6, token_.data(), token_.length());
+    fits = fits && asyncRequest().addHeader("Authorization", std::string_view(authorization.data(), 6 + token_.length()));
+  } else {
+    fits = fits && token_.empty();
+  }
+  if (data.has_value())
+    fits = fits && asyncRequest().addHeader("Content-Type", std::string_view(contentType.asCharPtr(), contentType.length()));
+
+  fits = fits && requestHeaders.setDeviceStats(driver::device.availableStack(), driver::device.availableHeap(),
+                                               driver::device.biggestHeapBlock(), driver::device.vcc(), now);
+  requestHeaders.forEach([&fits](const char *name, const char *value) {
+    fits = fits && asyncRequest().addHeader(name, value);
+  });
+
+  // Same as `httpRequest`'s, but the loop keeps running meanwhile
+  constexpr uint32_t oneMinuteMs = 60 * 1000;
+  // Writes must not wait for the acks, the client is shared with `httpRequest`
+  Network::wifiClient().setSync(false);
+  if (!fits || !asyncRequest().start(data.value_or(std::string_view()), body, oneMinuteMs, now)) {
+    this->logger.error(F("Request doesn't fit HttpRequest::headCapacity: "), path);
+    return NetworkStatus::CLIENT_BUFFER_OVERFLOW;
+  }
+  // Nothing was sent yet, the attempt is only counted if it's going to be
+  if (!retry.attempt(endpoint, now)) {
+    asyncRequest().cancel();
+    this->logger.warn(F("Backing off "), endpoint, F(", next attempt in (ms): "), std::to_string(retry.waitFor(endpoint, now)));
+    return NetworkStatus::CONNECTION_ISSUES;
+  }
+
+  // Same bookkeeping as `httpRequest`, the handshake is measured by `HttpRequest`
+  if (!connection.canReuse(now, Network::wifiClient().connected()) && Network::wifiClient().connected()) {
+    this->logger.debug(F("Closing kept-alive connection"));
+    Network::wifiClient().stop();
+  }
+  asyncStartedAt = now;
+
+  this->logger.info(F("Started "), method, F(" to "), this->uri(), path, F(", data length: "),
+                    std::to_string(data.value_or(std::string_view()).length()));
+  asyncCallback = callback;
+  asyncId++;
+  return RequestHandle { asyncId };
+}
+
+auto Network::poll() const noexcept -> bool {
+  IOP_TRACE();
+  if (!asyncRequest().isInFlight())
+    return false;
+  const auto now = driver::thisThread.now();
+  asyncRequest().step(now);
+  if (asyncRequest().isInFlight())
+    return true;
+
+  if (asyncRequest().reconnected())
+    connection.reconnected();
+  connection.sent(asyncStartedAt, asyncRequest().wasReused());
+
+  const auto endpoint = std::string_view(asyncEndpoint.data());
+  const auto code = asyncRequest().code();
+  const auto failure = failureOf(code);
+  if (failure.has_value()) {
+    // `retryAfterOf` needs it null terminated
+    std::array<char, 16> retryAfter = {};
+    const auto header = asyncRequest().header("Retry-After").value_or(std::string_view());
+    memcpy(retryAfter.data(), header.data(), std::min(header.length(), retryAfter.size() - 1));
+    retry.failed(endpoint, now, *failure, retryAfterOf(retryAfter.data()));
+    this->logger.warn(F("Request failed, retrying "), endpoint, F(" in (ms): "), std::to_string(retry.waitFor(endpoint, now)));
+  } else {
+    retry.succeeded(endpoint);
+  }
+  if (asyncRequest().state() == HttpRequest::State::DONE)
+    checkUpgrade(this->logger, asyncRequest().header("LATEST_VERSION").value_or(std::string_view()));
+
+  const auto rawStatus = this->rawStatus(code);
+  this->logger.info(F("Response code ("), std::to_string(code), F("): "), Network::rawStatusToString(rawStatus));
+
+  std::variant<Response, int> result(code);
+  const auto status = this->apiStatus(rawStatus);
+  if (status.has_value() && asyncRequest().overflowed()) {
+    this->logger.error(F("Payload doesn't fit the buffer"));
+    result = Response(NetworkStatus::BROKEN_SERVER);
+  } else if (status.has_value() && asyncRequest().payload().empty()) {
+    result = Response(*status);
+  } else if (status.has_value()) {
+    result = Response(*status, asyncRequest().payload());
+  }
+
+  // Cleared first, so it may start another request
+  const auto callback = asyncCallback;
+  asyncCallback = nullptr;
+  if (callback != nullptr)
+    callback(result);
+  return false;
+}
+
+auto Network::isPending(const RequestHandle handle) noexcept -> bool {
+  return asyncRequest().isInFlight() && handle.id == asyncId;
+}
+
+void Network::cancel(const RequestHandle handle) noexcept {
+  IOP_TRACE();
+  if (!Network::isPending(handle))
+    return;
+  asyncRequest().cancel();
+  asyncCallback = nullptr;
+}
+
+#ifdef IOP_MQTT
+/// "iop/<MAC address><path>"
+static auto topicOf(const Span<char> output, const StaticString path) noexcept -> std::optional<std::string_view> {
+  const auto prefix = std::string_view("iop/");
+  const auto &mac = driver::device.macAddress();
+  const auto pathLength = path.length();
+  const auto length = prefix.length() + mac.size() + pathLength;
+  if (length > output.size())
+    return std::nullopt;
+
+  char *pathStart = output.begin() + prefix.length() + mac.size(); // NOLINT *-pro-bounds-pointer-arithmetic
+  memcpy(output.begin(), prefix.data(), prefix.length());
+  memcpy(output.begin() + prefix.length(), mac.data(), mac.size());
+  memmove_P(pathStart, path.asCharPtr(), pathLength);
+  return std::string_view(output.begin(), length);
+}
+
+/// Only the update topic is subscribed, it carries the latest firmware's MD5
+static void onMqttMessage(const std::string_view topic, const std::string_view payload) noexcept {
+  (void)topic;
+  if (payload.length() != 32)
+    return;
+
+  MD5Hash latest;
+  memcpy(latest.data(), payload.data(), latest.size());
+  latestVersion_ = latest;
+  if (memcmp(payload.data(), driver::device.binaryMD5().data(), 32) != 0)
+    hook.schedule();
+}
+
+auto Network::publish(const std::string_view token, const StaticString path, const std::string_view payload) const noexcept
+    -> NetworkStatus {
+  IOP_TRACE();
+  Network::setup();
+
+  if (!Network::isConnected())
+    return NetworkStatus::CONNECTION_ISSUES;
+
+  const auto topic = topicOf(mqttTopic, path);
+  const auto updateTopic = topicOf(mqttUpdateTopic, F("/v1/update"));
+  if (!topic.has_value() || !updateTopic.has_value() || !requestHeaders.setUri(this->uri(), path)) {
+    this->logger.error(F("Topic doesn't fit buffer: "), path);
+    return NetworkStatus::CLIENT_BUFFER_OVERFLOW;
+  }
+
+  // Same key as HTTP requests to `path`, so `retryIn` doesn't change
+  const auto endpoint = std::string_view(requestHeaders.uri());
+  const auto now = driver::thisThread.now();
+  if (!retry.attempt(endpoint, now)) {
+    this->logger.warn(F("Backing off "), *topic, F(", next attempt in (ms): "), std::to_string(retry.waitFor(endpoint, now)));
+    return NetworkStatus::CONNECTION_ISSUES;
+  }
+
+  std::array<char, 64> host = {};
+  const auto hostLength = std::min(config::mqttHost().length(), host.size() - 1);
+  memmove_P(host.data(), config::mqttHost().asCharPtr(), hostLength);
+  const auto mac = std::string_view(driver::device.macAddress().data(), driver::device.macAddress().size());
+
+  this->logger.info(F("Publishing to "), *topic, F(", data length: "), std::to_string(payload.length()));
+  mqtt.onMessage(onMqttMessage);
+  auto status = mqtt.connect(std::string_view(host.data(), hostLength), config::mqttPort,
+                             MqttConnect { mac, mac, token, config::mqttKeepAlive, false }, *updateTopic);
+  if (status == MqttStatus::OK)
+    status = mqtt.publish(*topic, payload);
+
+  switch (status) {
+  case MqttStatus::OK:
+    retry.succeeded(endpoint);
+    return NetworkStatus::OK;
+  case MqttStatus::FORBIDDEN:
+    retry.succeeded(endpoint);
+    return NetworkStatus::FORBIDDEN;
+  case MqttStatus::CLIENT_BUFFER_OVERFLOW:
+    return NetworkStatus::CLIENT_BUFFER_OVERFLOW;
+  case MqttStatus::BROKEN_SERVER:
+    retry.failed(endpoint, now, RetryFailure::BROKEN_SERVER, std::nullopt);
+    return NetworkStatus::BROKEN_SERVER;
+  case MqttStatus::CONNECTION_ISSUES:
+    break;
+  }
+  retry.failed(endpoint, now, RetryFailure::TRANSIENT, std::nullopt);
+  this->logger.warn(F("Publish failed, retrying "), *topic, F(" in (ms): "), std::to_string(retry.waitFor(endpoint, now)));
+  return NetworkStatus::CONNECTION_ISSUES;
+}
+
+void Network::pollMqtt() noexcept {
+  IOP_TRACE();
+  if (Network::isConnected())
+    mqtt.poll();
+}
+#endif
 #else
 #include "driver/thread.hpp"
 #include "driver/wifi.hpp"
@@ -240,18 +777,87 @@ auto Network::isConnected() noexcept -> bool {
   IOP_TRACE();
   return true;
 }
+auto Network::connectionStats() noexcept -> ConnectionStats {
+  IOP_TRACE();
+  return (ConnectionStats) { 0, 0, 0 };
+}
+auto Network::retryState() noexcept -> RetryState {
+  IOP_TRACE();
+  return (RetryState) { 0, false, 0, 0 };
+}
+auto Network::compressionStats() noexcept -> CompressionStats {
+  IOP_TRACE();
+  return (CompressionStats) { 0, 0, 0 };
+}
+auto Network::latestVersion() noexcept -> std::optional<MD5Hash> {
+  IOP_TRACE();
+  return std::nullopt;
+}
+auto Network::timingMetrics(const Span<char> output) noexcept -> std::optional<std::string_view> {
+  (void)output;
+  IOP_TRACE();
+  return std::nullopt;
+}
+auto Network::jitter(const esp_time delay) noexcept -> esp_time { return delay; }
+auto Network::retryIn(const StaticString path) const noexcept -> esp_time {
+  (void)*this;
+  (void)path;
+  IOP_TRACE();
+  return 0;
+}
 auto Network::httpRequest(const HttpMethod method,
                           const std::optional<std::string_view> &token, std::string_view path,
-                          const std::optional<std::string_view> &data) const noexcept
+                          const std::optional<std::string_view> &data,
+                          StaticString contentType, const Span<char> body,
+                          const std::optional<std::string_view> &ifNoneMatch) const noexcept
     -> std::variant<Response, int> const &
   (void)*this;
+  (void)body;
+  (void)ifNoneMatch;
   (void)token;
   (void)method;
   (void)std::move(path);
   (void)data;
+  (void)std::move(contentType);
   IOP_TRACE();
   return Response(NetworkStatus::OK);
 }
+auto Network::start(const HttpMethod method, const std::optional<std::string_view> &token, const StaticString path,
+                    const std::optional<std::string_view> &data, const StaticString contentType, const Span<char> body,
+                    const RequestCallback callback) const noexcept -> std::variant<RequestHandle, NetworkStatus> {
+  (void)*this;
+  (void)method;
+  (void)token;
+  (void)path;
+  (void)data;
+  (void)contentType;
+  (void)body;
+  IOP_TRACE();
+  callback(std::variant<Response, int>(Response(NetworkStatus::OK)));
+  return RequestHandle { 0 };
+}
+auto Network::poll() const noexcept -> bool {
+  (void)*this;
+  IOP_TRACE();
+  return false;
+}
+auto Network::isPending(const RequestHandle handle) noexcept -> bool {
+  (void)handle;
+  return false;
+}
+void Network::cancel(const RequestHandle handle) noexcept { (void)handle; }
+#ifdef IOP_MQTT
+auto Network::publish(const std::string_view token, const StaticString path, const std::string_view payload) const noexcept
+    -> NetworkStatus {
+  (void)*this;
+  (void)token;
+  (void)path;
+  (void)payload;
+  IOP_TRACE();
+  return NetworkStatus::OK;
+}
+void Network::pollMqtt() noexcept { IOP_TRACE(); }
+#endif
 #endif
 
 auto Network::httpPost(std::string_view token, const StaticString path,
@@ -260,7 +866,8 @@ auto Network::httpPost(std::string_view token, const StaticString path,
   IOP_TRACE();
   return this->httpRequest(HttpMethod::POST, std::make_optional(std::move(token)),
                            path,
-                           std::make_optional(std::move(data)));
+                           std::make_optional(std::move(data)),
+                           F("application/json"), Span<char>(nullptr, 0), std::nullopt);
 }
 
 auto Network::httpPost(StaticString path, std::string_view data) const noexcept
@@ -268,7 +875,35 @@ auto Network::httpPost(StaticString path, std::string_view data) const noexcept
   IOP_TRACE();
   return this->httpRequest(HttpMethod::POST, std::optional<std::string_view>(),
                            path,
-                           std::make_optional(std::move(data)));
+                           std::make_optional(std::move(data)),
+                           F("application/json"), Span<char>(nullptr, 0), std::nullopt);
+}
+
+auto Network::httpPost(std::string_view token, const StaticString path,
+                       std::string_view data, const StaticString contentType) const noexcept
+    -> std::variant<Response, int> const & {
+  IOP_TRACE();
+  return this->httpRequest(HttpMethod::POST, std::make_optional(std::move(token)),
+                           path,
+                           std::make_optional(std::move(data)),
+                           contentType, Span<char>(nullptr, 0), std::nullopt);
+}
+
+auto Network::httpHead(std::string_view token, const StaticString path, std::string_view etag) const noexcept
+    -> std::variant<Response, int> const & {
+  IOP_TRACE();
+  return this->httpRequest(HttpMethod::HEAD, std::make_optional(std::move(token)), path,
+                           std::optional<std::string_view>(), F(""), Span<char>(nullptr, 0),
+                           std::make_optional(std::move(etag)));
+}
+
+auto Network::httpPost(StaticString path, std::string_view data, const Span<char> body) const noexcept
+    -> std::variant<Response, int> const & {
+  IOP_TRACE();
+  return this->httpRequest(HttpMethod::POST, std::optional<std::string_view>(),
+                           path,
+                           std::make_optional(std::move(data)),
+                           F("application/json"), body, std::nullopt);
 }
 
 auto Network::rawStatusToString(const RawStatus &status) noexcept
@@ -416,15 +1051,15 @@ Network::Network(StaticString uri, const LogLevel &logLevel) noexcept
 }
 
 Response::Response(const NetworkStatus &status) noexcept
-    : status(status), payload(std::optional<std::string>()) {
+    : status(status), payload(std::optional<std::string_view>()) {
   IOP_TRACE();
 }
-Response::Response(const NetworkStatus &status, std::string payload) noexcept
+Response::Response(const NetworkStatus &status, const std::string_view payload) noexcept
     : status(status), payload(payload) {
   IOP_TRACE();
 }
 Response::Response(Response &&resp) noexcept
-    : status(resp.status), payload(std::optional<std::string>()) {
+    : status(resp.status), payload(std::optional<std::string_view>()) {
   IOP_TRACE();
   this->payload.swap(resp.payload);
 }
@@ -0,0 +1,267 @@
+#include "core/request.hpp"
+#include "core/log.hpp"
+#include "core/tls_session.hpp"
+#include "driver/client.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdlib.h>
+
+static auto logger() noexcept -> iop::Log & {
+  static iop::Log logger_(iop::LogLevel::WARN, F("HTTP Request"));
+  return logger_;
+}
+
+namespace iop {
+HttpRequest::HttpRequest(WiFiClient &client) noexcept
+    : client(&client), state_(State::IDLE), parser(), host({}), port(0), connectedHost({}), connectedPort(0), head({}),
+      headLength(0), body(), sent(0), response(nullptr, 0), responseLength(0), overflowed_(false), startedAt(0), timeout(0),
+      reused(false), reconnected_(false), received(false), code_(0) {
+  IOP_TRACE();
+}
+
+auto HttpRequest::begin(const std::string_view method, std::string_view uri) noexcept -> bool {
+  IOP_TRACE();
+  this->cancel();
+  this->state_ = State::IDLE;
+  this->parser.reset();
+  this->headLength = 0;
+  this->sent = 0;
+  this->responseLength = 0;
+  this->overflowed_ = false;
+  this->received = false;
+  this->reconnected_ = false;
+  this->code_ = 0;
+
+  uint16_t port = 0;
+  if (uri.find("http://") == 0) {
+    port = 80;
+    uri.remove_prefix(7);
+  } else if (uri.find("https://") == 0) {
+    port = 443;
+    uri.remove_prefix(8);
+  } else {
+    logger().error(F("Unsupported scheme: "), uri);
+    return false;
+  }
+
+  const auto pathStart = std::min(uri.find('/'), uri.length());
+  const auto authority = uri.substr(0, pathStart);
+  const auto path = pathStart == uri.length() ? std::string_view("/") : uri.substr(pathStart);
+  const auto portStart = std::min(authority.find(':'), authority.length());
+  const auto host = authority.substr(0, portStart);
+  if (portStart < authority.length()) {
+    std::array<char, 6> digits = {};
+    const auto portDigits = authority.substr(portStart + 1);
+    if (portDigits.empty() || portDigits.length() >= digits.size())
+      return false;
+    memcpy(digits.data(), portDigits.data(), portDigits.length());
+    const auto parsed = strtoul(digits.data(), nullptr, 10);
+    if (parsed == 0 || parsed > UINT16_MAX)
+      return false;
+    port = static_cast<uint16_t>(parsed);
+  }
+  if (host.empty() || host.length() >= this->host.size()) {
+    logger().error(F("Host doesn't fit HttpRequest::hostCapacity: "), host);
+    return false;
+  }
+  memcpy(this->host.data(), host.data(), host.length());
+  this->host.at(host.length()) = '\0';
+  this->port = port;
+
+  const auto fits = this->append(method) && this->append(" ") && this->append(path) && this->append(" HTTP/1.1\r\n") &&
+                    this->addHeader("host", authority) && this->addHeader("connection", "keep-alive");
+  if (!fits) {
+    logger().error(F("Request doesn't fit HttpRequest::headCapacity: "), path);
+    this->headLength = 0;
+  }
+  return fits;
+}
+
+auto HttpRequest::addHeader(const std::string_view name, const std::string_view value) noexcept -> bool {
+  return this->append(name) && this->append(": ") && this->append(value) && this->append("\r\n");
+}
+
+auto HttpRequest::start(const std::string_view body, const Span<char> response, const esp_time timeout,
+                        const esp_time now) noexcept -> bool {
+  IOP_TRACE();
+  if (this->headLength == 0 || this->isInFlight())
+    return false;
+
+  // Fits any size_t
+  std::array<char, 21> length = {};
+  snprintf(length.data(), length.size(), "%lu", static_cast<unsigned long>(body.length()));
+  if (!this->addHeader("content-length", length.data()) || !this->append("\r\n")) {
+    logger().error(F("Request doesn't fit HttpRequest::headCapacity"));
+    return false;
+  }
+
+  this->body = body;
+  this->response = response;
+  this->timeout = timeout;
+  this->startedAt = now;
+  this->state_ = State::CONNECTING;
+  return true;
+}
+
+auto HttpRequest::step(const esp_time now) noexcept -> State {
+  IOP_TRACE();
+  if (!this->isInFlight())
+    return this->state_;
+  if (now - this->startedAt >= this->timeout) {
+    logger().warn(F("Timed out requesting "), std::string_view(this->host.data()));
+    this->fail(HTTPC_ERROR_READ_TIMEOUT);
+    return this->state_;
+  }
+
+  if (this->state_ == State::CONNECTING)
+    this->connect();
+  if (this->state_ == State::SENDING)
+    this->send();
+  if (this->state_ == State::RECEIVING)
+    this->receive();
+  return this->state_;
+}
+
+void HttpRequest::cancel() noexcept {
+  IOP_TRACE();
+  // Nothing was sent yet, so the kept-alive connection is still usable
+  if (this->state_ == State::CONNECTING && !this->reconnected_) {
+    this->code_ = HTTPC_ERROR_CONNECTION_LOST;
+    this->state_ = State::FAILED;
+  } else if (this->isInFlight()) {
+    this->fail(HTTPC_ERROR_CONNECTION_LOST);
+  }
+}
+
+void HttpRequest::connect() noexcept {
+  const auto sameHost = strcmp(this->host.data(), this->connectedHost.data()) == 0 && this->port == this->connectedPort;
+  this->reused = sameHost && this->client->connected();
+  if (!this->reused) {
+    this->client->stop();
+    logger().debug(F("Connecting to "), std::string_view(this->host.data()));
+    // Connecting blocks for the handshake, so it's measured like `Network::httpRequest` does
+    TlsSessionCache::beforeHandshake();
+    const auto connected = this->client->connect(this->host.data(), this->port) != 0;
+    TlsSessionCache::afterHandshake(connected);
+    if (!connected) {
+      logger().warn(F("Unable to connect to "), std::string_view(this->host.data()));
+      this->fail(HTTPC_ERROR_CONNECTION_FAILED);
+      return;
+    }
+    this->connectedHost = this->host;
+    this->connectedPort = this->port;
+  }
+  this->state_ = State::SENDING;
+}
+
+void HttpRequest::send() noexcept {
+  const auto total = this->headLength + this->body.length();
+  while (this->sent < total) {
+    if (!this->client->connected()) {
+      this->lost(HTTPC_ERROR_SEND_HEADER_FAILED);
+      return;
+    }
+    // The rest is sent by the next steps
+    const auto writable = this->client->availableForWrite();
+    if (writable <= 0)
+      return;
+
+    const auto inHead = this->sent < this->headLength;
+    const char *data = inHead ? this->head.data() + this->sent : this->body.data() + (this->sent - this->headLength);
+    const auto left = inHead ? this->headLength - this->sent : total - this->sent;
+    const auto length = std::min(left, static_cast<size_t>(writable));
+    const auto written = this->client->write(reinterpret_cast<const uint8_t *>(data), length);
+    if (written == 0) {
+      this->lost(inHead ? HTTPC_ERROR_SEND_HEADER_FAILED : HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+      return;
+    }
+    this->sent += written;
+  }
+  this->state_ = State::RECEIVING;
+}
+
+void HttpRequest::receive() noexcept {
+  std::array<char, 256> buffer;
+  while (this->client->available() > 0) {
+    const auto read = this->client->read(reinterpret_cast<uint8_t *>(buffer.data()), buffer.size());
+    if (read <= 0)
+      break;
+    this->received = true;
+
+    auto input = std::string_view(buffer.data(), static_cast<size_t>(read));
+    while (!input.empty() && !this->parser.isDone() && !this->parser.hasFailed()) {
+      const auto step = this->parser.feed(input);
+      const auto fits = std::min(step.body.length(), this->response.size() - this->responseLength);
+      if (fits > 0)
+        memcpy(this->response.begin() + this->responseLength, step.body.data(), fits);
+      this->responseLength += fits;
+      // Without a buffer the body is discarded, it isn't an overflow
+      this->overflowed_ = this->overflowed_ || (fits < step.body.length() && !this->response.isEmpty());
+      input.remove_prefix(step.consumed);
+      if (step.consumed == 0)
+        break;
+    }
+
+    if (this->parser.hasFailed()) {
+      logger().error(F("Unable to parse response"));
+      this->fail(HTTPC_ERROR_NO_HTTP_SERVER);
+      return;
+    }
+    if (this->parser.isDone()) {
+      this->finish();
+      return;
+    }
+  }
+
+  if (this->client->connected())
+    return;
+  if (!this->received) {
+    this->lost(HTTPC_ERROR_CONNECTION_LOST);
+    return;
+  }
+  // Bodies may be delimited by the connection closing
+  this->parser.finish();
+  if (this->parser.isDone()) {
+    this->finish();
+  } else {
+    this->fail(HTTPC_ERROR_CONNECTION_LOST);
+  }
+}
+
+void HttpRequest::lost(const int code) noexcept {
+  if (!this->reused || this->received) {
+    this->fail(code);
+    return;
+  }
+  logger().debug(F("Kept-alive connection was closed by the server, reconnecting"));
+  this->client->stop();
+  this->reused = false;
+  this->reconnected_ = true;
+  this->sent = 0;
+  this->state_ = State::CONNECTING;
+}
+
+void HttpRequest::fail(const int code) noexcept {
+  this->client->stop();
+  this->code_ = code;
+  this->state_ = State::FAILED;
+}
+
+void HttpRequest::finish() noexcept {
+  if (!this->parser.keepAlive())
+    this->client->stop();
+  this->code_ = this->parser.status();
+  this->state_ = State::DONE;
+}
+
+auto HttpRequest::append(const std::string_view str) noexcept -> bool {
+  if (this->headLength + str.length() > this->head.size())
+    return false;
+  // Methods and content types are string views over flash
+  memcpy_P(this->head.data() + this->headLength, str.data(), str.length());
+  this->headLength += str.length();
+  return true;
+}
+} // namespace iop
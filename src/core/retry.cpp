@@ -0,0 +1,181 @@
+#include "core/retry.hpp"
+#include "core/log.hpp"
+
+namespace iop {
+/// Enough to reach any `maxDelay`, the backoff only doubles up to it
+constexpr static uint8_t maxFailures = 32;
+
+RetryPolicy::RetryPolicy(const iop::esp_time baseDelay, const iop::esp_time maxDelay, const uint8_t breakerThreshold,
+                         const iop::esp_time breakerCooldown) noexcept
+    : baseDelay(baseDelay), maxDelay(maxDelay), breakerThreshold(breakerThreshold), breakerCooldown(breakerCooldown),
+      endpoints(), brokenStreak(0), openedAt(), openFor(0), halfOpen(false), trialAt(0), suppressed_(0), random(1) {
+  IOP_TRACE();
+}
+
+void RetryPolicy::seed(const uint32_t seed) noexcept {
+  IOP_TRACE();
+  this->random = seed == 0 ? 1 : seed;
+}
+
+auto RetryPolicy::waitFor(const std::string_view endpoint, const iop::esp_time now) const noexcept -> iop::esp_time {
+  IOP_TRACE();
+  const auto breaker = this->breakerWait(now);
+
+  const auto index = this->find(RetryPolicy::keyOf(endpoint));
+  if (!index.has_value())
+    return breaker;
+
+  const auto &entry = *this->endpoints.at(*index);
+  // Unsigned subtraction handles `millis()` overflow
+  const auto elapsed = now - entry.failedAt;
+  const auto backoff = elapsed < entry.delay ? entry.delay - elapsed : 0;
+  return backoff > breaker ? backoff : breaker;
+}
+
+auto RetryPolicy::attempt(const std::string_view endpoint, const iop::esp_time now) noexcept -> bool {
+  IOP_TRACE();
+  if (this->waitFor(endpoint, now) > 0) {
+    this->suppressed_++;
+    return false;
+  }
+
+  // Cooldown is over, this is the trial request. Others wait for its result,
+  // unless it never reported back for a whole cooldown
+  if (this->openedAt.has_value()) {
+    if (this->halfOpen && now - this->trialAt < this->breakerCooldown) {
+      this->suppressed_++;
+      return false;
+    }
+    this->halfOpen = true;
+    this->trialAt = now;
+  }
+  return true;
+}
+
+void RetryPolicy::succeeded(const std::string_view endpoint) noexcept {
+  IOP_TRACE();
+  const auto index = this->find(RetryPolicy::keyOf(endpoint));
+  if (index.has_value())
+    this->endpoints.at(*index).reset();
+
+  this->brokenStreak = 0;
+  this->openedAt.reset();
+  this->halfOpen = false;
+}
+
+void RetryPolicy::failed(const std::string_view endpoint, const iop::esp_time now, const RetryFailure failure,
+                         const std::optional<iop::esp_time> retryAfter) noexcept {
+  IOP_TRACE();
+  const auto key = RetryPolicy::keyOf(endpoint);
+  auto index = this->find(key);
+  if (!index.has_value()) {
+    // When full the endpoint that failed the least is forgotten
+    uint8_t chosen = 0;
+    for (uint8_t i = 0; i < capacity; ++i) {
+      const auto &slot = this->endpoints.at(i);
+      if (!slot.has_value()) {
+        chosen = i;
+        break;
+      }
+      if (slot->failures < this->endpoints.at(chosen)->failures)
+        chosen = i;
+    }
+    this->endpoints.at(chosen) = (Endpoint) { key, 0, now, 0 };
+    index = chosen;
+  }
+
+  auto &entry = *this->endpoints.at(*index);
+  if (entry.failures < maxFailures)
+    entry.failures++;
+  entry.failedAt = now;
+
+  if (retryAfter.has_value()) {
+    // The server knows best, but a broken header must not silence the device
+    entry.delay = *retryAfter < this->maxDelay ? *retryAfter : this->maxDelay;
+  } else {
+    // Doubles without overflowing
+    auto ceiling = this->baseDelay < this->maxDelay ? this->baseDelay : this->maxDelay;
+    for (uint8_t exponent = 1; exponent < entry.failures && ceiling < this->maxDelay; ++exponent)
+      ceiling = ceiling > this->maxDelay / 2 ? this->maxDelay : ceiling * 2;
+    entry.delay = this->uniform(ceiling);
+  }
+
+  if (failure == RetryFailure::BROKEN_SERVER && this->brokenStreak < UINT8_MAX)
+    this->brokenStreak++;
+
+  // A failed trial opens it again, whatever the failure
+  if (this->halfOpen || (this->breakerThreshold > 0 && this->brokenStreak >= this->breakerThreshold)) {
+    this->openedAt = now;
+    this->openFor = this->jitter(this->breakerCooldown);
+    this->halfOpen = false;
+  }
+}
+
+auto RetryPolicy::isOpen(const iop::esp_time now) const noexcept -> bool {
+  IOP_TRACE();
+  return this->breakerWait(now) > 0;
+}
+
+auto RetryPolicy::state(const iop::esp_time now) const noexcept -> RetryState {
+  IOP_TRACE();
+  auto state = (RetryState) { 0, this->isOpen(now), this->breakerWait(now), this->suppressed_ };
+  for (const auto &entry: this->endpoints) {
+    if (!entry.has_value())
+      continue;
+
+    const auto elapsed = now - entry->failedAt;
+    if (elapsed >= entry->delay)
+      continue;
+
+    state.backingOff++;
+    const auto remaining = entry->delay - elapsed;
+    if (!state.breakerOpen && (state.waitFor == 0 || remaining < state.waitFor))
+      state.waitFor = remaining;
+  }
+  return state;
+}
+
+auto RetryPolicy::jitter(const iop::esp_time delay) noexcept -> iop::esp_time {
+  IOP_TRACE();
+  return delay - this->uniform(delay / 2);
+}
+
+auto RetryPolicy::find(const uint32_t key) const noexcept -> std::optional<uint8_t> {
+  for (uint8_t index = 0; index < capacity; ++index) {
+    const auto &entry = this->endpoints.at(index);
+    if (entry.has_value() && entry->key == key)
+      return index;
+  }
+  return std::nullopt;
+}
+
+auto RetryPolicy::next() noexcept -> uint32_t {
+  this->random ^= this->random << 13;
+  this->random ^= this->random >> 17;
+  this->random ^= this->random << 5;
+  return this->random;
+}
+
+auto RetryPolicy::uniform(const iop::esp_time max) noexcept -> iop::esp_time {
+  if (max == 0)
+    return 0;
+  return static_cast<iop::esp_time>(static_cast<uint64_t>(this->next()) % (static_cast<uint64_t>(max) + 1));
+}
+
+auto RetryPolicy::breakerWait(const iop::esp_time now) const noexcept -> iop::esp_time {
+  if (!this->openedAt.has_value())
+    return 0;
+  const auto elapsed = now - *this->openedAt;
+  return elapsed < this->openFor ? this->openFor - elapsed : 0;
+}
+
+auto RetryPolicy::keyOf(const std::string_view endpoint) noexcept -> uint32_t {
+  // FNV-1a
+  uint32_t hash = 2166136261UL;
+  for (const auto c: endpoint) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+} // namespace iop
@@ -32,7 +32,7 @@ auto isPrintable(const char ch) noexcept -> bool {
 
 auto isAllPrintable(const std::string_view txt) noexcept -> bool {
   const auto len = txt.length();
-  for (uint8_t index = 0; index < len; ++index) {
+  for (size_t index = 0; index < len; ++index) {
     const auto ch = txt.begin()[index]; // NOLINT *-pro-bounds-pointer-arithmetic
 
     if (!isPrintable(ch))
@@ -47,7 +47,7 @@ auto scapeNonPrintable(const std::string_view txt) noexcept -> CowString {
 
   const size_t len = txt.length();
   std::string s(len, '\0');
-  for (uint8_t index = 0; index < len; ++index) {
+  for (size_t index = 0; index < len; ++index) {
     // NOLINTNEXTLINE cppcoreguidelines-pro-bounds-pointer-arithmetic
     const auto ch = txt.begin()[index];
     if (isPrintable(ch)) {
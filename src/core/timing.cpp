@@ -0,0 +1,138 @@
+#include "core/timing.hpp"
+#include "core/log.hpp"
+
+#include <cstdio>
+
+// Matched by prefix, so the query string is ignored
+constexpr static std::string_view endpointPaths[] = {"/v1/events", "/v1/summary", "/v1/log", "/v1/panic", "/v1/user/login", "/v1/update"};
+constexpr static const char *endpointNames[] = {"events", "summary", "log", "panic", "login", "update", "other"};
+static_assert(sizeof(endpointNames) / sizeof(endpointNames[0]) == iop::NetworkTimings::endpoints, "Endpoint without name");
+
+namespace iop {
+RequestTimer::RequestTimer() noexcept: timing_({}), last(0), running(false) { IOP_TRACE(); }
+
+void RequestTimer::start(const esp_time now) noexcept {
+  this->timing_.fill(0);
+  this->last = now;
+  this->running = true;
+}
+
+void RequestTimer::mark(const RequestPhase phase, const esp_time now) noexcept {
+  if (!this->running)
+    return;
+  // Unsigned, so it's right even if `millis()` wraps around
+  this->timing_.at(static_cast<uint8_t>(phase)) += now - this->last;
+  this->last = now;
+}
+
+auto RequestTimer::stop() noexcept -> RequestTiming {
+  this->running = false;
+  return this->timing_;
+}
+
+auto requestTimer() noexcept -> RequestTimer & {
+  static RequestTimer timer;
+  return timer;
+}
+
+TimingHistogram::TimingHistogram() noexcept: counts({}), samples_(0), total_(0) { IOP_TRACE(); }
+
+void TimingHistogram::record(const RequestTiming &timing) noexcept {
+  if (this->samples_ >= window) {
+    for (auto &phase: this->counts) {
+      for (auto &count: phase)
+        count /= 2;
+    }
+    this->samples_ /= 2;
+  }
+
+  for (uint8_t phase = 0; phase < requestPhases; ++phase)
+    this->counts.at(phase).at(bucketOf(timing.at(phase)))++;
+  this->samples_++;
+  this->total_++;
+}
+
+auto TimingHistogram::percentile(const RequestPhase phase, const uint8_t percent) const noexcept -> esp_time {
+  const auto &counts = this->counts.at(static_cast<uint8_t>(phase));
+  uint32_t sum = 0;
+  for (const auto count: counts)
+    sum += count;
+  if (sum == 0)
+    return 0;
+
+  uint32_t cumulative = 0;
+  for (uint8_t bucket = 0; bucket < buckets; ++bucket) {
+    cumulative += counts.at(bucket);
+    if (cumulative * 100 >= sum * percent)
+      return upperBound(bucket);
+  }
+  return upperBound(buckets - 1);
+}
+
+auto TimingHistogram::bucketOf(esp_time duration) noexcept -> uint8_t {
+  if (duration == 0)
+    return 0;
+  uint8_t bucket = 1;
+  duration /= 4;
+  while (duration > 0 && bucket < buckets - 1) {
+    duration /= 4;
+    bucket++;
+  }
+  return bucket;
+}
+
+auto TimingHistogram::upperBound(const uint8_t bucket) noexcept -> esp_time {
+  if (bucket == 0)
+    return 0;
+  return static_cast<esp_time>(4) << (2 * (bucket - 1));
+}
+
+void NetworkTimings::record(const std::string_view path, const RequestTiming &timing) noexcept {
+  this->histograms.at(endpointOf(path)).record(timing);
+}
+
+auto NetworkTimings::endpointOf(const std::string_view path) noexcept -> uint8_t {
+  for (uint8_t endpoint = 0; endpoint < endpoints - 1; ++endpoint) {
+    if (path.substr(0, endpointPaths[endpoint].length()) == endpointPaths[endpoint])
+      return endpoint;
+  }
+  return endpoints - 1;
+}
+
+auto NetworkTimings::serialize(const Span<char> output) const noexcept -> std::optional<std::string_view> {
+  IOP_TRACE();
+  size_t length = 0;
+  // snprintf always null terminates, so it can't be given the last byte
+  const auto print = [&output, &length](const char *format, const auto... args) {
+    if (length >= output.size())
+      return;
+    const auto written = snprintf(output.begin() + length, output.size() - length, format, args...); // NOLINT *-pro-bounds-pointer-arithmetic
+    length += written < 0 ? output.size() : static_cast<size_t>(written);
+  };
+
+  print("{");
+  bool first = true;
+  for (uint8_t endpoint = 0; endpoint < endpoints; ++endpoint) {
+    const auto &histogram = this->histograms.at(endpoint);
+    if (histogram.samples() == 0)
+      continue;
+
+    print("%s\"%s\":{\"n\":%lu", first ? "" : ",", endpointNames[endpoint], static_cast<unsigned long>(histogram.total()));
+    first = false;
+    for (const uint8_t percent: {uint8_t{50}, uint8_t{95}}) {
+      print(",\"p%u\":[", static_cast<unsigned>(percent));
+      for (uint8_t phase = 0; phase < requestPhases; ++phase) {
+        const auto value = histogram.percentile(static_cast<RequestPhase>(phase), percent);
+        print("%s%lu", phase == 0 ? "" : ",", static_cast<unsigned long>(value));
+      }
+      print("]");
+    }
+    print("}");
+  }
+  print("}");
+
+  if (length >= output.size())
+    return std::nullopt;
+  return std::string_view(output.begin(), length);
+}
+} // namespace iop
@@ -0,0 +1,137 @@
+#include "core/tls_session.hpp"
+#include "core/utils.hpp"
+
+#ifdef IOP_SSL
+#include "driver/device.hpp"
+#include "loop.hpp"
+
+#include <array>
+#include <cstring>
+
+// BearSSL::Session only wraps the parameters, but doesn't expose them. We need
+// the session ID to know if it was resumed, and the whole of it to persist it
+static_assert(sizeof(BearSSL::Session) == sizeof(br_ssl_session_parameters), "BearSSL::Session layout changed");
+
+static BearSSL::Session session;
+static iop::HandshakeStats stats_ = {0, 0};
+/// Session ID offered in the current handshake, empty if none
+static std::array<unsigned char, 32> offeredId;
+static uint8_t offeredIdLength = 0;
+
+static auto parameters() noexcept -> br_ssl_session_parameters {
+  br_ssl_session_parameters params = {};
+  memcpy(&params, &session, sizeof(params));
+  return params;
+}
+
+#ifdef IOP_TLS_SESSION_RTC
+// Avoids colliding with the start of RTC user memory, commonly used by libraries
+constexpr static uint32_t rtcOffset = 32;
+constexpr static uint32_t rtcMagic = 0x7E55104E;
+
+struct RtcSession {
+  uint32_t magic;
+  uint32_t checksum;
+  br_ssl_session_parameters parameters;
+};
+using RtcBuffer = std::array<uint32_t, (sizeof(RtcSession) + 3) / 4>;
+
+/// FNV-1a, RTC memory is garbage after a power loss
+static auto checksum(const br_ssl_session_parameters &params) noexcept -> uint32_t {
+  uint32_t hash = 2166136261U;
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&params);
+  for (size_t index = 0; index < sizeof(params); ++index)
+    hash = (hash ^ bytes[index]) * 16777619U; // NOLINT *-pro-bounds-pointer-arithmetic
+  return hash;
+}
+
+static void persist() noexcept {
+  IOP_TRACE();
+  RtcSession rtc = {rtcMagic, 0, parameters()};
+  rtc.checksum = checksum(rtc.parameters);
+
+  RtcBuffer buffer = {};
+  memcpy(buffer.data(), &rtc, sizeof(rtc));
+  driver::device.rtcWrite(rtcOffset, buffer.data(), sizeof(buffer));
+}
+
+static void restore() noexcept {
+  IOP_TRACE();
+  RtcBuffer buffer = {};
+  if (!driver::device.rtcRead(rtcOffset, buffer.data(), sizeof(buffer)))
+    return;
+
+  RtcSession rtc = {};
+  memcpy(&rtc, buffer.data(), sizeof(rtc));
+  if (rtc.magic != rtcMagic || rtc.checksum != checksum(rtc.parameters))
+    return;
+  memcpy(&session, &rtc.parameters, sizeof(rtc.parameters));
+}
+#endif
+
+namespace iop {
+void TlsSessionCache::setup() noexcept {
+  IOP_TRACE();
+#ifdef IOP_TLS_SESSION_RTC
+  restore();
+#endif
+  unused4KbSysStack.client().setSession(&session);
+}
+
+void TlsSessionCache::beforeHandshake() noexcept {
+  IOP_TRACE();
+  const auto params = parameters();
+  offeredIdLength = params.session_id_len;
+  memcpy(offeredId.data(), params.session_id, offeredId.size());
+}
+
+void TlsSessionCache::afterHandshake(const bool succeeded) noexcept {
+  IOP_TRACE();
+  if (!succeeded) {
+    TlsSessionCache::invalidate();
+    return;
+  }
+
+  // The server resumes a session by answering with the same ID we offered
+  const auto params = parameters();
+  const auto resumed = offeredIdLength > 0 && params.session_id_len == offeredIdLength &&
+                       memcmp(params.session_id, offeredId.data(), offeredIdLength) == 0;
+  if (resumed) {
+    stats_.resumed++;
+    return;
+  }
+
+  stats_.full++;
+#ifdef IOP_TLS_SESSION_RTC
+  persist();
+#endif
+}
+
+void TlsSessionCache::invalidate() noexcept {
+  IOP_TRACE();
+  session = BearSSL::Session();
+#ifdef IOP_TLS_SESSION_RTC
+  persist();
+#endif
+}
+
+auto TlsSessionCache::stats() noexcept -> HandshakeStats {
+  IOP_TRACE();
+  return stats_;
+}
+} // namespace iop
+#else
+namespace iop {
+void TlsSessionCache::setup() noexcept { IOP_TRACE(); }
+void TlsSessionCache::beforeHandshake() noexcept { IOP_TRACE(); }
+void TlsSessionCache::afterHandshake(const bool succeeded) noexcept {
+  (void)succeeded;
+  IOP_TRACE();
+}
+void TlsSessionCache::invalidate() noexcept { IOP_TRACE(); }
+auto TlsSessionCache::stats() noexcept -> HandshakeStats {
+  IOP_TRACE();
+  return (HandshakeStats) { 0, 0 };
+}
+} // namespace iop
+#endif
@@ -0,0 +1,68 @@
+#include "core/upgrade.hpp"
+#include "core/log.hpp"
+
+#include <cstring>
+
+constexpr static uint32_t magic = 0x0FA0FA01;
+
+struct Layout {
+  uint32_t magic;
+  uint32_t checksum;
+  std::array<char, 32> offered;
+  uint32_t failures;
+};
+static_assert(sizeof(Layout) <= sizeof(iop::UpgradeAttempts::Persisted), "UpgradeAttempts::Persisted is too small");
+
+/// FNV-1a
+static auto checksum(const Layout &layout) noexcept -> uint32_t {
+  uint32_t hash = 2166136261U;
+  for (const auto c: layout.offered)
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619U;
+  return (hash ^ layout.failures) * 16777619U;
+}
+
+namespace iop {
+UpgradeAttempts::UpgradeAttempts(const uint8_t maxFailures) noexcept: maxFailures(maxFailures), offered({}), failures(0) {
+  IOP_TRACE();
+}
+
+auto UpgradeAttempts::shouldDownload(const MD5Hash &offered) const noexcept -> bool {
+  IOP_TRACE();
+  return this->failuresOf(offered) < this->maxFailures;
+}
+
+void UpgradeAttempts::failed(const MD5Hash &offered) noexcept {
+  IOP_TRACE();
+  if (this->offered != offered) {
+    this->offered = offered;
+    this->failures = 0;
+  }
+  if (this->failures < UINT8_MAX)
+    this->failures++;
+}
+
+auto UpgradeAttempts::failuresOf(const MD5Hash &offered) const noexcept -> uint8_t {
+  return this->offered == offered ? this->failures : 0;
+}
+
+auto UpgradeAttempts::persist() const noexcept -> Persisted {
+  IOP_TRACE();
+  Layout layout = { magic, 0, this->offered, this->failures };
+  layout.checksum = checksum(layout);
+
+  Persisted persisted = {};
+  memcpy(persisted.data(), &layout, sizeof(layout));
+  return persisted;
+}
+
+void UpgradeAttempts::restore(const Persisted &persisted) noexcept {
+  IOP_TRACE();
+  Layout layout = {};
+  memcpy(&layout, persisted.data(), sizeof(layout));
+  if (layout.magic != magic || layout.checksum != checksum(layout) || layout.failures > UINT8_MAX)
+    return;
+
+  this->offered = layout.offered;
+  this->failures = static_cast<uint8_t>(layout.failures);
+}
+} // namespace iop
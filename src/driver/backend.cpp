@@ -0,0 +1,420 @@
+#include "driver/backend.hpp"
+
+#ifdef IOP_DESKTOP
+#include "core/log.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+// Berkeley sockets, so assumes POSIX compliant OS //
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+static iop::Log & logger() noexcept {
+  static iop::Log logger_(iop::LogLevel::WARN, F("Mock Backend"));
+  return logger_;
+}
+
+static void sleepFor(const iop::esp_time millis) noexcept {
+  if (millis > 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+}
+
+static auto toLower(std::string_view view) noexcept -> std::string {
+  std::string lower(view);
+  std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+  return lower;
+}
+
+static auto trim(std::string_view view) noexcept -> std::string_view {
+  while (!view.empty() && (view.front() == ' ' || view.front() == '\t'))
+    view.remove_prefix(1);
+  while (!view.empty() && (view.back() == ' ' || view.back() == '\t'))
+    view.remove_suffix(1);
+  return view;
+}
+
+static auto reasonOf(const uint16_t status) noexcept -> const char * {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 304:
+    return "Not Modified";
+  case 400:
+    return "Bad Request";
+  case 403:
+    return "Forbidden";
+  case 404:
+    return "Not Found";
+  case 412:
+    return "Precondition Failed";
+  case 415:
+    return "Unsupported Media Type";
+  case 429:
+    return "Too Many Requests";
+  case 500:
+    return "Internal Server Error";
+  case 503:
+    return "Service Unavailable";
+  }
+  return "Unknown";
+}
+
+/// None if it's not a valid gzip stream
+static auto gunzip(const std::string_view compressed) noexcept -> std::optional<std::string> {
+  z_stream stream = {};
+  // 16 selects the gzip wrapper
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    return std::nullopt;
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+  stream.avail_in = static_cast<uInt>(compressed.length());
+
+  std::string output;
+  std::array<char, 1024> buffer;
+  int code = Z_OK;
+  while (code == Z_OK) {
+    stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+    stream.avail_out = static_cast<uInt>(buffer.size());
+    code = inflate(&stream, Z_NO_FLUSH);
+    output.append(buffer.data(), buffer.size() - stream.avail_out);
+  }
+  inflateEnd(&stream);
+  // Trailing garbage isn't accepted either
+  if (code != Z_STREAM_END || stream.avail_in != 0)
+    return std::nullopt;
+  return output;
+}
+
+/// Blocks until everything is sent, false if the client went away
+static auto sendAll(const int32_t fd, std::string_view data) noexcept -> bool {
+  while (!data.empty()) {
+    const auto sent = send(fd, data.data(), data.length(), MSG_NOSIGNAL);
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+      continue;
+    if (sent <= 0)
+      return false;
+    data.remove_prefix(static_cast<size_t>(sent));
+  }
+  return true;
+}
+
+namespace driver {
+auto MockRequest::header(const std::string_view name) const noexcept -> std::optional<std::string_view> {
+  const auto value = this->headers.find(toLower(name));
+  if (value == this->headers.end())
+    return std::nullopt;
+  return std::string_view(value->second);
+}
+
+MockBackend::MockBackend(const uint16_t port) noexcept: port_(port), running(false), latency(0), failEvery_(0), untilFailure(0), acceptGzip_(true), total(0) {
+  IOP_TRACE();
+}
+
+auto MockBackend::start() noexcept -> bool {
+  IOP_TRACE();
+  this->stop();
+
+  const int32_t fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    logger().error(F("Unable to open socket: "), strerror(errno));
+    return false;
+  }
+  const int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(this->port_);
+  socklen_t length = sizeof(address);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&address), length) < 0 || listen(fd, 16) < 0 ||
+      getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) < 0) {
+    logger().error(F("Unable to listen to port "), std::to_string(this->port_), F(": "), strerror(errno));
+    ::close(fd);
+    return false;
+  }
+
+  this->port_ = ntohs(address.sin_port);
+  this->fd = fd;
+  this->running = true;
+  this->thread = std::thread([this] { this->run(); });
+  logger().info(F("Listening to port "), std::to_string(this->port_));
+  return true;
+}
+
+void MockBackend::stop() noexcept {
+  IOP_TRACE();
+  this->running = false;
+  if (this->thread.joinable())
+    this->thread.join();
+  if (this->fd.has_value())
+    ::close(*this->fd);
+  this->fd.reset();
+}
+
+void MockBackend::run() noexcept {
+  IOP_TRACE();
+  // The first is the listening socket, the others are clients. Each client has its unparsed input
+  std::vector<pollfd> fds = { pollfd { *this->fd, POLLIN, 0 } };
+  std::vector<std::string> pending = { std::string() };
+
+  while (this->running) {
+    // Short timeout, so `stop` doesn't wait long
+    if (poll(fds.data(), fds.size(), 50) <= 0)
+      continue;
+
+    if (fds.front().revents & POLLIN) {
+      const auto client = accept(fds.front().fd, nullptr, nullptr);
+      if (client >= 0) {
+        logger().debug(F("Accepted connection: "), std::to_string(client));
+        fds.push_back(pollfd { client, POLLIN, 0 });
+        pending.emplace_back();
+      }
+    }
+
+    for (size_t index = fds.size() - 1; index > 0; --index) {
+      if (fds.at(index).revents == 0)
+        continue;
+
+      auto keep = false;
+      std::array<char, 1024> buffer;
+      const auto size = recv(fds.at(index).fd, buffer.data(), buffer.size(), 0);
+      if (size > 0) {
+        pending.at(index).append(buffer.data(), static_cast<size_t>(size));
+        keep = this->handle(fds.at(index).fd, pending.at(index));
+      } else if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        keep = true;
+      }
+
+      if (!keep) {
+        logger().debug(F("Closing connection: "), std::to_string(fds.at(index).fd));
+        ::close(fds.at(index).fd);
+        fds.erase(fds.begin() + static_cast<ssize_t>(index));
+        pending.erase(pending.begin() + static_cast<ssize_t>(index));
+      }
+    }
+  }
+
+  for (size_t index = 1; index < fds.size(); ++index)
+    ::close(fds.at(index).fd);
+}
+
+auto MockBackend::handle(const int32_t client, std::string &pending) noexcept -> bool {
+  IOP_TRACE();
+  while (true) {
+    const auto headersEnd = pending.find("\r\n\r\n");
+    if (headersEnd == pending.npos)
+      return true;
+
+    MockRequest request;
+    auto head = std::string_view(pending).substr(0, headersEnd);
+    auto lineEnd = head.find("\r\n");
+    const auto requestLine = head.substr(0, lineEnd);
+    const auto methodEnd = requestLine.find(' ');
+    const auto targetEnd = requestLine.find(' ', methodEnd + 1);
+    if (methodEnd == requestLine.npos || targetEnd == requestLine.npos) {
+      logger().error(F("Invalid request line: "), requestLine);
+      return false;
+    }
+    request.method = std::string(requestLine.substr(0, methodEnd));
+    const auto target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    request.path = std::string(target.substr(0, target.find('?')));
+
+    while (lineEnd != head.npos) {
+      head.remove_prefix(lineEnd + 2);
+      lineEnd = head.find("\r\n");
+      const auto line = head.substr(0, lineEnd);
+      const auto colon = line.find(':');
+      if (colon == line.npos)
+        continue;
+      request.headers.insert_or_assign(toLower(trim(line.substr(0, colon))), std::string(trim(line.substr(colon + 1))));
+    }
+
+    const auto contentLength = request.header("content-length");
+    const auto bodyLength = contentLength.has_value() ? strtoul(std::string(*contentLength).c_str(), nullptr, 10) : 0;
+    if (pending.length() < headersEnd + 4 + bodyLength)
+      return true;
+    request.body = pending.substr(headersEnd + 4, bodyLength);
+    request.sentLength = request.body.length();
+    pending.erase(0, headersEnd + 4 + bodyLength);
+
+    std::optional<uint16_t> rejection;
+    const auto encoding = toLower(request.header("content-encoding").value_or(""));
+    if (encoding == "gzip") {
+      auto inflated = gunzip(request.body);
+      if (inflated.has_value()) {
+        request.body = std::move(*inflated);
+      } else {
+        logger().error(F("Unable to inflate body of "), request.path);
+        rejection = 400;
+      }
+    } else if (!encoding.empty()) {
+      rejection = 415;
+    }
+
+    const auto close = toLower(request.header("connection").value_or("")) == "close";
+    const auto headless = request.method == "HEAD";
+    auto response = this->answer(request, rejection);
+
+    std::string text = std::string("HTTP/1.1 ") + std::to_string(response.status) + " " + reasonOf(response.status) + "\r\n";
+    text += "content-length: " + std::to_string(response.body.length()) + "\r\n";
+    text += close ? "connection: close\r\n" : "connection: keep-alive\r\n";
+    iop::esp_time latency = response.latency;
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (this->latestVersion.has_value())
+        text += "LATEST_VERSION: " + *this->latestVersion + "\r\n";
+      latency += this->latency;
+    }
+    for (const auto &[name, value]: response.headers)
+      text += name + ": " + value + "\r\n";
+    text += "\r\n";
+    // Answers to HEAD describe the body, but don't send it
+    if (!headless)
+      text += response.body;
+
+    sleepFor(latency);
+    logger().debug(F("Answering "), request.method, F(" "), request.path, F(" with "), std::to_string(response.status));
+
+    const auto truncated = response.truncateAt.has_value() && *response.truncateAt < text.length();
+    if (truncated)
+      text.resize(*response.truncateAt);
+
+    auto remaining = std::string_view(text);
+    const auto chunk = response.chunkSize == 0 ? remaining.length() : response.chunkSize;
+    while (!remaining.empty()) {
+      if (!sendAll(client, remaining.substr(0, chunk)))
+        return false;
+      remaining.remove_prefix(std::min(chunk, remaining.length()));
+      if (!remaining.empty())
+        sleepFor(response.chunkDelay);
+    }
+
+    if (truncated || close)
+      return false;
+  }
+}
+
+auto MockBackend::answer(const MockRequest &request, std::optional<uint16_t> rejection) noexcept -> MockResponse {
+  IOP_TRACE();
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->received_.push_back(request);
+  if (this->received_.size() > maxReceived)
+    this->received_.pop_front();
+  this->counts[request.path]++;
+  this->total++;
+
+  if (!this->acceptGzip_ && request.header("content-encoding").has_value())
+    rejection = 415;
+  if (rejection.has_value()) {
+    MockResponse response;
+    response.status = *rejection;
+    return response;
+  }
+
+  auto scripts = this->scripted.find(request.path);
+  if (scripts != this->scripted.end() && !scripts->second.empty()) {
+    auto response = std::move(scripts->second.front());
+    scripts->second.pop_front();
+    return response;
+  }
+
+  if (this->failEvery_ > 0 && --this->untilFailure == 0) {
+    this->untilFailure = this->failEvery_;
+    MockResponse response;
+    response.status = 500;
+    return response;
+  }
+
+  const auto fallback = this->fallbacks.find(request.path);
+  if (fallback != this->fallbacks.end())
+    return fallback->second;
+  return this->defaultAnswer(request);
+}
+
+auto MockBackend::defaultAnswer(const MockRequest &request) const noexcept -> MockResponse {
+  MockResponse response;
+  const auto &path = request.path;
+  if (path == "/v1/user/login" && request.method == "POST") {
+    response.body = std::string(64, 'T');
+  } else if (path == "/v1/update" && (request.method == "GET" || request.method == "HEAD")) {
+    // The real server sends the firmware, there is nothing to flash on desktop
+    const auto etag = request.header("if-none-match");
+    if (this->latestVersion.has_value() && etag.has_value() && *etag == "\"" + *this->latestVersion + "\"")
+      response.status = 304;
+  } else if (path != "/v1/event" && path != "/v1/events" && path != "/v1/summary" && path != "/v1/log" && path != "/v1/panic") {
+    response.status = 404;
+  }
+  return response;
+}
+
+void MockBackend::script(std::string path, MockResponse response) noexcept {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->scripted[std::move(path)].push_back(std::move(response));
+}
+
+void MockBackend::fallback(std::string path, MockResponse response) noexcept {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->fallbacks.insert_or_assign(std::move(path), std::move(response));
+}
+
+void MockBackend::setLatestVersion(std::optional<std::string> md5) noexcept {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->latestVersion = std::move(md5);
+}
+
+void MockBackend::setLatency(const iop::esp_time latency) noexcept {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->latency = latency;
+}
+
+void MockBackend::failEvery(const uint32_t nth) noexcept {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->failEvery_ = nth;
+  this->untilFailure = nth;
+}
+
+void MockBackend::acceptGzip(const bool accept) noexcept {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->acceptGzip_ = accept;
+}
+
+auto MockBackend::received() const noexcept -> std::vector<MockRequest> {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return std::vector<MockRequest>(this->received_.begin(), this->received_.end());
+}
+
+auto MockBackend::receivedCount(const std::string_view path) const noexcept -> uint32_t {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  const auto count = this->counts.find(std::string(path));
+  return count == this->counts.end() ? 0 : count->second;
+}
+
+auto MockBackend::receivedCount() const noexcept -> uint32_t {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->total;
+}
+
+void MockBackend::clear() noexcept {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->scripted.clear();
+  this->received_.clear();
+  this->counts.clear();
+  this->total = 0;
+}
+
+MockBackend::~MockBackend() noexcept {
+  this->stop();
+}
+} // namespace driver
+#endif
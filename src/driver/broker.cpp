@@ -0,0 +1,320 @@
+#include "driver/broker.hpp"
+
+#ifdef IOP_DESKTOP
+#include "core/log.hpp"
+#include "core/mqtt.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+// Berkeley sockets, so assumes POSIX compliant OS //
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static iop::Log & logger() noexcept {
+  static iop::Log logger_(iop::LogLevel::WARN, F("Mock Broker"));
+  return logger_;
+}
+
+/// Blocks until everything is sent, false if the client went away
+static auto sendAll(const int32_t fd, const iop::Span<char> buffer, const std::optional<size_t> size) noexcept -> bool {
+  if (!size.has_value())
+    return false;
+  auto data = std::string_view(buffer.begin(), *size);
+  while (!data.empty()) {
+    const auto sent = send(fd, data.data(), data.length(), MSG_NOSIGNAL);
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+      continue;
+    if (sent <= 0)
+      return false;
+    data.remove_prefix(static_cast<size_t>(sent));
+  }
+  return true;
+}
+
+namespace driver {
+MockBroker::MockBroker(const uint16_t port) noexcept
+    : port_(port), running(false), kick(false), dropAcks_(0), refuse_(0), pings_(0), lastId(0) {
+  IOP_TRACE();
+}
+
+auto MockBroker::start() noexcept -> bool {
+  IOP_TRACE();
+  this->stop();
+
+  const int32_t fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    logger().error(F("Unable to open socket: "), strerror(errno));
+    return false;
+  }
+  const int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(this->port_);
+  socklen_t length = sizeof(address);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&address), length) < 0 || listen(fd, 16) < 0 ||
+      getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) < 0) {
+    logger().error(F("Unable to listen to port "), std::to_string(this->port_), F(": "), strerror(errno));
+    ::close(fd);
+    return false;
+  }
+
+  this->port_ = ntohs(address.sin_port);
+  this->fd = fd;
+  this->running = true;
+  this->thread = std::thread([this] { this->run(); });
+  logger().info(F("Listening to port "), std::to_string(this->port_));
+  return true;
+}
+
+void MockBroker::stop() noexcept {
+  IOP_TRACE();
+  this->running = false;
+  if (this->thread.joinable())
+    this->thread.join();
+  if (this->fd.has_value())
+    ::close(*this->fd);
+  this->fd.reset();
+}
+
+void MockBroker::run() noexcept {
+  IOP_TRACE();
+  std::vector<Connection> connections;
+  std::vector<pollfd> fds;
+
+  const auto close = [this, &connections](const size_t index) {
+    auto &connection = connections.at(index);
+    logger().debug(F("Closing connection: "), std::to_string(connection.fd));
+    ::close(connection.fd);
+    if (connection.clientId.has_value()) {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->sessions[*connection.clientId].online = false;
+    }
+    connections.erase(connections.begin() + static_cast<ssize_t>(index));
+  };
+
+  while (this->running) {
+    if (this->kick.exchange(false)) {
+      while (!connections.empty())
+        close(connections.size() - 1);
+    }
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      for (const auto &[topic, payload]: this->outbox)
+        this->deliver(connections, topic, payload);
+      this->outbox.clear();
+    }
+
+    // The first is the listening socket, the others are the connections
+    fds.assign(1, pollfd { *this->fd, POLLIN, 0 });
+    for (const auto &connection: connections)
+      fds.push_back(pollfd { connection.fd, POLLIN, 0 });
+    // Short timeout, so `stop` doesn't wait long
+    if (poll(fds.data(), fds.size(), 50) <= 0)
+      continue;
+
+    for (size_t index = fds.size() - 1; index > 0; --index) {
+      if (fds.at(index).revents == 0)
+        continue;
+
+      auto keep = false;
+      std::array<char, 1024> buffer;
+      const auto size = recv(fds.at(index).fd, buffer.data(), buffer.size(), 0);
+      if (size > 0) {
+        connections.at(index - 1).pending.append(buffer.data(), static_cast<size_t>(size));
+        keep = this->handle(connections, index - 1);
+      } else if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        keep = true;
+      }
+      if (!keep)
+        close(index - 1);
+    }
+
+    if (fds.front().revents & POLLIN) {
+      const auto client = accept(fds.front().fd, nullptr, nullptr);
+      if (client >= 0) {
+        logger().debug(F("Accepted connection: "), std::to_string(client));
+        connections.push_back(Connection { client, std::string(), std::nullopt });
+      }
+    }
+  }
+
+  while (!connections.empty())
+    close(connections.size() - 1);
+}
+
+auto MockBroker::handle(std::vector<Connection> &connections, const size_t index) noexcept -> bool {
+  IOP_TRACE();
+  std::array<char, 8> ack;
+  while (true) {
+    auto &connection = connections.at(index);
+    const auto decoded = iop::MqttCodec::decode(connection.pending);
+    if (iop::is_err(decoded))
+      return iop::unwrap_err_ref(decoded, IOP_CTX()) == iop::MqttDecodeError::INCOMPLETE;
+    const auto &packet = iop::unwrap_ok_ref(decoded, IOP_CTX());
+
+    // The first packet must be CONNECT
+    if (!connection.clientId.has_value() && packet.type != iop::MqttPacketType::CONNECT)
+      return false;
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    switch (packet.type) {
+    case iop::MqttPacketType::CONNECT: {
+      const auto connect = iop::MqttCodec::connectOf(packet);
+      if (!connect.has_value() || connection.clientId.has_value())
+        return false;
+      const auto clientId = std::string(connect->clientId);
+      this->connects_.push_back(MockConnect { clientId, std::string(connect->username), std::string(connect->password),
+                                              connect->keepAlive, connect->cleanSession });
+      if (this->refuse_ != 0) {
+        sendAll(connection.fd, ack, iop::MqttCodec::connack(false, this->refuse_, ack));
+        return false;
+      }
+
+      if (connect->cleanSession)
+        this->sessions.erase(clientId);
+      const auto sessionPresent = this->sessions.count(clientId) > 0;
+      auto &session = this->sessions[clientId];
+      session.online = true;
+      connection.clientId = clientId;
+      if (!sendAll(connection.fd, ack, iop::MqttCodec::connack(sessionPresent, 0, ack)))
+        return false;
+
+      for (const auto &[topic, payload]: session.queued)
+        this->send(connection.fd, topic, payload, false);
+      session.queued.clear();
+      break;
+    }
+    case iop::MqttPacketType::PUBLISH: {
+      const auto message = iop::MqttCodec::messageOf(packet);
+      if (!message.has_value())
+        return false;
+      this->published_.push_back(MockPublish { *connection.clientId, std::string(message->topic), std::string(message->payload),
+                                               message->packetId, message->qos, message->retain, message->dup });
+      const auto topic = std::string(message->topic);
+      const auto payload = std::string(message->payload);
+      if (message->retain && payload.empty()) {
+        this->retained.erase(topic);
+      } else if (message->retain) {
+        this->retained.insert_or_assign(topic, payload);
+      }
+
+      if (message->qos > 0 && this->dropAcks_ > 0) {
+        this->dropAcks_--;
+      } else if (message->qos > 0 && !sendAll(connection.fd, ack, iop::MqttCodec::puback(message->packetId, ack))) {
+        return false;
+      }
+      this->deliver(connections, topic, payload);
+      break;
+    }
+    case iop::MqttPacketType::SUBSCRIBE: {
+      const auto subscription = iop::MqttCodec::subscriptionOf(packet);
+      if (!subscription.has_value())
+        return false;
+      const auto topic = std::string(subscription->topic);
+      auto &subscriptions = this->sessions[*connection.clientId].subscriptions;
+      if (std::find(subscriptions.begin(), subscriptions.end(), topic) == subscriptions.end())
+        subscriptions.push_back(topic);
+      const auto qos = static_cast<uint8_t>(std::min<uint8_t>(subscription->qos, 1));
+      if (!sendAll(connection.fd, ack, iop::MqttCodec::suback(subscription->packetId, qos, ack)))
+        return false;
+
+      const auto retained = this->retained.find(topic);
+      if (retained != this->retained.end())
+        this->send(connection.fd, topic, retained->second, true);
+      break;
+    }
+    case iop::MqttPacketType::PINGREQ:
+      this->pings_++;
+      if (!sendAll(connection.fd, ack, iop::MqttCodec::pingresp(ack)))
+        return false;
+      break;
+    case iop::MqttPacketType::DISCONNECT:
+      return false;
+    default:
+      // Acknowledgements of what was sent to the client
+      break;
+    }
+
+    auto &pending = connections.at(index).pending;
+    pending.erase(0, packet.size);
+  }
+}
+
+void MockBroker::deliver(std::vector<Connection> &connections, const std::string &topic, const std::string &payload) noexcept {
+  for (auto &[clientId, session]: this->sessions) {
+    if (std::find(session.subscriptions.begin(), session.subscriptions.end(), topic) == session.subscriptions.end())
+      continue;
+    if (!session.online) {
+      session.queued.emplace_back(topic, payload);
+      continue;
+    }
+    for (const auto &connection: connections) {
+      if (connection.clientId == clientId)
+        this->send(connection.fd, topic, payload, false);
+    }
+  }
+}
+
+auto MockBroker::send(const int32_t fd, const std::string &topic, const std::string &payload, const bool retain) noexcept -> bool {
+  this->lastId = this->lastId == UINT16_MAX ? 1 : this->lastId + 1;
+  std::vector<char> buffer(topic.length() + payload.length() + 16);
+  const auto message = iop::MqttMessage { topic, payload, this->lastId, 1, retain, false };
+  return sendAll(fd, buffer, iop::MqttCodec::publish(message, buffer));
+}
+
+void MockBroker::retain(std::string topic, std::string payload) noexcept {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (payload.empty()) {
+    this->retained.erase(topic);
+    return;
+  }
+  this->retained.insert_or_assign(topic, payload);
+  this->outbox.emplace_back(std::move(topic), std::move(payload));
+}
+
+void MockBroker::dropAcks(const uint32_t count) noexcept {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->dropAcks_ = count;
+}
+
+void MockBroker::refuse(const uint8_t code) noexcept {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->refuse_ = code;
+}
+
+void MockBroker::disconnectAll() noexcept {
+  this->kick = true;
+  // Waits for the broker's thread to notice
+  while (this->running && this->kick)
+    std::this_thread::yield();
+}
+
+auto MockBroker::published() const noexcept -> std::vector<MockPublish> {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->published_;
+}
+
+auto MockBroker::connects() const noexcept -> std::vector<MockConnect> {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->connects_;
+}
+
+auto MockBroker::pings() const noexcept -> uint32_t {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->pings_;
+}
+
+MockBroker::~MockBroker() noexcept {
+  this->stop();
+}
+} // namespace driver
+#endif
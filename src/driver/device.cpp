@@ -12,7 +12,7 @@ namespace driver {
 
 namespace driver {
 auto Device::vcc() const noexcept -> uint16_t {
-    return SIZE_MAX;
+    return UINT16_MAX;
 }
 auto Device::availableFlash() const noexcept -> size_t {
   return SIZE_MAX;
@@ -31,13 +31,24 @@ void Device::deepSleep(uint32_t seconds) const noexcept {
   if (seconds == 0) seconds = INT32_MAX;
   std::this_thread::sleep_for(std::chrono::seconds(seconds));
 }
+static std::array<uint32_t, 128> rtcMemory;
+auto Device::rtcRead(const uint32_t offset, uint32_t *data, const size_t size) const noexcept -> bool {
+  if (offset * 4 + size > sizeof(rtcMemory))
+    return false;
+  memcpy(data, rtcMemory.data() + offset, size);
+  return true;
+}
+auto Device::rtcWrite(const uint32_t offset, uint32_t *data, const size_t size) const noexcept -> bool {
+  if (offset * 4 + size > sizeof(rtcMemory))
+    return false;
+  memcpy(rtcMemory.data() + offset, data, size);
+  return true;
+}
 iop::MD5Hash & Device::binaryMD5() const noexcept {
-  static std::optional<iop::MD5Hash> hash;
-  if (hash.has_value())
-    return iop::unwrap_mut(hash, IOP_CTX());
+  static iop::MD5Hash hash;
   // TODO: actually hash desktop binary that is being run
-  hash = iop::ok(iop::MD5Hash::fromString("AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"));
-  return iop::unwrap_mut(hash, IOP_CTX());
+  hash.fill('A');
+  return hash;
 }
 iop::MacAddress & Device::macAddress() const noexcept {
   static iop::MacAddress mac;
@@ -77,6 +88,12 @@ auto Device::biggestHeapBlock() const noexcept -> size_t {
 void Device::deepSleep(const size_t seconds) const noexcept {
     ESP.deepSleep(seconds * 1000000);
 }
+auto Device::rtcRead(const uint32_t offset, uint32_t *data, const size_t size) const noexcept -> bool {
+    return ESP.rtcUserMemoryRead(offset, data, size);
+}
+auto Device::rtcWrite(const uint32_t offset, uint32_t *data, const size_t size) const noexcept -> bool {
+    return ESP.rtcUserMemoryWrite(offset, data, size);
+}
 iop::MD5Hash & Device::binaryMD5() const noexcept {
   static bool cached = false;
   if (cached)
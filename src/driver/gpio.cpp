@@ -14,6 +14,13 @@ auto GPIO::digitalRead(const Pin pin) const noexcept -> Data {
     (void) pin;
     return Data::HIGH;
 }
+void GPIO::digitalWrite(const Pin pin, const Data data) const noexcept {
+    (void) pin;
+    (void) data;
+}
+auto GPIO::analogRead() const noexcept -> uint16_t {
+    return 0;
+}
 void GPIO::alarm(const Pin pin, const Alarm mode, void (*func)()) const noexcept {
     (void) pin;
     (void) mode;
@@ -33,6 +40,12 @@ void GPIO::mode(const Pin pin, const Mode mode) const noexcept {
 auto GPIO::digitalRead(const Pin pin) const noexcept -> Data {
     return ::digitalRead(static_cast<uint8_t>(pin)) ? Data::HIGH : Data::LOW;
 }
+void GPIO::digitalWrite(const Pin pin, const Data data) const noexcept {
+    ::digitalWrite(static_cast<uint8_t>(pin), static_cast<uint8_t>(data));
+}
+auto GPIO::analogRead() const noexcept -> uint16_t {
+    return static_cast<uint16_t>(::analogRead(A0));
+}
 void GPIO::alarm(const Pin pin, const Alarm mode, void (*func)()) const noexcept {
     ::attachInterrupt(digitalPinToInterrupt(static_cast<uint8_t>(pin)), func, static_cast<uint8_t>(mode));
 }
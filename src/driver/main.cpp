@@ -1,10 +1,40 @@
 #ifdef IOP_DESKTOP
 #ifndef UNIT_TEST
+#include "driver/backend.hpp"
+#include "configuration.hpp"
+
+#include <cstdlib>
+#include <optional>
 #include <unistd.h>
 void setup();
 void loop();
 
+/// IOP_MOCK_BACKEND=1 answers as the server at `config::uri`, so the event loop
+/// can be benchmarked and soak tested without one. IOP_MOCK_LATENCY (ms) and
+/// IOP_MOCK_FAIL_EVERY (nth request fails with 500) tune it
+static auto mockBackend() noexcept -> std::optional<uint16_t> {
+  if (getenv("IOP_MOCK_BACKEND") == nullptr)
+    return std::nullopt;
+  const auto uri = config::uri().toString();
+  return static_cast<uint16_t>(strtoul(uri.substr(uri.rfind(':') + 1).c_str(), nullptr, 10));
+}
+
+static auto envNumber(const char *name) noexcept -> uint32_t {
+  const auto *value = getenv(name);
+  return value == nullptr ? 0 : static_cast<uint32_t>(strtoul(value, nullptr, 10));
+}
+
 int main(int argc, char** argv) {
+  const auto port = mockBackend();
+  std::optional<driver::MockBackend> backend;
+  if (port.has_value()) {
+    backend.emplace(*port);
+    backend->setLatency(envNumber("IOP_MOCK_LATENCY"));
+    backend->failEvery(envNumber("IOP_MOCK_FAIL_EVERY"));
+    if (!backend->start())
+      return 1;
+  }
+
   setup();
   while (true) {
     loop();
@@ -13,4 +43,4 @@ int main(int argc, char** argv) {
   return 0;
 }
 #endif
-#endif
\ No newline at end of file
+#endif
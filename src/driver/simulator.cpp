@@ -0,0 +1,64 @@
+#include "driver/simulator.hpp"
+#include "core/log.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace driver {
+constexpr static float pi = 3.14159265F;
+
+Series::Series() noexcept: Series((SeriesProfile){}, 0) {}
+
+Series::Series(const SeriesProfile profile, const uint32_t seed) noexcept: profile(profile), state(seed == 0 ? 1 : seed), last(NAN), stuckFor(0) {
+  IOP_TRACE();
+  if (this->profile.dayMillis == 0)
+    this->profile.dayMillis = 1;
+}
+
+auto Series::sample(const iop::esp_time now) noexcept -> float {
+  IOP_TRACE();
+  // Random numbers are always drawn, so faults don't change the rest of the series
+  const auto stuck = this->uniform() < this->profile.stuckProbability;
+  const auto failed = this->uniform() < this->profile.failureProbability;
+  const auto noise = this->gaussian() * this->profile.noise;
+
+  if (this->stuckFor > 0) {
+    this->stuckFor--;
+    return this->last;
+  }
+  if (stuck && !std::isnan(this->last) && this->profile.stuckSamples > 0) {
+    this->stuckFor = this->profile.stuckSamples - 1;
+    return this->last;
+  }
+  if (failed)
+    return NAN;
+
+  const auto day = static_cast<float>(now % this->profile.dayMillis) / static_cast<float>(this->profile.dayMillis);
+  const auto days = static_cast<float>(now) / static_cast<float>(this->profile.dayMillis);
+  // Peaks at noon
+  const auto diurnal = -this->profile.amplitude * std::cos(2 * pi * day);
+  const auto value = this->profile.mean + diurnal + this->profile.driftPerDay * days + noise;
+
+  this->last = std::min(std::max(value, this->profile.min), this->profile.max);
+  return this->last;
+}
+
+auto Series::next() noexcept -> uint32_t {
+  this->state ^= this->state << 13;
+  this->state ^= this->state >> 17;
+  this->state ^= this->state << 5;
+  return this->state;
+}
+
+auto Series::uniform() noexcept -> float {
+  // 24 bits fit exactly in a float's mantissa
+  return static_cast<float>(this->next() >> 8) / static_cast<float>(1UL << 24);
+}
+
+auto Series::gaussian() noexcept -> float {
+  // Box-Muller, avoids std::normal_distribution as its output is implementation defined
+  const auto u1 = 1.0F - this->uniform();
+  const auto u2 = this->uniform();
+  return std::sqrt(-2.0F * std::log(u1)) * std::cos(2 * pi * u2);
+}
+} // namespace driver
@@ -0,0 +1,63 @@
+#include "driver/sntp.hpp"
+
+namespace driver {
+Sntp sntp;
+}
+
+#ifdef IOP_DESKTOP
+#include "driver/thread.hpp"
+#include <chrono>
+
+namespace driver {
+static uint32_t updateDelayMillis = 0;
+static std::optional<iop::esp_time> lastUpdate;
+
+void Sntp::setup(const uint32_t intervalMillis) const noexcept {
+  updateDelayMillis = intervalMillis;
+  lastUpdate.reset();
+}
+auto Sntp::synchronized() const noexcept -> std::optional<uint64_t> {
+  const auto now = driver::thisThread.now();
+  if (lastUpdate.has_value() && now - *lastUpdate < updateDelayMillis)
+    return std::nullopt;
+
+  lastUpdate = now;
+  const auto sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch).count();
+}
+}
+#else
+#include "Arduino.h"
+#include <coredecls.h>
+#include <sys/time.h>
+#include <time.h>
+
+namespace driver {
+static uint32_t updateDelayMillis = 60 * 60 * 1000;
+// Set by the SNTP callback, that runs outside of the event loop
+static volatile bool updated = false;
+}
+
+// Overrides the weak default of the SNTP client (1 hour)
+auto sntp_update_delay_MS_rfc_not_less_than_15000() -> uint32_t {
+  return driver::updateDelayMillis;
+}
+
+namespace driver {
+void Sntp::setup(const uint32_t intervalMillis) const noexcept {
+  updateDelayMillis = intervalMillis;
+  settimeofday_cb([]() { updated = true; });
+  // Always UTC, the server handles timezones
+  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+}
+auto Sntp::synchronized() const noexcept -> std::optional<uint64_t> {
+  if (!updated)
+    return std::nullopt;
+  updated = false;
+
+  struct timeval now = {};
+  gettimeofday(&now, nullptr);
+  return static_cast<uint64_t>(now.tv_sec) * 1000 + static_cast<uint64_t>(now.tv_usec) / 1000;
+}
+}
+#endif
@@ -1,9 +1,12 @@
 #include "driver/wifi.hpp"
+#include "core/log.hpp"
 
 namespace driver {
 Wifi wifi;
 }
 #ifdef IOP_DESKTOP
+Wifi WiFi;
+
 namespace driver {
 StationStatus Wifi::status() const noexcept {
     IOP_TRACE()
@@ -0,0 +1,47 @@
+#include "event_encoding.hpp"
+#include <cmath>
+#include <cstring>
+
+static auto writeFloat(char *ptr, const float value) noexcept -> char * {
+  uint32_t raw = 0;
+  memcpy(&raw, &value, sizeof(raw));
+  // Little endian, independently of the host
+  for (uint8_t byte = 0; byte < sizeof(raw); ++byte)
+    *ptr++ = static_cast<char>((raw >> (8 * byte)) & 0xFF); // NOLINT *-pro-bounds-pointer-arithmetic
+  return ptr;
+}
+
+static auto writeUint16(char *ptr, const uint16_t value) noexcept -> char * {
+  *ptr++ = static_cast<char>(value & 0xFF); // NOLINT *-pro-bounds-pointer-arithmetic
+  *ptr++ = static_cast<char>(value >> 8); // NOLINT *-pro-bounds-pointer-arithmetic
+  return ptr;
+}
+
+static auto writeUint32(char *ptr, const uint32_t value) noexcept -> char * {
+  ptr = writeUint16(ptr, static_cast<uint16_t>(value & 0xFFFF));
+  return writeUint16(ptr, static_cast<uint16_t>(value >> 16));
+}
+
+auto encodeEvents(const iop::Span<const Event> events, std::array<char, 1024> &buffer) noexcept -> size_t {
+  IOP_TRACE();
+  auto *ptr = buffer.data();
+  *ptr++ = static_cast<char>(binaryEventSchema); // NOLINT *-pro-bounds-pointer-arithmetic
+  ptr = writeUint16(ptr, binaryEventLayoutId);
+  *ptr++ = static_cast<char>(events.size()); // NOLINT *-pro-bounds-pointer-arithmetic
+  for (const auto &event: events) {
+    for (const auto &field: eventFields) {
+      for (uint8_t index = field.offset; index < field.offset + field.capacity; ++index) {
+        const auto value = event.storage.values.at(index);
+        if (field.type == sensor::FieldType::UINT16) {
+          // NaN can't be represented, so the maximum value is reserved for it
+          ptr = writeUint16(ptr, std::isnan(value) ? UINT16_MAX : static_cast<uint16_t>(value));
+        } else {
+          ptr = writeFloat(ptr, value);
+        }
+      }
+    }
+    ptr = writeUint16(ptr, event.storage.acquisitionMillis);
+    ptr = writeUint32(ptr, event.storage.capturedAt);
+  }
+  return static_cast<size_t>(ptr - buffer.data());
+}
@@ -5,7 +5,8 @@
 #include "driver/flash.hpp"
 #include "core/panic.hpp"
 
-constexpr const uint16_t EEPROM_SIZE = 512;
+// Credentials live in the first 512 bytes, the event queue comes after them
+constexpr const uint16_t credentialsEEPROMSize = 512;
 
 // If another type is to be written to flash be carefull not to mess with what
 // already is there and update the static_assert below. Same deal for removing
@@ -24,9 +25,91 @@ const uint16_t wifiConfigSize = 1 + 32 + 64;
 const uint16_t wifiConfigIndex = 0;
 const uint16_t authTokenIndex = wifiConfigIndex + wifiConfigSize;
 
-static_assert(authTokenIndex + authTokenSize < EEPROM_SIZE,
+static_assert(authTokenIndex + authTokenSize < credentialsEEPROMSize,
               "EEPROM too small to store needed credentials");
 
+/// Ring metadata, stored right before the events. `head` is the index of the
+/// oldest event
+struct EventQueueHeader {
+  uint8_t flag;
+  uint16_t head;
+  uint16_t count;
+  uint32_t dropped;
+};
+
+/// Hashes the event queue's layout (FNV-1a) into its magic byte, so events
+/// written by a firmware with a different `EventStorage` or capacity are
+/// discarded instead of misread. Never 0x00 nor 0xFF, as erased flash is
+constexpr static auto eventQueueLayoutFlag() noexcept -> uint8_t {
+  const std::array<uint32_t, 4> layout = {
+      sizeof(EventQueueHeader), sizeof(EventStorage), eventChannels, config::eventQueueCapacity};
+  uint32_t hash = 2166136261U;
+  for (const auto dimension : layout) {
+    for (uint8_t shift = 0; shift < 32; shift += 8) {
+      hash ^= (dimension >> shift) & 0xFFU;
+      hash *= 16777619U;
+    }
+  }
+  return static_cast<uint8_t>(1 + hash % 254);
+}
+constexpr const uint8_t usedEventQueueEEPROMFlag = eventQueueLayoutFlag();
+static_assert(usedEventQueueEEPROMFlag != 0x00 && usedEventQueueEEPROMFlag != 0xFF,
+              "Event queue flag can't be confused with erased flash");
+
+const uint16_t eventQueueIndex = credentialsEEPROMSize;
+const uint16_t eventQueueSize = sizeof(EventQueueHeader) + config::eventQueueCapacity * sizeof(EventStorage);
+
+#ifdef IOP_DESKTOP
+// Desktop keeps the queue in RAM, so it can be tested without messing with
+// the persisted credentials
+constexpr const uint16_t EEPROM_SIZE = credentialsEEPROMSize;
+static std::array<uint8_t, eventQueueSize> eventQueueRam = {0};
+
+static auto eventQueueStorage() noexcept -> uint8_t * { return eventQueueRam.data(); }
+static void commitEventQueue(const bool force) noexcept { (void)force; }
+#else
+constexpr const uint16_t EEPROM_SIZE = eventQueueIndex + eventQueueSize;
+
+// NOLINTNEXTLINE *-pro-bounds-pointer-arithmetic
+static auto eventQueueStorage() noexcept -> uint8_t * { return driver::flash.asMut() + eventQueueIndex; }
+// Events enqueued since the last commit, they only live in RAM
+static uint8_t uncommittedEvents = 0;
+// Every commit erases and rewrites the whole sector, credentials included. So
+// while offline it's only done every `config::eventQueueCommitInterval`
+// events. Dequeues always commit, but they are one per uploaded batch
+static void commitEventQueue(const bool force) noexcept {
+  uncommittedEvents++;
+  if (!force && uncommittedEvents < config::eventQueueCommitInterval)
+    return;
+  uncommittedEvents = 0;
+  driver::flash.commit();
+}
+#endif
+
+// ESP8266's EEPROM is emulated in a single flash sector
+static_assert(EEPROM_SIZE <= 4096, "Event queue doesn't fit in EEPROM, reduce config::eventQueueCapacity");
+static_assert(config::eventQueueCapacity > 0, "Event queue must hold at least one event");
+static_assert(config::eventQueueCommitInterval > 0, "Event queue must be committed at some point");
+
+static auto readEventQueueHeader() noexcept -> EventQueueHeader {
+  EventQueueHeader header;
+  memcpy(&header, eventQueueStorage(), sizeof(header));
+
+  // Nothing is stored yet (or the layout is corrupted), start fresh
+  if (header.flag != usedEventQueueEEPROMFlag || header.head >= config::eventQueueCapacity || header.count > config::eventQueueCapacity)
+    return (EventQueueHeader) { usedEventQueueEEPROMFlag, 0, 0, 0 };
+  return header;
+}
+
+static void writeEventQueueHeader(const EventQueueHeader &header) noexcept {
+  memcpy(eventQueueStorage(), &header, sizeof(header));
+}
+
+static auto eventQueueSlot(const uint16_t index) noexcept -> uint8_t * {
+  // NOLINTNEXTLINE *-pro-bounds-pointer-arithmetic
+  return eventQueueStorage() + sizeof(EventQueueHeader) + (index % config::eventQueueCapacity) * sizeof(EventStorage);
+}
+
 auto Flash::setup() noexcept -> void { driver::flash.setup(EEPROM_SIZE); }
 
 auto Flash::readAuthToken() const noexcept -> std::optional<std::reference_wrapper<const AuthToken>> {
@@ -149,6 +232,73 @@ void Flash::writeWifiConfig(const WifiCredentials &config) const noexcept {
   driver::flash.put(wifiConfigIndex + 1 + 32, config.password);
   driver::flash.commit();
 }
+
+void Flash::enqueueEvent(const Event &event) const noexcept {
+  IOP_TRACE();
+
+  auto header = readEventQueueHeader();
+  if (header.count == config::eventQueueCapacity) {
+    // Drops the oldest event, it's the least valuable one
+    header.head = static_cast<uint16_t>((header.head + 1) % config::eventQueueCapacity);
+    header.count--;
+    header.dropped++;
+    this->logger.warn(F("Event queue is full, dropped oldest event. Total dropped: "), std::to_string(header.dropped));
+  }
+
+  memcpy(eventQueueSlot(header.head + header.count), &event.storage, sizeof(EventStorage));
+  header.count++;
+  writeEventQueueHeader(header);
+  commitEventQueue(false);
+
+  this->logger.debug(F("Queued event, events in queue: "), std::to_string(header.count));
+}
+
+auto Flash::oldestEvent() const noexcept -> std::optional<Event> {
+  IOP_TRACE();
+  return this->queuedEvent(0);
+}
+
+auto Flash::queuedEvent(const uint16_t index) const noexcept -> std::optional<Event> {
+  IOP_TRACE();
+
+  const auto header = readEventQueueHeader();
+  if (index >= header.count)
+    return std::optional<Event>();
+
+  EventStorage storage;
+  memcpy(&storage, eventQueueSlot(header.head + index), sizeof(EventStorage));
+  return std::make_optional(Event(storage));
+}
+
+void Flash::dequeueEvent() const noexcept {
+  IOP_TRACE();
+  this->dequeueEvents(1);
+}
+
+void Flash::dequeueEvents(uint16_t count) const noexcept {
+  IOP_TRACE();
+
+  auto header = readEventQueueHeader();
+  if (count > header.count)
+    count = header.count;
+  if (count == 0)
+    return;
+
+  header.head = static_cast<uint16_t>((header.head + count) % config::eventQueueCapacity);
+  header.count = static_cast<uint16_t>(header.count - count);
+  writeEventQueueHeader(header);
+  commitEventQueue(true);
+}
+
+auto Flash::queuedEvents() const noexcept -> uint16_t {
+  IOP_TRACE();
+  return readEventQueueHeader().count;
+}
+
+auto Flash::droppedEvents() const noexcept -> uint32_t {
+  IOP_TRACE();
+  return readEventQueueHeader().dropped;
+}
 #endif
 
 #ifdef IOP_FLASH_DISABLED
@@ -182,4 +332,39 @@ void Flash::writeWifiConfig(const WifiCredentials &config) const noexcept {
   IOP_TRACE();
   (void)config;
 }
+void Flash::enqueueEvent(const Event &event) const noexcept {
+  (void)*this;
+  IOP_TRACE();
+  (void)event;
+}
+auto Flash::oldestEvent() const noexcept -> std::optional<Event> {
+  (void)*this;
+  IOP_TRACE();
+  return std::optional<Event>();
+}
+auto Flash::queuedEvent(const uint16_t index) const noexcept -> std::optional<Event> {
+  (void)*this;
+  IOP_TRACE();
+  (void)index;
+  return std::optional<Event>();
+}
+void Flash::dequeueEvent() const noexcept {
+  (void)*this;
+  IOP_TRACE();
+}
+void Flash::dequeueEvents(const uint16_t count) const noexcept {
+  (void)*this;
+  IOP_TRACE();
+  (void)count;
+}
+auto Flash::queuedEvents() const noexcept -> uint16_t {
+  (void)*this;
+  IOP_TRACE();
+  return 0;
+}
+auto Flash::droppedEvents() const noexcept -> uint32_t {
+  (void)*this;
+  IOP_TRACE();
+  return 0;
+}
 #endif
\ No newline at end of file
@@ -55,20 +55,14 @@ static std::string currentLog;
 // TODO(pc): allow gradually sending bytes wifiClient->write(...) instead of
 // buffering the log before sending We can use the already in place system of
 // variadic templates to avoid this buffer
-// TODO(pc): use ByteRate to allow grouping messages before sending, or reuse
-// the TCP connection to many
 
-static bool logNetwork = true;
+// Logs are only queued, `EventLoop` sends them. So logging never re-enters the
+// API, even if sending them logs something
 void reportLog() noexcept {
-  if (!logNetwork || !currentLog.length())
+  if (!currentLog.length())
     return;
 
-  const auto maybeToken = unused4KbSysStack.loop().flash().readAuthToken();
-  if (maybeToken.has_value()) {
-    logNetwork = false;
-    unused4KbSysStack.loop().api().registerLog(iop::unwrap_ref(maybeToken, IOP_CTX()), currentLog);
-    logNetwork = true;
-  }
+  unused4KbSysStack.loop().api().enqueueLog(currentLog);
   currentLog.clear();
 }
 
@@ -78,7 +72,7 @@ static void staticPrinter(const iop::StaticString str,
   iop::LogHook::defaultStaticPrinter(str, level, kind);
 
   const auto charArray = str.asCharPtr();
-  if (logNetwork && level >= iop::LogLevel::CRIT) {
+  if (level >= iop::LogLevel::CRIT) {
     currentLog += charArray;
     byteRate.addBytes(strlen_P(charArray));
     if (kind == iop::LogType::END || kind == iop::LogType::STARTEND)
@@ -88,7 +82,7 @@ static void staticPrinter(const iop::StaticString str,
 static void viewPrinter(const std::string_view str, const iop::LogLevel level, const iop::LogType kind) noexcept {
   iop::LogHook::defaultViewPrinter(str, level, kind);
 
-  if (logNetwork && level >= iop::LogLevel::CRIT) {
+  if (level >= iop::LogLevel::CRIT) {
     currentLog += str;
     byteRate.addBytes(str.length());
     if (kind == iop::LogType::END || kind == iop::LogType::STARTEND)
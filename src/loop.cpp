@@ -1,5 +1,17 @@
 #include "loop.hpp" 
 
+static_assert(Sensors::acquisitionBudgetMillis < config::sampleInterval, "A measurement must finish before the next one starts");
+static_assert(config::sampleInterval <= config::interval, "Summaries must have at least one measurement");
+static_assert((config::reportHeartbeat + config::interval) / config::sampleInterval < UINT16_MAX, "Summary counts would overflow");
+
+// Kept out of EventLoop, as it lives in the 4KB system stack, that is mostly full
+static Aggregator aggregator;
+static ReportPolicy reportPolicy;
+static Clock utcClock;
+#ifdef IOP_NETWORK_TIMING
+static iop::esp_time nextTimingReport = config::networkTimingReportInterval;
+#endif
+
 void EventLoop::setup() noexcept {
     IOP_TRACE();
 
@@ -9,6 +21,7 @@ void EventLoop::setup() noexcept {
     Flash::setup();
     reset::setup();
     this->sensors.setup();
+    utcClock.setup();
     this->api().setup();
     this->credentialsServer.setup();
     this->logger.info(F("Setup finished"));
@@ -35,11 +48,48 @@ void EventLoop::loop() noexcept {
 
     const auto now = driver::thisThread.now();
 
+    if (utcClock.handle(now))
+        this->logger.debug(F("Clock synchronized, drift (ppm): "), std::to_string(utcClock.driftPpm()));
+
     const auto isConnected = iop::Network::isConnected();
     const auto hasAuthToken = authToken.has_value();
     if (isConnected && hasAuthToken)
         this->credentialsServer.close();
 
+    // Requests started by `iop::Network::start` progress while the loop runs
+    this->api().network().poll();
+
+#ifdef IOP_MQTT
+    // Keeps the broker's connection alive, upgrades arrive through it
+    if (isConnected && hasAuthToken)
+        iop::Network::pollMqtt();
+#endif
+
+    // Acquisition doesn't depend on the network, measurements taken offline
+    // are stored in flash with the summaries below
+    if (this->nextMeasurement <= now && !this->sensors.isMeasuring()) {
+        this->nextMeasurement = now + config::sampleInterval;
+        this->logger.trace(F("Start Measurements"));
+        this->sensors.start();
+    }
+
+    // Sensors settle asynchronously, so every iteration advances the measurement
+    if (this->sensors.isMeasuring()) {
+        auto maybeEvent = this->sensors.poll();
+        if (maybeEvent.has_value()) {
+            auto storage = iop::unwrap(maybeEvent, IOP_CTX());
+            storage.capturedAt = utcClock.unixSeconds(now - storage.acquisitionMillis);
+            aggregator.add(Event(storage));
+        }
+    }
+
+    // Summaries can't be sent while offline, so the averages are stored to be sent later
+    if (!(isConnected && hasAuthToken) && this->nextSummary <= now && !aggregator.isEmpty()) {
+        this->nextSummary = now + config::interval;
+        this->flash().enqueueEvent(aggregator.mean());
+        aggregator.reset();
+    }
+
     if (!hasAuthToken) {
         this->handleCredentials();
 
@@ -62,18 +112,52 @@ void EventLoop::loop() noexcept {
           // No-op, we must just wait
         }
 
-    } else if (this->nextMeasurement <= now) {
+    } else if (this->api().nextOutbound() == OutboundKind::PANIC) {
+        // A single request is sent per iteration. Panics come first, then
+        // authentication (above), events and the queued logs (below)
+        this->nextHandleConnectionLost = 0;
+        this->handleOutbound(iop::unwrap_ref(authToken, IOP_CTX()));
+
+    } else if (this->nextSummary <= now && !aggregator.isEmpty()) {
+        this->nextHandleConnectionLost = 0;
+        this->nextSummary = now + config::interval;
+        this->handleMeasurements(iop::unwrap_ref(authToken, IOP_CTX()), now);
+
+    } else if (this->nextQueuedEvent <= now && this->flash().queuedEvents() > 0) {
+        // Drains one batch of stored events per iteration, to keep the loop responsive
+        this->nextHandleConnectionLost = 0;
+        this->handleQueuedEvents(iop::unwrap_ref(authToken, IOP_CTX()), now);
+
+    } else if (this->api().nextOutbound().has_value()) {
+        this->nextHandleConnectionLost = 0;
+        this->handleOutbound(iop::unwrap_ref(authToken, IOP_CTX()));
+
+#ifdef IOP_NETWORK_TIMING
+    } else if (nextTimingReport <= now) {
         this->nextHandleConnectionLost = 0;
-        this->nextMeasurement = now + config::interval;
-        this->handleMeasurements(iop::unwrap_ref(authToken, IOP_CTX()));
-        //this->logger.info(std::to_string(ESP.getVcc())); // TODO: remove this
-        
+        nextTimingReport = now + config::networkTimingReportInterval;
+        // The logger only uploads critical logs, so the metrics are queued
+        // explicitly, to be sent to /v1/log by `handleOutbound`
+        const auto metrics = iop::Network::timingMetrics(unused4KbSysStack.text());
+        if (metrics.has_value() && *metrics != "{}") {
+          this->logger.info(F("Network timings: "), *metrics);
+          if (!this->api().enqueueLog(*metrics))
+            this->logger.warn(F("Outbound queue is full, network timings dropped"));
+        }
+#endif
+
     } else if (this->nextYieldLog <= now) {
         this->nextHandleConnectionLost = 0;
         constexpr const uint16_t tenSeconds = 10000;
         this->nextYieldLog = now + tenSeconds;
         this->logger.trace(F("Waiting"));
 
+        const auto retry = iop::Network::retryState();
+        if (retry.backingOff > 0 || retry.breakerOpen)
+          this->logger.debug(F("Backing off endpoints: "), std::to_string(retry.backingOff),
+                             F(", circuit breaker open: "), retry.breakerOpen ? F("yes") : F("no"),
+                             F(", requests suppressed: "), std::to_string(retry.suppressed));
+
     } else {
         this->nextHandleConnectionLost = 0;
     }
@@ -165,13 +249,33 @@ void EventLoop::handleCredentials() noexcept {
       this->flash().writeAuthToken(iop::unwrap_ref(maybeToken, IOP_CTX()));
 }
 
-void EventLoop::handleMeasurements(const AuthToken &token) noexcept {
+void EventLoop::handleMeasurements(const AuthToken &token, const iop::esp_time now) noexcept {
     IOP_TRACE();
 
     this->logger.debug(F("Handle Measurements"));
 
-    const auto measurements = sensors.measure();
-    const auto status = this->api().registerEvent(token, measurements);
+    // The measurements are kept, so the next summary sent covers this period too
+    if (!reportPolicy.shouldReport(aggregator.summary(), now)) {
+      reportPolicy.suppressed();
+      this->logger.debug(F("Measurements within deadband, summaries suppressed: "), std::to_string(reportPolicy.counters().suppressed));
+      return;
+    }
+
+    const auto summary = aggregator.summary();
+    const auto mean = aggregator.mean();
+    aggregator.reset();
+    reportPolicy.reported(mean, now);
+    const auto counters = reportPolicy.counters();
+    this->logger.info(F("Summaries sent: "), std::to_string(counters.sent), F(", suppressed: "), std::to_string(counters.suppressed));
+
+    // Events must be sent oldest-first, so if there is a backlog this one
+    // waits its turn
+    if (this->flash().queuedEvents() > 0) {
+      this->flash().enqueueEvent(mean);
+      return;
+    }
+
+    const auto status = this->api().registerSummary(token, summary, counters);
 
     switch (status) {
     case iop::NetworkStatus::FORBIDDEN:
@@ -182,12 +286,14 @@ void EventLoop::handleMeasurements(const AuthToken &token) noexcept {
 
     case iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW:
       this->logger.error(F("Unable to send measurements"));
-      iop_panic(F("Api::registerEvent internal buffer overflow"));
+      iop_panic(F("Api::registerSummary internal buffer overflow"));
 
     // Already logged at the Network level
     case iop::NetworkStatus::BROKEN_SERVER:
     case iop::NetworkStatus::CONNECTION_ISSUES:
-      // Nothing to be done besides retrying later
+      // Only the averages are stored to be retried when the server is reachable again
+      this->flash().enqueueEvent(mean);
+      return;
 
     case iop::NetworkStatus::OK: // Cool beans
       return;
@@ -195,4 +301,80 @@ void EventLoop::handleMeasurements(const AuthToken &token) noexcept {
 
     this->logger.error(F("Unexpected status, EventLoop::handleMeasurements: "),
                        iop::Network::apiStatusToString(status));
-}
\ No newline at end of file
+}
+
+void EventLoop::handleQueuedEvents(const AuthToken &token, const iop::esp_time now) noexcept {
+    IOP_TRACE();
+
+    // Static so a batch is neither on the stack nor on the heap
+    static std::array<Event, config::eventBatchSize> events;
+    uint16_t count = 0;
+    for (; count < config::eventBatchSize; ++count) {
+      auto maybeEvent = this->flash().queuedEvent(count);
+      if (!maybeEvent.has_value())
+        break;
+      events.at(count) = iop::unwrap(maybeEvent, IOP_CTX());
+    }
+    if (count == 0)
+      return;
+
+    this->logger.debug(F("Sending queued events, events in queue: "), std::to_string(this->flash().queuedEvents()));
+    const auto result = this->api().registerEvents(token, iop::Span<const Event>(events.data(), count));
+
+    // Whatever the server accepted must not be sent again
+    this->flash().dequeueEvents(static_cast<uint16_t>(result.sent));
+
+    switch (result.status) {
+    case iop::NetworkStatus::FORBIDDEN:
+      this->logger.error(F("Unable to send queued events"));
+      this->logger.warn(F("Auth token was refused, deleting it"));
+      this->flash().removeAuthToken();
+      return;
+
+    case iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW:
+      this->logger.error(F("Unable to send queued events"));
+      iop_panic(F("Api::registerEvents internal buffer overflow"));
+
+    // Already logged at the Network level
+    case iop::NetworkStatus::BROKEN_SERVER:
+    case iop::NetworkStatus::CONNECTION_ISSUES:
+      // Server is still unreachable, there is no point trying before the next
+      // summary, or before the network layer allows it
+      this->nextQueuedEvent = std::max(this->nextSummary, now + this->api().network().retryIn(F("/v1/events")));
+      return;
+
+    case iop::NetworkStatus::OK:
+      return;
+    }
+
+    this->logger.error(F("Unexpected status, EventLoop::handleQueuedEvents: "),
+                       iop::Network::apiStatusToString(result.status));
+}
+
+void EventLoop::handleOutbound(const AuthToken &token) noexcept {
+    IOP_TRACE();
+
+    const auto status = this->api().drain(token);
+    if (!status.has_value())
+      return;
+
+    switch (*status) {
+    case iop::NetworkStatus::FORBIDDEN:
+      this->logger.error(F("Unable to send queued request"));
+      this->logger.warn(F("Auth token was refused, deleting it"));
+      this->flash().removeAuthToken();
+      return;
+
+    case iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW:
+      iop_panic(F("Api::drain internal buffer overflow"));
+
+    // Already logged at the Network level, it stays queued to be retried
+    case iop::NetworkStatus::BROKEN_SERVER:
+    case iop::NetworkStatus::CONNECTION_ISSUES:
+    case iop::NetworkStatus::OK:
+      return;
+    }
+
+    this->logger.error(F("Unexpected status, EventLoop::handleOutbound: "),
+                       iop::Network::apiStatusToString(*status));
+}
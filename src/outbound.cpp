@@ -0,0 +1,137 @@
+#include "outbound.hpp"
+#include "core/log.hpp"
+
+#include <cstring>
+
+OutboundQueue::OutboundQueue() noexcept: buffer({}), entries({}), count(0), used(0), nextId(1), dropped_(0) {
+  IOP_TRACE();
+}
+
+auto OutboundQueue::push(const OutboundKind kind, const std::string_view payload) noexcept -> bool {
+  IOP_TRACE();
+  if (payload.empty() || this->coalesce(kind, payload))
+    return true;
+
+  const auto fits = this->count < maxRequests && this->used + payload.length() <= capacity;
+  if (!fits && !this->evictFor(kind, payload.length())) {
+    this->dropped_++;
+    return false;
+  }
+
+  this->entries.at(this->count) = (Entry) { this->nextId++, kind, this->used, 0, false };
+  this->count++;
+  this->append(payload);
+  return true;
+}
+
+auto OutboundQueue::front() noexcept -> std::optional<Outbound> {
+  IOP_TRACE();
+  const auto index = this->frontIndex();
+  if (!index.has_value())
+    return std::nullopt;
+
+  auto &entry = this->entries.at(*index);
+  entry.sealed = true;
+  return (Outbound) { entry.id, entry.kind, this->view(entry) };
+}
+
+auto OutboundQueue::nextKind() const noexcept -> std::optional<OutboundKind> {
+  IOP_TRACE();
+  const auto index = this->frontIndex();
+  if (!index.has_value())
+    return std::nullopt;
+  return this->entries.at(*index).kind;
+}
+
+auto OutboundQueue::remove(const uint32_t id) noexcept -> bool {
+  IOP_TRACE();
+  for (uint8_t index = 0; index < this->count; ++index) {
+    if (this->entries.at(index).id == id) {
+      this->erase(index);
+      return true;
+    }
+  }
+  return false;
+}
+
+auto OutboundQueue::coalesce(const OutboundKind kind, const std::string_view payload) noexcept -> bool {
+  if (kind == OutboundKind::PANIC) {
+    for (uint8_t index = 0; index < this->count; ++index) {
+      const auto &entry = this->entries.at(index);
+      if (entry.kind == kind && this->view(entry) == payload)
+        return true;
+    }
+    return false;
+  }
+
+  // Only the newest request can grow, as the buffer is compact
+  if (this->count == 0)
+    return false;
+  const auto &last = this->entries.at(this->count - 1);
+  if (last.kind != kind || last.sealed || this->used + payload.length() > capacity)
+    return false;
+  this->append(payload);
+  return true;
+}
+
+void OutboundQueue::append(const std::string_view payload) noexcept {
+  auto &last = this->entries.at(this->count - 1);
+  memcpy(this->buffer.data() + this->used, payload.data(), payload.length()); // NOLINT *-pro-bounds-pointer-arithmetic
+  last.length = static_cast<uint16_t>(last.length + payload.length());
+  this->used = static_cast<uint16_t>(this->used + payload.length());
+}
+
+auto OutboundQueue::frontIndex() const noexcept -> std::optional<uint8_t> {
+  std::optional<uint8_t> best;
+  for (uint8_t index = 0; index < this->count; ++index) {
+    if (!best.has_value() || this->entries.at(index).kind < this->entries.at(*best).kind)
+      best = index;
+  }
+  return best;
+}
+
+auto OutboundQueue::evictFor(const OutboundKind kind, const size_t length) noexcept -> bool {
+  // Checks first, so nothing is evicted in vain
+  size_t freeable = capacity - this->used;
+  uint8_t slots = maxRequests - this->count;
+  for (uint8_t index = 0; index < this->count; ++index) {
+    const auto &entry = this->entries.at(index);
+    if (entry.kind > kind) {
+      freeable += entry.length;
+      slots++;
+    }
+  }
+  if (freeable < length || slots == 0)
+    return false;
+
+  while (this->count == maxRequests || this->used + length > capacity) {
+    // Lowest priority, newest first
+    uint8_t victim = 0;
+    for (uint8_t index = 0; index < this->count; ++index) {
+      if (this->entries.at(index).kind >= this->entries.at(victim).kind)
+        victim = index;
+    }
+    this->erase(victim);
+    this->dropped_++;
+  }
+  return true;
+}
+
+void OutboundQueue::erase(const uint8_t index) noexcept {
+  const auto entry = this->entries.at(index);
+  const auto end = entry.offset + entry.length;
+  char *start = this->buffer.data() + entry.offset; // NOLINT *-pro-bounds-pointer-arithmetic
+  memmove(start, start + entry.length, this->used - end); // NOLINT *-pro-bounds-pointer-arithmetic
+  this->used = static_cast<uint16_t>(this->used - entry.length);
+
+  for (uint8_t next = index + 1; next < this->count; ++next) {
+    auto moved = this->entries.at(next);
+    moved.offset = static_cast<uint16_t>(moved.offset - entry.length);
+    this->entries.at(next - 1) = moved;
+  }
+  this->count--;
+}
+
+auto OutboundQueue::view(const Entry &entry) const noexcept -> std::string_view {
+  return std::string_view(this->buffer.data() + entry.offset, entry.length); // NOLINT *-pro-bounds-pointer-arithmetic
+}
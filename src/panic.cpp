@@ -3,6 +3,7 @@
 
 #include "loop.hpp"
 #include "driver/device.hpp"
+#include <algorithm>
 
 void upgrade() noexcept {
   IOP_TRACE();
@@ -122,13 +123,23 @@ static void halt(const std::string_view &msg,
         reportedPanic =
             reportPanic(msg, point.file(), point.line(), point.func());
 
+      // The event loop won't send the queued logs anymore, they may explain the panic
+      const auto &maybeToken = unused4KbSysStack.loop().flash().readAuthToken();
+      const auto &token = iop::unwrap_ref(maybeToken, IOP_CTX());
+      for (uint8_t request = 0; request < OutboundQueue::maxRequests; ++request) {
+        if (unused4KbSysStack.loop().api().drain(token) != iop::NetworkStatus::OK)
+          break;
+      }
+
       // Panic data is lost if report fails but upgrade works
       // Doesn't return if upgrade succeeds
       upgrade();
     } else {
       iop::panicLogger().warn(F("No network, unable to recover"));
     }
-    driver::device.deepSleep(oneHour);
+    // Jittered, so a fleet that panicked together doesn't retry together
+    const auto sleepFor = std::min<iop::esp_time>(iop::Network::jitter(oneHour), oneHour);
+    driver::device.deepSleep(static_cast<uint32_t>(sleepFor));
 
     // Let's allow the wifi to reconnect
     WiFi.forceSleepWake();
@@ -0,0 +1,53 @@
+#include "report.hpp"
+#include "configuration.hpp"
+#include <cmath>
+
+/// If any sample of the field is further than `deadband` from the last
+/// reported value. Comparing the extremes instead of the mean means a short
+/// spike isn't diluted by a long calm period
+static auto leftDeadband(const FieldSummary &field, const float reference, const float deadband) noexcept -> bool {
+  IOP_TRACE();
+  // A sensor starting or stopping to answer is a change
+  if (std::isnan(reference) || field.count == 0)
+    return std::isnan(reference) != (field.count == 0);
+  return std::fabs(field.max - reference) > deadband || std::fabs(field.min - reference) > deadband;
+}
+
+ReportPolicy::ReportPolicy() noexcept: reference(), lastReport(0), counters_((ReportCounters){0, 0}) {
+  IOP_TRACE();
+}
+
+auto ReportPolicy::shouldReport(const Summary &summary, const iop::esp_time now) const noexcept -> bool {
+  IOP_TRACE();
+  if (!this->reference.has_value())
+    return true;
+  // Unsigned subtraction handles `millis()` overflow
+  if (now - this->lastReport >= config::reportHeartbeat)
+    return true;
+
+  const auto &reference = iop::unwrap_ref(this->reference, IOP_CTX()).storage;
+  for (const auto &field: eventFields) {
+    for (uint8_t index = field.offset; index < field.offset + field.capacity; ++index) {
+      if (leftDeadband(summary.channels.at(index), reference.values.at(index), field.deadband))
+        return true;
+    }
+  }
+  return false;
+}
+
+void ReportPolicy::reported(const Event &mean, const iop::esp_time now) noexcept {
+  IOP_TRACE();
+  this->reference.emplace(mean);
+  this->lastReport = now;
+  this->counters_.sent++;
+}
+
+void ReportPolicy::suppressed() noexcept {
+  IOP_TRACE();
+  this->counters_.suppressed++;
+}
+
+auto ReportPolicy::counters() const noexcept -> ReportCounters {
+  IOP_TRACE();
+  return this->counters_;
+}
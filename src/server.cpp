@@ -311,48 +311,57 @@ void CredentialsServer::connect(std::string_view ssid,
   }
 }
 
-auto CredentialsServer::authenticate(std::string_view username,
+void CredentialsServer::authenticate(std::string_view username,
                                      std::string_view password,
-                                     const Api &api) const noexcept
+                                     const Api &api) const noexcept {
+  IOP_TRACE();
+  this->logger.info(F("Trying to authenticate: "), username);
+  const auto status = api.startAuthentication(username, std::move(password));
+  if (status != iop::NetworkStatus::OK)
+    this->authenticationFailed(status);
+}
+
+auto CredentialsServer::authenticated(const Api &api) const noexcept
     -> std::optional<AuthToken> {
   IOP_TRACE();
-  WiFi.mode(WIFI_STA);
+  auto maybeToken = api.authenticated();
+  if (!maybeToken.has_value())
+    return std::optional<AuthToken>();
 
-  auto authToken = api.authenticate(username, std::move(password));
-  
-  WiFi.mode(WIFI_AP_STA);
-  this->logger.info(F("Tried to authenticate: "));
+  auto &authToken = iop::unwrap_mut(maybeToken, IOP_CTX());
   if (iop::is_err(authToken)) {
-    const auto &status = iop::unwrap_err_ref(authToken, IOP_CTX());
-
-    switch (status) {
-    case iop::NetworkStatus::FORBIDDEN:
-      this->logger.error(F("Invalid IoP credentials ("),
-                         iop::Network::apiStatusToString(status), F("): "),
-                         std::move(username));
-      return std::optional<AuthToken>();
-
-    case iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW:
-      iop_panic(F("CredentialsServer::authenticate internal buffer overflow"));
-
-    // Already logged at the Network level
-    case iop::NetworkStatus::CONNECTION_ISSUES:
-    case iop::NetworkStatus::BROKEN_SERVER:
-      // Nothing to be done besides retrying later
-      return std::optional<AuthToken>();
-
-    case iop::NetworkStatus::OK:
-      // On success an AuthToken is returned, not OK
-      iop_panic(F("Unreachable"));
-    }
-
-    const auto str = iop::Network::apiStatusToString(status);
-    this->logger.crit(F("CredentialsServer::authenticate bad status: "), str);
+    this->authenticationFailed(iop::unwrap_err_ref(authToken, IOP_CTX()));
     return std::optional<AuthToken>();
   }
   return std::make_optional(std::move(iop::unwrap_ok_mut(authToken, IOP_CTX())));
 }
 
+void CredentialsServer::authenticationFailed(const iop::NetworkStatus status) const noexcept {
+  IOP_TRACE();
+  switch (status) {
+  case iop::NetworkStatus::FORBIDDEN:
+    this->logger.error(F("Invalid IoP credentials ("),
+                       iop::Network::apiStatusToString(status), F(")"));
+    return;
+
+  case iop::NetworkStatus::CLIENT_BUFFER_OVERFLOW:
+    iop_panic(F("CredentialsServer::authenticate internal buffer overflow"));
+
+  // Already logged at the Network level
+  case iop::NetworkStatus::CONNECTION_ISSUES:
+  case iop::NetworkStatus::BROKEN_SERVER:
+    // Nothing to be done besides retrying later
+    return;
+
+  case iop::NetworkStatus::OK:
+    // On success an AuthToken is returned, not OK
+    iop_panic(F("Unreachable"));
+  }
+
+  const auto str = iop::Network::apiStatusToString(status);
+  this->logger.crit(F("CredentialsServer::authenticate bad status: "), str);
+}
+
 auto CredentialsServer::serve(const std::optional<WifiCredentials> &storedWifi,
                               const Api &api) noexcept
     -> std::optional<AuthToken> {
@@ -374,9 +383,7 @@ auto CredentialsServer::serve(const std::optional<WifiCredentials> &storedWifi,
   
   if (isConnected && credentialsIop.has_value()) {
     const auto iop = iop::unwrap(credentialsIop, IOP_CTX());
-    auto tok = this->authenticate(iop.first, iop.second, api);
-    if (tok.has_value())
-      return tok;
+    this->authenticate(iop.first, iop.second, api);
 
     // WiFi Credentials stored in flash
 
@@ -418,17 +425,21 @@ auto CredentialsServer::serve(const std::optional<WifiCredentials> &storedWifi,
 
   const auto hasHardcodedIopCreds = config::iopEmail().has_value() && config::iopPassword().has_value();
   if (isConnected && hasHardcodedIopCreds && this->nextTryHardcodedIopCredentials <= now) {
-    this->nextTryHardcodedIopCredentials = now + intervalTryHardcodedIopCredentialsMillis;
+    // Jittered, so devices that booted together don't hit the server in sync
+    this->nextTryHardcodedIopCredentials = now + iop::Network::jitter(intervalTryHardcodedIopCredentialsMillis);
 
     this->logger.info(F("Trying hardcoded iop credentials"));
 
     const auto email = iop::unwrap_ref(config::iopEmail(), IOP_CTX());
     const auto password = iop::unwrap_ref(config::iopPassword(), IOP_CTX());
-    const auto tok = this->authenticate(email.toString(), password.toString(), api);
-    if (tok.has_value())
-      return tok;
+    this->authenticate(email.toString(), password.toString(), api);
   }
 
+  // Logins started above are answered while the portal is served
+  const auto tok = this->authenticated(api);
+  if (tok.has_value())
+    return tok;
+
   // Give processing time to the servers
   this->logger.trace(F("Serve captive portal"));
   dnsServer.handleClient();
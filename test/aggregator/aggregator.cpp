@@ -0,0 +1,64 @@
+#include "aggregator.hpp"
+
+#include <unity.h>
+#include <cmath>
+
+void fieldSummary() {
+    auto field = (FieldSummary){};
+    field.add(2);
+    field.add(NAN);
+    field.add(4);
+    field.add(9);
+
+    // Failed reads are ignored
+    TEST_ASSERT_EQUAL(3, field.count);
+    TEST_ASSERT_EQUAL_FLOAT(2, field.min);
+    TEST_ASSERT_EQUAL_FLOAT(9, field.max);
+    TEST_ASSERT_EQUAL_FLOAT(5, field.mean);
+    TEST_ASSERT_EQUAL_FLOAT(26.0F / 3.0F, field.variance());
+}
+
+auto sample(const uint16_t acquisitionMillis, const uint32_t capturedAt = 0) -> Event {
+    auto storage = (EventStorage){};
+    storage.values.fill(NAN);
+    storage.acquisitionMillis = acquisitionMillis;
+    storage.capturedAt = capturedAt;
+    return Event(storage);
+}
+
+void aggregator() {
+    Aggregator aggregator;
+    TEST_ASSERT(aggregator.isEmpty());
+
+    // Samples taken before the clock was synchronized have no timestamp
+    aggregator.add(sample(10));
+    aggregator.add(sample(20, 1000));
+    aggregator.add(sample(30, 1020));
+    TEST_ASSERT(!aggregator.isEmpty());
+
+    const auto &summary = aggregator.summary();
+    TEST_ASSERT_EQUAL(3, summary.samples);
+    TEST_ASSERT_EQUAL(3, summary.acquisitionMillis.count);
+    TEST_ASSERT_EQUAL(1000, summary.from);
+    TEST_ASSERT_EQUAL(1020, summary.to);
+    for (const auto &channel: summary.channels)
+        TEST_ASSERT_EQUAL(0, channel.count);
+
+    const auto mean = aggregator.mean();
+    TEST_ASSERT_EQUAL(20, mean.storage.acquisitionMillis);
+    TEST_ASSERT_EQUAL(1010, mean.storage.capturedAt);
+    for (const auto value: mean.storage.values)
+        TEST_ASSERT(std::isnan(value));
+
+    aggregator.reset();
+    TEST_ASSERT(aggregator.isEmpty());
+    TEST_ASSERT_EQUAL(0, aggregator.summary().acquisitionMillis.count);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(fieldSummary);
+    RUN_TEST(aggregator);
+    UNITY_END();
+    return 0;
+}
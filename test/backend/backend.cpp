@@ -0,0 +1,138 @@
+#include "driver/backend.hpp"
+#include "driver/client.hpp"
+
+#include <unity.h>
+#include <chrono>
+#include <string>
+
+static driver::MockBackend backend(0);
+static WiFiClient wifiClient;
+static HTTPClient http;
+
+static auto request(const std::string &method, const std::string &path, const std::string &body = "") -> int {
+    http.begin(wifiClient, std::string("http://127.0.0.1:") + std::to_string(backend.port()) + path);
+    http.setTimeout(1000);
+    const auto code = http.sendRequest(method, reinterpret_cast<const uint8_t *>(body.data()), body.length());
+    http.end();
+    return code;
+}
+
+void defaults() {
+    backend.clear();
+    TEST_ASSERT_EQUAL(200, request("POST", "/v1/user/login", "{\"email\":\"a@b.c\"}"));
+    TEST_ASSERT_EQUAL(64, http.getString().length());
+    TEST_ASSERT_EQUAL(200, request("POST", "/v1/event", "{}"));
+    TEST_ASSERT_EQUAL(200, request("POST", "/v1/log?level=info", "log"));
+    TEST_ASSERT_EQUAL(404, request("GET", "/v1/unknown"));
+
+    const auto received = backend.received();
+    TEST_ASSERT_EQUAL(4, received.size());
+    TEST_ASSERT_EQUAL_STRING("POST", received.at(0).method.c_str());
+    TEST_ASSERT_EQUAL_STRING("/v1/user/login", received.at(0).path.c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"email\":\"a@b.c\"}", received.at(0).body.c_str());
+    TEST_ASSERT_EQUAL_STRING("/v1/log", received.at(2).path.c_str());
+    TEST_ASSERT(received.at(2).header("Content-Length") == std::string_view("3"));
+    TEST_ASSERT_EQUAL(1, backend.receivedCount("/v1/event"));
+    TEST_ASSERT_EQUAL(4, backend.receivedCount());
+}
+
+void errors() {
+    backend.clear();
+    driver::MockResponse forbidden;
+    forbidden.status = 403;
+    driver::MockResponse broken;
+    broken.status = 500;
+    backend.script("/v1/log", forbidden);
+    backend.script("/v1/log", broken);
+
+    TEST_ASSERT_EQUAL(403, request("POST", "/v1/log", "a"));
+    TEST_ASSERT_EQUAL(500, request("POST", "/v1/log", "b"));
+    // Scripts are consumed
+    TEST_ASSERT_EQUAL(200, request("POST", "/v1/log", "c"));
+
+    backend.fallback("/v1/panic", forbidden);
+    TEST_ASSERT_EQUAL(403, request("POST", "/v1/panic", "a"));
+    TEST_ASSERT_EQUAL(403, request("POST", "/v1/panic", "b"));
+    backend.fallback("/v1/panic", driver::MockResponse());
+
+    backend.failEvery(2);
+    TEST_ASSERT_EQUAL(200, request("POST", "/v1/event", "a"));
+    TEST_ASSERT_EQUAL(500, request("POST", "/v1/event", "b"));
+    backend.failEvery(0);
+}
+
+void truncated() {
+    backend.clear();
+    driver::MockResponse response;
+    response.body = std::string(64, 'T');
+    response.truncateAt = 80;
+    backend.script("/v1/user/login", response);
+
+    TEST_ASSERT(request("POST", "/v1/user/login", "{}") < 0);
+    // The next connection is fine
+    TEST_ASSERT_EQUAL(200, request("POST", "/v1/user/login", "{}"));
+    TEST_ASSERT_EQUAL(64, http.getString().length());
+}
+
+void slow() {
+    backend.clear();
+    driver::MockResponse response;
+    response.body = std::string(64, 'T');
+    response.chunkSize = 16;
+    response.chunkDelay = 20;
+    backend.script("/v1/user/login", response);
+
+    auto start = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(200, request("POST", "/v1/user/login", "{}"));
+    TEST_ASSERT_EQUAL(64, http.getString().length());
+    TEST_ASSERT(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(100));
+
+    backend.setLatency(50);
+    start = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(200, request("POST", "/v1/event", "{}"));
+    TEST_ASSERT(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+    backend.setLatency(0);
+
+    // Slower than the client is willing to wait
+    response.body.clear();
+    response.chunkSize = 0;
+    response.latency = 1500;
+    backend.script("/v1/event", response);
+    TEST_ASSERT_EQUAL(HTTPC_ERROR_READ_TIMEOUT, request("POST", "/v1/event", "{}"));
+}
+
+void upgrade() {
+    backend.clear();
+    const char *headers[] = {"LATEST_VERSION"};
+    http.collectHeaders(headers, 1);
+
+    const auto md5 = std::string(32, 'A');
+    backend.setLatestVersion(md5);
+    TEST_ASSERT_EQUAL(200, request("POST", "/v1/event", "{}"));
+    TEST_ASSERT_EQUAL_STRING(md5.c_str(), http.header("LATEST_VERSION").c_str());
+
+    http.begin(wifiClient, std::string("http://127.0.0.1:") + std::to_string(backend.port()) + "/v1/update");
+    http.addHeader(F("If-None-Match"), std::string("\"") + md5 + "\"");
+    TEST_ASSERT_EQUAL(304, http.sendRequest("HEAD", nullptr, 0));
+    http.end();
+    TEST_ASSERT_EQUAL(200, request("HEAD", "/v1/update"));
+
+    const auto received = backend.received();
+    TEST_ASSERT_EQUAL_STRING("HEAD", received.at(1).method.c_str());
+    TEST_ASSERT(received.at(1).header("if-none-match") == std::string_view("\"" + md5 + "\""));
+    backend.setLatestVersion(std::nullopt);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    TEST_ASSERT(backend.start());
+    TEST_ASSERT(backend.port() != 0);
+    RUN_TEST(defaults);
+    RUN_TEST(errors);
+    RUN_TEST(truncated);
+    RUN_TEST(slow);
+    RUN_TEST(upgrade);
+    backend.stop();
+    UNITY_END();
+    return 0;
+}
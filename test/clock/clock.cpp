@@ -0,0 +1,53 @@
+#include "clock.hpp"
+
+#include <unity.h>
+
+constexpr static uint64_t epoch = 1700000000000;
+constexpr static iop::esp_time hour = 60 * 60 * 1000;
+
+void unsynchronized() {
+    Clock clock;
+    TEST_ASSERT(!clock.isSynchronized());
+    TEST_ASSERT_EQUAL(0, clock.unixSeconds(1000));
+}
+
+void mapping() {
+    Clock clock;
+    clock.synchronized(5000, epoch);
+    TEST_ASSERT(clock.isSynchronized());
+    TEST_ASSERT(clock.unixMillis(6000) == epoch + 1000);
+    // Measurements taken before the synchronization
+    TEST_ASSERT(clock.unixMillis(1000) == epoch - 4000);
+    TEST_ASSERT_EQUAL(epoch / 1000 + 1, clock.unixSeconds(6000));
+}
+
+void drift() {
+    Clock clock;
+    clock.synchronized(0, epoch);
+    // millis() runs 100ppm slow: an hour of NTP time is 360ms shorter on it
+    clock.synchronized(hour - 360, epoch + hour);
+    TEST_ASSERT_INT_WITHIN(1, 100, clock.driftPpm());
+
+    // The next hour is corrected
+    const auto expected = epoch + 2 * hour;
+    TEST_ASSERT_INT_WITHIN(2, 0, static_cast<int64_t>(clock.unixMillis(2 * hour - 720) - expected));
+}
+
+void stepped() {
+    Clock clock;
+    clock.synchronized(0, epoch);
+    // A jump of a minute is the clock being set, not drift
+    clock.synchronized(hour, epoch + hour + 60 * 1000);
+    TEST_ASSERT_EQUAL(0, clock.driftPpm());
+    TEST_ASSERT(clock.unixMillis(hour) == epoch + hour + 60 * 1000);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(unsynchronized);
+    RUN_TEST(mapping);
+    RUN_TEST(drift);
+    RUN_TEST(stepped);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "core/network.hpp"
+#include "driver/backend.hpp"
+#include "configuration.hpp"
+
+#include <unity.h>
+#include <string>
+
+static driver::MockBackend backend(0);
+static std::string uri;
+
+static auto network() -> const iop::Network & {
+    static const iop::Network network(iop::StaticString(reinterpret_cast<const __FlashStringHelper *>(uri.c_str())), iop::LogLevel::WARN);
+    return network;
+}
+
+/// Repetitive, like the JSON sent, so it compresses well
+static auto events(size_t count) -> std::string {
+    std::string json = "[";
+    for (size_t index = 0; index < count; ++index)
+        json += std::string(index > 0 ? "," : "") + "{\"air_temperature_celsius\":25.5,\"acquisition_millis\":" + std::to_string(index) + "}";
+    return json + "]";
+}
+
+static auto post(const std::string &body) -> iop::NetworkStatus {
+    const auto &response = network().httpPost("token", F("/v1/events"), body);
+    TEST_ASSERT(iop::is_ok(response));
+    return iop::unwrap_ok_ref(response, IOP_CTX()).status;
+}
+
+void gzipped() {
+    backend.clear();
+    const auto body = events(20);
+    TEST_ASSERT(body.length() >= config::compressionThreshold);
+    TEST_ASSERT(post(body) == iop::NetworkStatus::OK);
+
+    // The server inflates it back to what was sent
+    const auto received = backend.received().back();
+    TEST_ASSERT(received.header("content-encoding") == std::string_view("gzip"));
+    TEST_ASSERT_EQUAL_STRING(body.c_str(), received.body.c_str());
+    TEST_ASSERT(received.sentLength < body.length());
+
+    const auto stats = iop::Network::compressionStats();
+    TEST_ASSERT(stats.requests > 0);
+    TEST_ASSERT(stats.bytesOut < stats.bytesIn);
+}
+
+void small() {
+    backend.clear();
+    TEST_ASSERT(post("[]") == iop::NetworkStatus::OK);
+    const auto received = backend.received().back();
+    TEST_ASSERT(!received.header("content-encoding").has_value());
+    TEST_ASSERT_EQUAL_STRING("[]", received.body.c_str());
+}
+
+void unsupported() {
+    backend.clear();
+    backend.acceptGzip(false);
+    const auto body = events(20);
+    // Sent again uncompressed, the caller doesn't see the 415
+    TEST_ASSERT(post(body) == iop::NetworkStatus::OK);
+    auto received = backend.received();
+    TEST_ASSERT_EQUAL(2, received.size());
+    TEST_ASSERT(received.at(0).header("content-encoding").has_value());
+    TEST_ASSERT(!received.at(1).header("content-encoding").has_value());
+    TEST_ASSERT_EQUAL_STRING(body.c_str(), received.at(1).body.c_str());
+
+    // Until reboot
+    TEST_ASSERT(post(body) == iop::NetworkStatus::OK);
+    received = backend.received();
+    TEST_ASSERT_EQUAL(3, received.size());
+    TEST_ASSERT(!received.back().header("content-encoding").has_value());
+    backend.acceptGzip(true);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    TEST_ASSERT(backend.start());
+    uri = std::string("http://127.0.0.1:") + std::to_string(backend.port());
+    RUN_TEST(gzipped);
+    RUN_TEST(small);
+    RUN_TEST(unsupported);
+    backend.stop();
+    UNITY_END();
+    return 0;
+}
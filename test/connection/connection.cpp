@@ -0,0 +1,48 @@
+#include "core/connection.hpp"
+
+#include <unity.h>
+
+void reuse() {
+    iop::ConnectionManager connection(1000, 3);
+    // Nothing to reuse yet
+    TEST_ASSERT(!connection.canReuse(0, false));
+    connection.sent(0, false);
+
+    TEST_ASSERT(connection.canReuse(500, true));
+    connection.sent(500, true);
+    // Closed by the server
+    TEST_ASSERT(!connection.canReuse(600, false));
+
+    const auto stats = connection.stats();
+    TEST_ASSERT_EQUAL(2, stats.requests);
+    TEST_ASSERT_EQUAL(1, stats.reused);
+    TEST_ASSERT_EQUAL(50, connection.hitRate());
+}
+
+void idleTimeout() {
+    iop::ConnectionManager connection(1000, 3);
+    connection.sent(0, false);
+    TEST_ASSERT(connection.canReuse(999, true));
+    TEST_ASSERT(!connection.canReuse(1000, true));
+}
+
+void maxRequests() {
+    iop::ConnectionManager connection(1000, 3);
+    connection.sent(0, false);
+    connection.sent(1, true);
+    connection.sent(2, true);
+    TEST_ASSERT(!connection.canReuse(3, true));
+
+    // A new connection starts counting again
+    connection.sent(3, false);
+    TEST_ASSERT(connection.canReuse(4, true));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(reuse);
+    RUN_TEST(idleTimeout);
+    RUN_TEST(maxRequests);
+    UNITY_END();
+    return 0;
+}
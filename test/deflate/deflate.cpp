@@ -0,0 +1,151 @@
+#include "core/deflate.hpp"
+
+#include <unity.h>
+#include <string>
+
+/// Minimal inflater for the fixed Huffman blocks `Deflate` produces
+class Inflater {
+    std::string_view input;
+    size_t pos = 0;
+    uint8_t bit = 0;
+
+public:
+    explicit Inflater(std::string_view input) noexcept: input(input) {}
+
+    auto bits(uint8_t count) noexcept -> uint32_t {
+        uint32_t value = 0;
+        for (uint8_t index = 0; index < count; ++index) {
+            value |= ((static_cast<uint8_t>(this->input.at(this->pos)) >> this->bit) & 1U) << index;
+            if (++this->bit == 8) {
+                this->bit = 0;
+                this->pos++;
+            }
+        }
+        return value;
+    }
+
+    /// Huffman codes start from their most significant bit
+    auto code(uint8_t count) noexcept -> uint32_t {
+        uint32_t value = 0;
+        for (uint8_t index = 0; index < count; ++index)
+            value = (value << 1) | this->bits(1);
+        return value;
+    }
+
+    auto symbol() noexcept -> uint16_t {
+        auto value = this->code(7);
+        if (value <= 0x17)
+            return static_cast<uint16_t>(256 + value);
+        value = (value << 1) | this->bits(1);
+        if (value >= 0x30 && value <= 0xBF)
+            return static_cast<uint16_t>(value - 0x30);
+        if (value >= 0xC0 && value <= 0xC7)
+            return static_cast<uint16_t>(280 + value - 0xC0);
+        value = (value << 1) | this->bits(1);
+        return static_cast<uint16_t>(144 + value - 0x190);
+    }
+
+    auto inflate() noexcept -> std::string {
+        constexpr uint16_t lengthBase[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                           31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        constexpr uint8_t lengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                           2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        constexpr uint16_t distanceBase[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                             257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145};
+        constexpr uint8_t distanceExtra[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                             7, 7, 8, 8, 9, 9, 10, 10, 11, 11};
+
+        std::string output;
+        this->pos = 10;
+        TEST_ASSERT_EQUAL(1, this->bits(1));
+        TEST_ASSERT_EQUAL(1, this->bits(2));
+        while (true) {
+            const auto symbol = this->symbol();
+            if (symbol < 256) {
+                output.push_back(static_cast<char>(symbol));
+                continue;
+            }
+            if (symbol == 256)
+                break;
+
+            const auto length = lengthBase[symbol - 257] + this->bits(lengthExtra[symbol - 257]);
+            const auto code = this->code(5);
+            const auto distance = distanceBase[code] + this->bits(distanceExtra[code]);
+            TEST_ASSERT(distance <= output.size());
+            for (uint32_t index = 0; index < length; ++index)
+                output.push_back(output.at(output.size() - distance));
+        }
+        return output;
+    }
+};
+
+static auto readUint32(std::string_view data, size_t offset) -> uint32_t {
+    uint32_t value = 0;
+    for (size_t byte = 0; byte < 4; ++byte)
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(data.at(offset + byte))) << (byte * 8);
+    return value;
+}
+
+static auto roundTrip(std::string_view input) -> size_t {
+    static iop::Deflate deflate;
+    std::array<char, 2048> buffer;
+    const auto length = deflate.gzip(input, buffer);
+    TEST_ASSERT(length.has_value());
+
+    const auto output = std::string_view(buffer.data(), *length);
+    TEST_ASSERT_EQUAL(0x1F, static_cast<uint8_t>(output.at(0)));
+    TEST_ASSERT_EQUAL(0x8B, static_cast<uint8_t>(output.at(1)));
+    TEST_ASSERT_EQUAL(input.length(), readUint32(output, output.length() - 4));
+    TEST_ASSERT(Inflater(output).inflate() == input);
+    return *length;
+}
+
+void roundTrips() {
+    roundTrip("");
+    roundTrip("a");
+    roundTrip("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+
+    std::string binary;
+    for (int index = 0; index < 1000; ++index)
+        binary.push_back(static_cast<char>((index * 7919) % 256));
+    roundTrip(binary);
+}
+
+void ratio() {
+    std::string logs;
+    for (int index = 0; index < 10; ++index)
+        logs += "[INFO] API: POST to https://iop.example.com/v1/event, data length: " + std::to_string(100 + index) + "\n";
+    TEST_ASSERT(roundTrip(logs) * 3 < logs.length());
+
+    std::string events = "[";
+    for (int index = 0; index < 8; ++index)
+        events += "{\"air_temperature_celsius\":25." + std::to_string(index) +
+                  ",\"air_humidity_percentage\":60,\"soil_temperature_celsius\":21.5,\"soil_resistivity_raw\":500},";
+    events.back() = ']';
+    TEST_ASSERT(roundTrip(events) * 2 < events.length());
+}
+
+void checksum() {
+    iop::Deflate deflate;
+    std::array<char, 64> buffer;
+    const auto length = deflate.gzip("123456789", buffer);
+    TEST_ASSERT(length.has_value());
+    // CRC-32 check value
+    TEST_ASSERT(readUint32(std::string_view(buffer.data(), *length), *length - 8) == 0xCBF43926);
+}
+
+void overflow() {
+    iop::Deflate deflate;
+    std::array<char, 16> buffer;
+    TEST_ASSERT(!deflate.gzip("this doesn't fit in sixteen bytes", buffer).has_value());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(roundTrips);
+    RUN_TEST(ratio);
+    RUN_TEST(checksum);
+    RUN_TEST(overflow);
+    UNITY_END();
+    return 0;
+}
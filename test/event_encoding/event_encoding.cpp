@@ -0,0 +1,98 @@
+#include "event_encoding.hpp"
+
+#include <unity.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static auto bytes(const std::array<char, 1024> &buffer, const size_t offset, const size_t length) -> std::vector<uint8_t> {
+    std::vector<uint8_t> vec;
+    for (size_t index = offset; index < offset + length; ++index)
+        vec.push_back(static_cast<uint8_t>(buffer.at(index)));
+    return vec;
+}
+
+static auto floatAt(const std::array<char, 1024> &buffer, const size_t offset) -> float {
+    const auto raw = bytes(buffer, offset, 4);
+    const uint32_t value = raw[0] | (raw[1] << 8) | (raw[2] << 16) | (static_cast<uint32_t>(raw[3]) << 24);
+    float result = 0;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+/// Example of docs/EVENTS.md
+static auto example() -> Event {
+    auto storage = (EventStorage){};
+    storage.values.fill(NAN);
+    for (const auto &field: eventFields) {
+        const auto name = std::string_view(field.name);
+        if (name == "air_temperature_celsius") {
+            storage.values.at(field.offset) = 24.5;
+        } else if (name == "air_heat_index_celsius") {
+            storage.values.at(field.offset) = 1;
+        } else if (name == "soil_resistivity_raw") {
+            storage.values.at(field.offset) = 712;
+        } else if (name == "soil_temperatures_celsius") {
+            storage.values.at(field.offset) = 21;
+            storage.values.at(field.offset + 1) = 20.5;
+        }
+    }
+    storage.acquisitionMillis = 3004;
+    storage.capturedAt = 1700000085;
+    return Event(storage);
+}
+
+void layout() {
+    // If the sensors list changes the layout must change, update the docs
+    TEST_ASSERT_EQUAL(0xA57C, binaryEventLayoutId);
+    TEST_ASSERT_EQUAL(36, binaryEventSize);
+}
+
+void header() {
+    static std::array<char, 1024> buffer;
+    const std::array<Event, 2> events = { example(), example() };
+    const auto length = encodeEvents(iop::Span<const Event>(events.data(), events.size()), buffer);
+    TEST_ASSERT_EQUAL(binaryHeaderSize + 2 * binaryEventSize, length);
+
+    // Schema, layout (little endian) and event count
+    TEST_ASSERT(bytes(buffer, 0, 4) == std::vector<uint8_t>({ 5, 0x7C, 0xA5, 2 }));
+}
+
+void event() {
+    static std::array<char, 1024> buffer;
+    const auto sample = example();
+    encodeEvents(iop::Span<const Event>(&sample, 1), buffer);
+    const auto offset = binaryHeaderSize;
+
+    // Offsets of docs/EVENTS.md
+    TEST_ASSERT(bytes(buffer, offset + 0, 4) == std::vector<uint8_t>({ 0x00, 0x00, 0xC4, 0x41 }));
+    TEST_ASSERT(std::isnan(floatAt(buffer, offset + 4)));
+    TEST_ASSERT(bytes(buffer, offset + 8, 4) == std::vector<uint8_t>({ 0x00, 0x00, 0x80, 0x3F }));
+    TEST_ASSERT(bytes(buffer, offset + 12, 2) == std::vector<uint8_t>({ 0xC8, 0x02 }));
+    TEST_ASSERT(bytes(buffer, offset + 14, 8) == std::vector<uint8_t>({ 0x00, 0x00, 0xA8, 0x41, 0x00, 0x00, 0xA4, 0x41 }));
+    // Probes that weren't found still have their slots
+    TEST_ASSERT(std::isnan(floatAt(buffer, offset + 22)));
+    TEST_ASSERT(std::isnan(floatAt(buffer, offset + 26)));
+    TEST_ASSERT(bytes(buffer, offset + 30, 2) == std::vector<uint8_t>({ 0xBC, 0x0B }));
+    TEST_ASSERT(bytes(buffer, offset + 32, 4) == std::vector<uint8_t>({ 0x55, 0xF1, 0x53, 0x65 }));
+}
+
+void missingUint16() {
+    static std::array<char, 1024> buffer;
+    auto sample = example();
+    sample.storage.values.fill(NAN);
+    encodeEvents(iop::Span<const Event>(&sample, 1), buffer);
+
+    // NaN can't be represented, so it's the maximum value
+    TEST_ASSERT(bytes(buffer, binaryHeaderSize + 12, 2) == std::vector<uint8_t>({ 0xFF, 0xFF }));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(layout);
+    RUN_TEST(header);
+    RUN_TEST(event);
+    RUN_TEST(missingUint16);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "flash.hpp"
+#include "configuration.hpp"
+
+#include <unity.h>
+
+void eventQueue() {
+  const Flash flash(iop::LogLevel::WARN);
+  flash.setup();
+  while (flash.queuedEvents() > 0)
+    flash.dequeueEvent();
+  TEST_ASSERT(!flash.oldestEvent().has_value());
+
+  const auto dropped = flash.droppedEvents();
+  for (uint16_t index = 0; index < config::eventQueueCapacity + 2; ++index) {
+    auto storage = (EventStorage){};
+    storage.acquisitionMillis = index;
+    flash.enqueueEvent(Event(storage));
+  }
+  TEST_ASSERT_EQUAL(config::eventQueueCapacity, flash.queuedEvents());
+  TEST_ASSERT_EQUAL(dropped + 2, flash.droppedEvents());
+
+  // Oldest-first, the two oldest events were dropped
+  for (uint16_t index = 2; index < config::eventQueueCapacity + 2; ++index) {
+    const auto event = flash.oldestEvent();
+    TEST_ASSERT(event.has_value());
+    TEST_ASSERT_EQUAL(index, iop::unwrap_ref(event, IOP_CTX()).storage.acquisitionMillis);
+    flash.dequeueEvent();
+  }
+  TEST_ASSERT_EQUAL(0, flash.queuedEvents());
+  TEST_ASSERT(!flash.oldestEvent().has_value());
+}
+
+void batches() {
+  const Flash flash(iop::LogLevel::WARN);
+  flash.setup();
+  while (flash.queuedEvents() > 0)
+    flash.dequeueEvent();
+
+  for (uint16_t index = 0; index < 5; ++index) {
+    auto storage = (EventStorage){};
+    storage.acquisitionMillis = index;
+    flash.enqueueEvent(Event(storage));
+  }
+  TEST_ASSERT_EQUAL(3, iop::unwrap_ref(flash.queuedEvent(3), IOP_CTX()).storage.acquisitionMillis);
+  TEST_ASSERT(!flash.queuedEvent(5).has_value());
+
+  // More than queued only removes what there is
+  flash.dequeueEvents(3);
+  TEST_ASSERT_EQUAL(3, iop::unwrap_ref(flash.oldestEvent(), IOP_CTX()).storage.acquisitionMillis);
+  flash.dequeueEvents(10);
+  TEST_ASSERT_EQUAL(0, flash.queuedEvents());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(eventQueue);
+    RUN_TEST(batches);
+    UNITY_END();
+    return 0;
+}
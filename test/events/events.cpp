@@ -0,0 +1,96 @@
+#include "api.hpp"
+#include "driver/backend.hpp"
+#include "configuration.hpp"
+
+#include <unity.h>
+#include <string>
+#include <vector>
+
+static driver::MockBackend backend(0);
+static std::string uri;
+
+static auto api() -> const Api & {
+    static const Api api(iop::StaticString(reinterpret_cast<const __FlashStringHelper *>(uri.c_str())), iop::LogLevel::WARN);
+    return api;
+}
+
+static auto token() -> AuthToken {
+    AuthToken token;
+    token.fill('A');
+    return token;
+}
+
+static auto events() -> std::vector<Event> {
+    std::vector<Event> events;
+    for (uint16_t index = 0; index < config::eventBatchSize; ++index) {
+        auto storage = (EventStorage){};
+        storage.acquisitionMillis = index;
+        events.emplace_back(storage);
+    }
+    return events;
+}
+
+/// Events of each request, in order
+static auto acquisitionsReceived() -> std::vector<std::vector<uint16_t>> {
+    std::vector<std::vector<uint16_t>> batches;
+    for (const auto &request: backend.received()) {
+        if (request.path != "/v1/events") continue;
+        TEST_ASSERT(request.body.length() < config::eventBatchPayloadBudget);
+        DynamicJsonDocument doc(4096);
+        TEST_ASSERT(!deserializeJson(doc, request.body));
+        std::vector<uint16_t> batch;
+        for (const auto event: doc.as<JsonArray>())
+            batch.push_back(event["acquisition_millis"].as<uint16_t>());
+        batches.push_back(batch);
+    }
+    return batches;
+}
+
+void split() {
+    backend.clear();
+    const auto queued = events();
+    const auto status = api().registerEvents(token(), iop::Span<const Event>(queued));
+    TEST_ASSERT(status.status == iop::NetworkStatus::OK);
+    TEST_ASSERT_EQUAL(queued.size(), status.sent);
+
+    // Oldest first, each once, in as many requests as the budget requires
+    const auto batches = acquisitionsReceived();
+    TEST_ASSERT(batches.size() > 1);
+    uint16_t next = 0;
+    for (const auto &batch: batches) {
+        TEST_ASSERT(!batch.empty());
+        for (const auto acquisition: batch)
+            TEST_ASSERT_EQUAL(next++, acquisition);
+    }
+    TEST_ASSERT_EQUAL(queued.size(), next);
+}
+
+void partial() {
+    backend.clear();
+    driver::MockResponse ok;
+    driver::MockResponse broken;
+    broken.status = 500;
+    backend.script("/v1/events", ok);
+    backend.script("/v1/events", broken);
+
+    // Only the first batch was accepted, so only it must be dequeued
+    const auto queued = events();
+    const auto status = api().registerEvents(token(), iop::Span<const Event>(queued));
+    TEST_ASSERT(status.status == iop::NetworkStatus::BROKEN_SERVER);
+    const auto batches = acquisitionsReceived();
+    TEST_ASSERT_EQUAL(2, batches.size());
+    TEST_ASSERT_EQUAL(batches.front().size(), status.sent);
+    TEST_ASSERT(status.sent < queued.size());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    TEST_ASSERT(backend.start());
+    uri = std::string("http://127.0.0.1:") + std::to_string(backend.port());
+    RUN_TEST(split);
+    // Last, the failure backs the endpoint off
+    RUN_TEST(partial);
+    backend.stop();
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "core/headers.hpp"
+
+#include <unity.h>
+#include <string>
+
+static auto serialize(const iop::HeaderBuilder &builder) -> std::string {
+    std::string result;
+    builder.forEach([&result](const char *name, const char *value) {
+        result += std::string(name) + ": " + value + "\n";
+    });
+    return result;
+}
+
+void headers() {
+    iop::MD5Hash md5;
+    md5.fill('A');
+    iop::MacAddress mac;
+    mac.fill('B');
+
+    iop::HeaderBuilder builder;
+    builder.setup(md5, mac);
+    TEST_ASSERT(builder.setDeviceStats(1024, 40000, 0, 3300, 4294967295UL));
+    TEST_ASSERT_EQUAL_STRING(
+        "VERSION: AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA\n"
+        "MAC_ADDRESS: BBBBBBBBBBBBBBBBB\n"
+        "FREE_STACK: 1024\n"
+        "FREE_HEAP: 40000\n"
+        "BIGGEST_FREE_BLOCK: 0\n"
+        "VCC: 3300\n"
+        "TIME_RUNNING: 4294967295\n", serialize(builder).c_str());
+
+    // Only the device stats are replaced
+    TEST_ASSERT(builder.setDeviceStats(1, 2, 3, 4, 5));
+    TEST_ASSERT_EQUAL_STRING(
+        "VERSION: AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA\n"
+        "MAC_ADDRESS: BBBBBBBBBBBBBBBBB\n"
+        "FREE_STACK: 1\n"
+        "FREE_HEAP: 2\n"
+        "BIGGEST_FREE_BLOCK: 3\n"
+        "VCC: 4\n"
+        "TIME_RUNNING: 5\n", serialize(builder).c_str());
+
+    // Conditional headers only last until the device stats are replaced
+    TEST_ASSERT(builder.setIfNoneMatch(std::string_view(md5.data(), md5.size())));
+    TEST_ASSERT(serialize(builder).find("If-None-Match: \"AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA\"\n") != std::string::npos);
+    TEST_ASSERT(builder.setDeviceStats(1, 2, 3, 4, 5));
+    TEST_ASSERT(serialize(builder).find("If-None-Match") == std::string::npos);
+
+    // Nothing is left behind if it doesn't fit
+    const std::string tooLong(iop::HeaderBuilder::capacity, 'a');
+    const auto before = serialize(builder);
+    TEST_ASSERT(!builder.setIfNoneMatch(std::string_view(tooLong)));
+    TEST_ASSERT(serialize(builder) == before);
+}
+
+void uriAndAuthorization() {
+    iop::HeaderBuilder builder;
+    TEST_ASSERT(builder.setUri(F("http://127.0.0.1:4001"), F("/v1/event")));
+    TEST_ASSERT_EQUAL_STRING("http://127.0.0.1:4001/v1/event", builder.uri());
+
+    TEST_ASSERT(builder.setAuthorization(std::string_view("token")));
+    TEST_ASSERT_EQUAL_STRING("token", builder.authorization());
+    TEST_ASSERT(builder.setAuthorization(std::nullopt));
+    TEST_ASSERT_EQUAL_STRING("", builder.authorization());
+
+    const std::string tooLong(iop::HeaderBuilder::tokenCapacity + 1, 'a');
+    TEST_ASSERT(!builder.setAuthorization(std::string_view(tooLong)));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(headers);
+    RUN_TEST(uriAndAuthorization);
+    UNITY_END();
+    return 0;
+}
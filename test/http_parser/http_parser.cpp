@@ -0,0 +1,128 @@
+#include "core/http_parser.hpp"
+
+#include <unity.h>
+#include <string>
+
+/// Feeds `response` in pieces of `split` bytes, like reads from a socket would
+static auto parse(iop::HttpResponseParser &parser, const std::string_view response, const size_t split) -> std::string {
+    std::string body;
+    for (size_t start = 0; start < response.length() && !parser.isDone() && !parser.hasFailed(); start += split) {
+        auto input = response.substr(start, split);
+        while (!input.empty() && !parser.isDone() && !parser.hasFailed()) {
+            const auto step = parser.feed(input);
+            body += step.body;
+            input.remove_prefix(step.consumed);
+        }
+    }
+    return body;
+}
+
+void contentLength() {
+    constexpr std::string_view response =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "latest_version: ABCDEF\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello";
+
+    // Every line straddles some read
+    for (size_t split = 1; split <= response.length(); ++split) {
+        iop::HttpResponseParser parser;
+        TEST_ASSERT(parser.collect("LATEST_VERSION"));
+        const auto body = parse(parser, response, split);
+
+        TEST_ASSERT(parser.isDone());
+        TEST_ASSERT_EQUAL(200, parser.status());
+        TEST_ASSERT(parser.keepAlive());
+        TEST_ASSERT_EQUAL_STRING("hello", body.c_str());
+        TEST_ASSERT_EQUAL(5, parser.contentLength().value_or(0));
+        TEST_ASSERT_EQUAL_STRING("ABCDEF", std::string(parser.header("LATEST_VERSION").value_or("")).c_str());
+    }
+}
+
+void chunked() {
+    constexpr std::string_view response =
+        "HTTP/1.1 403 Forbidden\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "4\r\nWiki\r\n"
+        "5;ext=1\r\npedia\r\n"
+        "0\r\n"
+        "Trailer: ignored\r\n"
+        "\r\n";
+
+    for (size_t split = 1; split <= response.length(); ++split) {
+        iop::HttpResponseParser parser;
+        const auto body = parse(parser, response, split);
+
+        TEST_ASSERT(parser.isDone());
+        TEST_ASSERT_EQUAL(403, parser.status());
+        TEST_ASSERT_EQUAL_STRING("Wikipedia", body.c_str());
+    }
+}
+
+void untilClose() {
+    iop::HttpResponseParser parser;
+    const auto body = parse(parser, "HTTP/1.0 200 OK\r\n\r\nuntil the end", 4);
+    TEST_ASSERT(!parser.isDone());
+    parser.finish();
+
+    TEST_ASSERT(parser.isDone());
+    TEST_ASSERT(!parser.keepAlive());
+    TEST_ASSERT_EQUAL_STRING("until the end", body.c_str());
+}
+
+void noBody() {
+    iop::HttpResponseParser parser;
+    parse(parser, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 304 Not Modified\r\nConnection: close\r\n\r\n", 7);
+    TEST_ASSERT(parser.isDone());
+    TEST_ASSERT_EQUAL(304, parser.status());
+    TEST_ASSERT(!parser.keepAlive());
+}
+
+void head() {
+    iop::HttpResponseParser parser;
+    parser.expectNoBody();
+    parse(parser, "HTTP/1.1 200 OK\r\nContent-Length: 409600\r\n\r\n", 5);
+    TEST_ASSERT(parser.isDone());
+    TEST_ASSERT(parser.keepAlive());
+
+    // Only lasts until the next response
+    parser.reset();
+    const auto body = parse(parser, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok", 5);
+    TEST_ASSERT_EQUAL_STRING("ok", body.c_str());
+}
+
+void malformed() {
+    iop::HttpResponseParser parser;
+    parse(parser, "SMTP 220 hi\r\n\r\n", 100);
+    TEST_ASSERT(parser.hasFailed());
+
+    parser.reset();
+    parse(parser, "HTTP/1.1 200 OK\r\nContent-Length: 12a\r\n\r\n", 100);
+    TEST_ASSERT(parser.hasFailed());
+
+    // Truncated responses
+    parser.reset();
+    parse(parser, "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nhalf", 100);
+    parser.finish();
+    TEST_ASSERT(parser.hasFailed());
+
+    parser.reset();
+    const std::string huge(iop::HttpResponseParser::lineCapacity + 1, 'a');
+    parse(parser, "HTTP/1.1 200 OK\r\nX: " + huge + "\r\n\r\n", 10);
+    TEST_ASSERT(parser.hasFailed());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(contentLength);
+    RUN_TEST(chunked);
+    RUN_TEST(untilClose);
+    RUN_TEST(noBody);
+    RUN_TEST(head);
+    RUN_TEST(malformed);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include "core/mqtt.hpp"
+#include "driver/broker.hpp"
+#include "driver/client.hpp"
+
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+static driver::MockBroker broker(0);
+static std::string received;
+
+/// Sessions persist in the broker, so each test has its own client id
+static auto credentials(const std::string_view clientId) -> iop::MqttConnect {
+    return iop::MqttConnect { clientId, clientId, std::string_view("token"), 0, true };
+}
+
+static auto connect(iop::MqttClient &client, const std::string_view clientId, std::optional<std::string_view> subscription = std::nullopt) -> iop::MqttStatus {
+    return client.connect("127.0.0.1", broker.port(), credentials(clientId), subscription);
+}
+
+static void onMessage(const std::string_view topic, const std::string_view payload) {
+    received = std::string(topic) + "=" + std::string(payload);
+}
+
+/// The broker answers from another thread
+static void waitFor(iop::MqttClient &client, const std::string &expected) {
+    for (int attempt = 0; attempt < 100 && received != expected; ++attempt) {
+        client.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), received.c_str());
+}
+
+void codec() {
+    std::array<char, 64> buffer;
+    const auto message = iop::MqttMessage { "iop/event", "{\"a\":1}", 7, 1, false, true };
+    const auto size = iop::MqttCodec::publish(message, buffer);
+    TEST_ASSERT(size.has_value());
+    TEST_ASSERT_EQUAL(0x3A, static_cast<uint8_t>(buffer.at(0)));
+
+    // Incomplete until the last byte
+    const auto view = std::string_view(buffer.data(), *size);
+    TEST_ASSERT(iop::is_err(iop::MqttCodec::decode(view.substr(0, *size - 1))));
+    const auto decoded = iop::MqttCodec::decode(view);
+    TEST_ASSERT(iop::is_ok(decoded));
+    const auto &packet = iop::unwrap_ok_ref(decoded, IOP_CTX());
+    TEST_ASSERT_EQUAL(*size, packet.size);
+    const auto parsed = iop::MqttCodec::messageOf(packet);
+    TEST_ASSERT(parsed.has_value());
+    TEST_ASSERT(parsed->topic == "iop/event");
+    TEST_ASSERT(parsed->payload == "{\"a\":1}");
+    TEST_ASSERT_EQUAL(7, parsed->packetId);
+    TEST_ASSERT(parsed->dup);
+
+    const auto connect = iop::MqttCodec::connect(credentials("codec"), buffer);
+    TEST_ASSERT(connect.has_value());
+    const auto connectPacket = iop::MqttCodec::decode(std::string_view(buffer.data(), *connect));
+    const auto fields = iop::MqttCodec::connectOf(iop::unwrap_ok_ref(connectPacket, IOP_CTX()));
+    TEST_ASSERT(fields.has_value());
+    TEST_ASSERT(fields->password == "token");
+    TEST_ASSERT(fields->cleanSession);
+
+    // Remaining length takes two bytes from 128 on
+    std::array<char, 256> big;
+    const auto payload = std::string(200, 'x');
+    const auto bigSize = iop::MqttCodec::publish(iop::MqttMessage { "t", payload, 0, 0, false, false }, big);
+    TEST_ASSERT(bigSize.has_value());
+    TEST_ASSERT_EQUAL(2 + 1 + 2 + payload.length(), *bigSize - 1);
+    TEST_ASSERT(iop::is_ok(iop::MqttCodec::decode(std::string_view(big.data(), *bigSize))));
+
+    TEST_ASSERT(!iop::MqttCodec::publish(iop::MqttMessage { "t", payload, 0, 0, false, false }, buffer).has_value());
+    const char malformed[] = { static_cast<char>(0x30), static_cast<char>(0xFF), static_cast<char>(0xFF), static_cast<char>(0xFF), static_cast<char>(0xFF), 0 };
+    const auto error = iop::MqttCodec::decode(std::string_view(malformed, sizeof(malformed)));
+    TEST_ASSERT(iop::is_err(error) && iop::unwrap_err_ref(error, IOP_CTX()) == iop::MqttDecodeError::MALFORMED);
+}
+
+void session() {
+    iop::MqttSession session(10);
+    const auto first = session.publishing("a", "1");
+    TEST_ASSERT(!first.second);
+    // Not acknowledged, so it's a redelivery
+    const auto again = session.publishing("a", "1");
+    TEST_ASSERT_EQUAL(first.first, again.first);
+    TEST_ASSERT(again.second);
+    TEST_ASSERT(session.acked(first.first));
+    TEST_ASSERT(!session.acked(first.first));
+    const auto next = session.publishing("a", "1");
+    TEST_ASSERT(next.first != first.first);
+    TEST_ASSERT(!next.second);
+
+    session.connected(1000);
+    TEST_ASSERT(!session.shouldPing(5999));
+    TEST_ASSERT(session.shouldPing(6000));
+    session.pinged(6000);
+    TEST_ASSERT(!session.shouldPing(20000));
+    TEST_ASSERT(!session.isDead(15999));
+    TEST_ASSERT(session.isDead(16000));
+    session.ponged();
+    TEST_ASSERT(!session.isDead(16000));
+}
+
+void publish() {
+    WiFiClient wifiClient;
+    iop::MqttClient client(wifiClient, 0, 1000);
+    TEST_ASSERT(connect(client, "publish") == iop::MqttStatus::OK);
+    const auto connects = broker.connects();
+    TEST_ASSERT_EQUAL_STRING("token", connects.back().password.c_str());
+    // Always a persistent session
+    TEST_ASSERT(!connects.back().cleanSession);
+
+    TEST_ASSERT(client.publish("iop/event", "{}") == iop::MqttStatus::OK);
+    const auto published = broker.published();
+    TEST_ASSERT_EQUAL_STRING("iop/event", published.back().topic.c_str());
+    TEST_ASSERT_EQUAL(1, published.back().qos);
+    client.disconnect();
+}
+
+void redelivery() {
+    WiFiClient wifiClient;
+    iop::MqttClient client(wifiClient, 0, 200);
+    TEST_ASSERT(connect(client, "redelivery") == iop::MqttStatus::OK);
+
+    broker.dropAcks(1);
+    TEST_ASSERT(client.publish("iop/log", "lost") == iop::MqttStatus::CONNECTION_ISSUES);
+    TEST_ASSERT(!client.isConnected());
+
+    TEST_ASSERT(connect(client, "redelivery") == iop::MqttStatus::OK);
+    TEST_ASSERT(client.publish("iop/log", "lost") == iop::MqttStatus::OK);
+    const auto published = broker.published();
+    const auto &lost = published.at(published.size() - 2);
+    const auto &redelivered = published.back();
+    TEST_ASSERT(!lost.dup);
+    TEST_ASSERT(redelivered.dup);
+    TEST_ASSERT_EQUAL(lost.packetId, redelivered.packetId);
+    client.disconnect();
+}
+
+void retained() {
+    WiFiClient wifiClient;
+    iop::MqttClient client(wifiClient, 0, 1000);
+    client.onMessage(onMessage);
+    received.clear();
+
+    broker.retain("iop/update", "first");
+    TEST_ASSERT(connect(client, "retained", std::string_view("iop/update")) == iop::MqttStatus::OK);
+    waitFor(client, "iop/update=first");
+
+    broker.retain("iop/update", "second");
+    waitFor(client, "iop/update=second");
+
+    // The session is persistent, so messages published while offline are
+    // delivered on reconnection, without subscribing again
+    client.disconnect();
+    broker.retain("iop/update", "third");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    TEST_ASSERT(connect(client, "retained", std::string_view("iop/update")) == iop::MqttStatus::OK);
+    waitFor(client, "iop/update=third");
+    client.disconnect();
+}
+
+void keepAlive() {
+    WiFiClient wifiClient;
+    iop::MqttClient client(wifiClient, 1, 1000);
+    TEST_ASSERT(connect(client, "keepAlive") == iop::MqttStatus::OK);
+    const auto pings = broker.pings();
+    for (int attempt = 0; attempt < 100 && broker.pings() == pings; ++attempt) {
+        client.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    TEST_ASSERT(broker.pings() > pings);
+
+    broker.disconnectAll();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    client.poll();
+    TEST_ASSERT(!client.isConnected());
+}
+
+void refused() {
+    WiFiClient wifiClient;
+    iop::MqttClient client(wifiClient, 0, 1000);
+    broker.refuse(5);
+    TEST_ASSERT(connect(client, "refused") == iop::MqttStatus::FORBIDDEN);
+    broker.refuse(0);
+    TEST_ASSERT(connect(client, "refused") == iop::MqttStatus::OK);
+    client.disconnect();
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    TEST_ASSERT(broker.start());
+    RUN_TEST(codec);
+    RUN_TEST(session);
+    RUN_TEST(publish);
+    RUN_TEST(redelivery);
+    RUN_TEST(retained);
+    RUN_TEST(keepAlive);
+    RUN_TEST(refused);
+    broker.stop();
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "core/network.hpp"
+#include "driver/backend.hpp"
+
+#include <unity.h>
+#include <string>
+
+static driver::MockBackend backend(0);
+static std::string uri;
+
+static auto network() -> const iop::Network & {
+    static const iop::Network network(iop::StaticString(reinterpret_cast<const __FlashStringHelper *>(uri.c_str())), iop::LogLevel::WARN);
+    return network;
+}
+
+static auto answer(const uint16_t status, const std::string &body) -> driver::MockResponse {
+    driver::MockResponse response;
+    response.status = status;
+    response.body = body;
+    return response;
+}
+
+void discardedBody() {
+    backend.clear();
+    backend.script("/v1/summary", answer(200, "{\"received\":true}"));
+    backend.script("/v1/log", answer(403, "{\"error\":\"invalid token\"}"));
+
+    // No buffer was given, so the bodies are read and discarded
+    const auto &ok = network().httpPost("token", F("/v1/summary"), "{}");
+    TEST_ASSERT(iop::is_ok(ok));
+    TEST_ASSERT(iop::unwrap_ok_ref(ok, IOP_CTX()).status == iop::NetworkStatus::OK);
+    TEST_ASSERT(!iop::unwrap_ok_ref(ok, IOP_CTX()).payload.has_value());
+
+    const auto &forbidden = network().httpPost("token", F("/v1/log"), "log");
+    TEST_ASSERT(iop::is_ok(forbidden));
+    TEST_ASSERT(iop::unwrap_ok_ref(forbidden, IOP_CTX()).status == iop::NetworkStatus::FORBIDDEN);
+}
+
+void bufferedBody() {
+    backend.clear();
+    std::array<char, 64> buffer;
+    const auto &response = network().httpPost(F("/v1/user/login"), "{}", buffer);
+    TEST_ASSERT(iop::is_ok(response));
+    TEST_ASSERT(iop::unwrap_ok_ref(response, IOP_CTX()).status == iop::NetworkStatus::OK);
+    TEST_ASSERT_EQUAL(64, iop::unwrap_ok_ref(response, IOP_CTX()).payload->length());
+
+    // The token doesn't fit
+    std::array<char, 16> small;
+    const auto &overflow = network().httpPost(F("/v1/user/login"), "{}", small);
+    TEST_ASSERT(iop::is_ok(overflow));
+    TEST_ASSERT(iop::unwrap_ok_ref(overflow, IOP_CTX()).status == iop::NetworkStatus::BROKEN_SERVER);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    TEST_ASSERT(backend.start());
+    uri = std::string("http://127.0.0.1:") + std::to_string(backend.port());
+    RUN_TEST(discardedBody);
+    RUN_TEST(bufferedBody);
+    backend.stop();
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "outbound.hpp"
+
+#include <unity.h>
+#include <string>
+
+void priority() {
+    OutboundQueue queue;
+    TEST_ASSERT(queue.isEmpty());
+    TEST_ASSERT(queue.push(OutboundKind::LOG, "log"));
+    TEST_ASSERT(queue.push(OutboundKind::PANIC, "panic"));
+    TEST_ASSERT(queue.nextKind() == OutboundKind::PANIC);
+
+    const auto panic = queue.front();
+    TEST_ASSERT(panic.has_value());
+    TEST_ASSERT(panic->payload == "panic");
+    TEST_ASSERT(queue.remove(panic->id));
+    TEST_ASSERT(!queue.remove(panic->id));
+
+    const auto log = queue.front();
+    TEST_ASSERT(log->payload == "log");
+    TEST_ASSERT(queue.remove(log->id));
+    TEST_ASSERT(queue.isEmpty());
+    TEST_ASSERT(!queue.front().has_value());
+}
+
+void coalescing() {
+    OutboundQueue queue;
+    queue.push(OutboundKind::LOG, "first\n");
+    queue.push(OutboundKind::LOG, "second\n");
+    TEST_ASSERT_EQUAL(1, queue.size());
+
+    // Panics in between split the logs, but repeated ones are dropped
+    queue.push(OutboundKind::PANIC, "panic");
+    queue.push(OutboundKind::PANIC, "panic");
+    queue.push(OutboundKind::LOG, "third\n");
+    TEST_ASSERT_EQUAL(3, queue.size());
+
+    const auto panic = queue.front();
+    queue.remove(panic->id);
+    const auto log = queue.front();
+    TEST_ASSERT(log->payload == "first\nsecond\n");
+
+    // Being sent, so it can't grow, the new log waits for the next request
+    queue.push(OutboundKind::LOG, "fourth\n");
+    TEST_ASSERT(queue.remove(log->id));
+    TEST_ASSERT(queue.front()->payload == "third\nfourth\n");
+}
+
+void bounded() {
+    OutboundQueue queue;
+    const std::string log(OutboundQueue::capacity / 2, 'l');
+    TEST_ASSERT(queue.push(OutboundKind::LOG, log));
+    queue.front();
+    TEST_ASSERT(queue.push(OutboundKind::LOG, log));
+    // Full of logs
+    TEST_ASSERT(!queue.push(OutboundKind::LOG, "x"));
+    TEST_ASSERT_EQUAL(1, queue.dropped());
+
+    // Panics evict logs, newest first
+    TEST_ASSERT(queue.push(OutboundKind::PANIC, "panic"));
+    TEST_ASSERT_EQUAL(2, queue.size());
+    TEST_ASSERT_EQUAL(2, queue.dropped());
+    TEST_ASSERT_EQUAL(OutboundQueue::capacity / 2 + 5, queue.bytes());
+
+    // Nothing evicts panics
+    const std::string panic(OutboundQueue::capacity, 'p');
+    TEST_ASSERT(!queue.push(OutboundKind::PANIC, panic));
+    TEST_ASSERT_EQUAL(2, queue.size());
+
+    // Compacted after removals
+    const auto first = queue.front();
+    TEST_ASSERT(first->payload == "panic");
+    queue.remove(first->id);
+    TEST_ASSERT(queue.front()->payload == log);
+}
+
+void maxRequests() {
+    OutboundQueue queue;
+    for (uint8_t index = 0; index < OutboundQueue::maxRequests; ++index) {
+        const auto panic = std::to_string(index);
+        TEST_ASSERT(queue.push(OutboundKind::PANIC, panic));
+    }
+    TEST_ASSERT(!queue.push(OutboundKind::PANIC, "another"));
+    TEST_ASSERT(!queue.push(OutboundKind::LOG, "log"));
+
+    // Oldest first
+    for (uint8_t index = 0; index < OutboundQueue::maxRequests; ++index) {
+        const auto request = queue.front();
+        TEST_ASSERT(request->payload == std::to_string(index));
+        queue.remove(request->id);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(priority);
+    RUN_TEST(coalescing);
+    RUN_TEST(bounded);
+    RUN_TEST(maxRequests);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "report.hpp"
+#include "configuration.hpp"
+
+#include <unity.h>
+#include <cmath>
+
+/// Every value is `value`, NaN means the sensors didn't answer
+auto reading(const float value) -> Event {
+    auto storage = (EventStorage){};
+    storage.values.fill(value);
+    return Event(storage);
+}
+
+auto summaryOf(const std::initializer_list<Event> events) -> Summary {
+    Aggregator aggregator;
+    for (const auto &event: events)
+        aggregator.add(event);
+    return aggregator.summary();
+}
+
+void first() {
+    ReportPolicy policy;
+    TEST_ASSERT(policy.shouldReport(summaryOf({ reading(NAN) }), 0));
+}
+
+void deadband() {
+    for (const auto &field: eventFields) {
+        ReportPolicy policy;
+        policy.reported(reading(20), 0);
+
+        // Moving exactly the deadband is still noise
+        auto event = reading(20);
+        event.storage.values.at(field.offset) = 20 + field.deadband;
+        TEST_ASSERT(!policy.shouldReport(summaryOf({ event }), 1));
+        event.storage.values.at(field.offset) = 20 - field.deadband;
+        TEST_ASSERT(!policy.shouldReport(summaryOf({ event }), 1));
+
+        event.storage.values.at(field.offset) = 20 + field.deadband * 2;
+        TEST_ASSERT(policy.shouldReport(summaryOf({ event }), 1));
+
+        // A short spike isn't diluted by the calm samples around it
+        auto spike = reading(20);
+        spike.storage.values.at(field.offset) = 20 - field.deadband * 2;
+        TEST_ASSERT(policy.shouldReport(summaryOf({ reading(20), reading(20), spike, reading(20) }), 1));
+    }
+}
+
+void nan() {
+    ReportPolicy policy;
+    policy.reported(reading(NAN), 0);
+    TEST_ASSERT(!policy.shouldReport(summaryOf({ reading(NAN) }), 1));
+    TEST_ASSERT(policy.shouldReport(summaryOf({ reading(20) }), 1));
+
+    policy.reported(reading(20), 1);
+    TEST_ASSERT(!policy.shouldReport(summaryOf({ reading(20) }), 2));
+    TEST_ASSERT(policy.shouldReport(summaryOf({ reading(NAN) }), 2));
+    // A single failed read among valid ones isn't a change
+    TEST_ASSERT(!policy.shouldReport(summaryOf({ reading(20), reading(NAN) }), 2));
+}
+
+void probes() {
+    for (const auto &field: eventFields) {
+        if (field.capacity < 2)
+            continue;
+        const auto last = field.offset + field.capacity - 1;
+
+        auto reference = reading(20);
+        reference.storage.values.at(last) = NAN;
+        ReportPolicy policy;
+        policy.reported(reference, 0);
+        TEST_ASSERT(!policy.shouldReport(summaryOf({ reference }), 1));
+
+        // Plugged
+        TEST_ASSERT(policy.shouldReport(summaryOf({ reading(20) }), 1));
+
+        // Unplugged
+        policy.reported(reading(20), 1);
+        TEST_ASSERT(policy.shouldReport(summaryOf({ reference }), 2));
+    }
+}
+
+void heartbeat() {
+    // Right before `millis()` overflows
+    const auto reportedAt = static_cast<iop::esp_time>(0) - config::reportHeartbeat / 2;
+    ReportPolicy policy;
+    policy.reported(reading(20), reportedAt);
+
+    const auto summary = summaryOf({ reading(20) });
+    TEST_ASSERT(!policy.shouldReport(summary, reportedAt + 1));
+    TEST_ASSERT(!policy.shouldReport(summary, reportedAt + config::reportHeartbeat - 1));
+    TEST_ASSERT(policy.shouldReport(summary, reportedAt + config::reportHeartbeat));
+    TEST_ASSERT(policy.shouldReport(summary, reportedAt + config::reportHeartbeat + 1));
+}
+
+void counters() {
+    ReportPolicy policy;
+    policy.reported(reading(20), 0);
+    policy.suppressed();
+    policy.suppressed();
+    policy.reported(reading(20), 1);
+    TEST_ASSERT_EQUAL(2, policy.counters().sent);
+    TEST_ASSERT_EQUAL(2, policy.counters().suppressed);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(first);
+    RUN_TEST(deadband);
+    RUN_TEST(nan);
+    RUN_TEST(probes);
+    RUN_TEST(heartbeat);
+    RUN_TEST(counters);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include "core/request.hpp"
+#include "driver/backend.hpp"
+#include "driver/client.hpp"
+
+#include <unity.h>
+#include <string>
+
+static driver::MockBackend backend(0);
+static WiFiClient wifiClient;
+static iop::HttpRequest request(wifiClient);
+static std::array<char, 128> body;
+
+static auto uri(const std::string &path) -> std::string {
+    return std::string("http://127.0.0.1:") + std::to_string(backend.port()) + path;
+}
+
+static auto start(const std::string &method, const std::string &path, const std::string_view data, const iop::esp_time timeout = 2000) -> bool {
+    return request.begin(method, uri(path)) && request.start(data, body, timeout, driver::thisThread.now());
+}
+
+/// Steps it like the event loop would, counting the iterations
+static auto run() -> uint32_t {
+    uint32_t steps = 0;
+    while (request.isInFlight()) {
+        request.step(driver::thisThread.now());
+        driver::thisThread.sleep(1);
+        steps++;
+    }
+    return steps;
+}
+
+void uris() {
+    TEST_ASSERT(request.begin("GET", "http://127.0.0.1:4001/v1/update"));
+    TEST_ASSERT(request.begin("GET", "https://example.com"));
+    TEST_ASSERT(!request.begin("GET", "ftp://example.com/"));
+    TEST_ASSERT(!request.begin("GET", "http://example.com:port/"));
+    TEST_ASSERT(!request.begin("GET", "http://:80/"));
+    TEST_ASSERT(!request.begin("GET", std::string("http://example.com/") + std::string(iop::HttpRequest::headCapacity, 'a')));
+    // A failed `begin` can't be started
+    TEST_ASSERT(!request.start("", body, 1000, driver::thisThread.now()));
+}
+
+void post() {
+    backend.clear();
+    TEST_ASSERT(start("POST", "/v1/user/login", "{\"email\":\"a@b.c\"}"));
+    TEST_ASSERT(request.state() == iop::HttpRequest::State::CONNECTING);
+    run();
+
+    TEST_ASSERT(request.state() == iop::HttpRequest::State::DONE);
+    TEST_ASSERT_EQUAL(200, request.code());
+    TEST_ASSERT_EQUAL(64, request.payload().length());
+    const auto received = backend.received();
+    TEST_ASSERT_EQUAL_STRING("{\"email\":\"a@b.c\"}", received.back().body.c_str());
+    TEST_ASSERT(received.back().header("content-length") == std::string_view("17"));
+}
+
+void headers() {
+    backend.clear();
+    backend.setLatestVersion(std::string(32, 'a'));
+    // Kept by later requests
+    TEST_ASSERT(request.collect("LATEST_VERSION"));
+    TEST_ASSERT(request.begin("HEAD", uri("/v1/update")));
+    request.expectNoBody();
+    TEST_ASSERT(request.addHeader("If-None-Match", "\"etag\""));
+    TEST_ASSERT(request.start("", body, 2000, driver::thisThread.now()));
+    run();
+
+    TEST_ASSERT_EQUAL(200, request.code());
+    TEST_ASSERT(request.header("LATEST_VERSION") == std::string_view(std::string(32, 'a')));
+    TEST_ASSERT(backend.received().back().header("if-none-match") == std::string_view("\"etag\""));
+    backend.setLatestVersion(std::nullopt);
+}
+
+void slowServer() {
+    backend.clear();
+    driver::MockResponse slow;
+    slow.body = std::string(100, 'x');
+    slow.latency = 200;
+    slow.chunkSize = 16;
+    slow.chunkDelay = 20;
+    backend.script("/v1/log", slow);
+
+    // The loop keeps running while the server answers
+    TEST_ASSERT(start("POST", "/v1/log", "log"));
+    TEST_ASSERT(run() > 50);
+    TEST_ASSERT_EQUAL(200, request.code());
+    TEST_ASSERT(request.payload() == std::string_view(slow.body));
+    TEST_ASSERT(!request.overflowed());
+}
+
+void overflow() {
+    backend.clear();
+    driver::MockResponse big;
+    big.body = std::string(body.size() + 1, 'x');
+    backend.script("/v1/log", big);
+
+    TEST_ASSERT(start("POST", "/v1/log", "log"));
+    run();
+    TEST_ASSERT_EQUAL(200, request.code());
+    TEST_ASSERT(request.overflowed());
+    TEST_ASSERT_EQUAL(body.size(), request.payload().length());
+}
+
+void discarded() {
+    backend.clear();
+    driver::MockResponse answer;
+    answer.body = "{\"received\":true}";
+    backend.script("/v1/summary", answer);
+
+    // No buffer, so the body is read and discarded
+    TEST_ASSERT(request.begin("POST", uri("/v1/summary")) && request.start("{}", iop::Span<char>(nullptr, 0), 2000, driver::thisThread.now()));
+    run();
+    TEST_ASSERT_EQUAL(200, request.code());
+    TEST_ASSERT(!request.overflowed());
+    TEST_ASSERT(request.payload().empty());
+}
+
+void reuse() {
+    backend.clear();
+    TEST_ASSERT(start("POST", "/v1/event", "a"));
+    run();
+    TEST_ASSERT(start("POST", "/v1/event", "b"));
+    run();
+    TEST_ASSERT_EQUAL(200, request.code());
+    TEST_ASSERT_EQUAL(2, backend.receivedCount("/v1/event"));
+    TEST_ASSERT(request.wasReused());
+
+    // Canceled before sending anything, the connection stays open
+    TEST_ASSERT(start("POST", "/v1/event", "x"));
+    request.cancel();
+    TEST_ASSERT(wifiClient.connected());
+
+    // Closed in the meantime, so it reconnects
+    wifiClient.stop();
+    TEST_ASSERT(start("POST", "/v1/event", "c"));
+    run();
+    TEST_ASSERT_EQUAL(200, request.code());
+    TEST_ASSERT(!request.wasReused());
+}
+
+void failures() {
+    backend.clear();
+    driver::MockResponse slow;
+    slow.latency = 500;
+    backend.script("/v1/log", slow);
+    TEST_ASSERT(start("POST", "/v1/log", "log", 100));
+    run();
+    TEST_ASSERT(request.state() == iop::HttpRequest::State::FAILED);
+    TEST_ASSERT_EQUAL(HTTPC_ERROR_READ_TIMEOUT, request.code());
+
+    driver::MockResponse truncated;
+    truncated.body = std::string(100, 'x');
+    truncated.truncateAt = 80;
+    backend.script("/v1/log", truncated);
+    TEST_ASSERT(start("POST", "/v1/log", "log"));
+    run();
+    TEST_ASSERT_EQUAL(HTTPC_ERROR_CONNECTION_LOST, request.code());
+
+    TEST_ASSERT(request.begin("POST", "http://127.0.0.1:1/v1/log") && request.start("", body, 1000, driver::thisThread.now()));
+    run();
+    TEST_ASSERT_EQUAL(HTTPC_ERROR_CONNECTION_FAILED, request.code());
+
+    TEST_ASSERT(start("POST", "/v1/log", "log"));
+    request.cancel();
+    TEST_ASSERT(!request.isInFlight());
+    TEST_ASSERT(request.step(driver::thisThread.now()) == iop::HttpRequest::State::FAILED);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    TEST_ASSERT(backend.start());
+    RUN_TEST(uris);
+    RUN_TEST(post);
+    RUN_TEST(headers);
+    RUN_TEST(slowServer);
+    RUN_TEST(overflow);
+    RUN_TEST(discarded);
+    RUN_TEST(reuse);
+    RUN_TEST(failures);
+    backend.stop();
+    UNITY_END();
+    return 0;
+}
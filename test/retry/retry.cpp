@@ -0,0 +1,128 @@
+#include "core/retry.hpp"
+
+#include <unity.h>
+
+constexpr static iop::esp_time base = 1000;
+constexpr static iop::esp_time max = 60000;
+constexpr static iop::esp_time cooldown = 100000;
+
+void backoff() {
+    iop::RetryPolicy retry(base, max, 3, cooldown);
+    retry.seed(42);
+    TEST_ASSERT(retry.attempt("/v1/event", 0));
+
+    // Full jitter: anywhere up to the exponential ceiling
+    iop::esp_time now = 0;
+    iop::esp_time ceiling = base;
+    for (int failures = 0; failures < 10; ++failures) {
+        retry.failed("/v1/event", now, iop::RetryFailure::TRANSIENT, std::nullopt);
+        const auto wait = retry.waitFor("/v1/event", now);
+        TEST_ASSERT(wait <= ceiling);
+        ceiling = ceiling * 2 < max ? ceiling * 2 : max;
+        now += wait;
+        TEST_ASSERT(retry.attempt("/v1/event", now));
+    }
+
+    // Other endpoints aren't affected
+    retry.failed("/v1/event", now, iop::RetryFailure::TRANSIENT, 500);
+    TEST_ASSERT(!retry.attempt("/v1/event", now));
+    TEST_ASSERT(retry.attempt("/v1/log", now));
+    TEST_ASSERT_EQUAL(1, retry.state(now).suppressed);
+    TEST_ASSERT_EQUAL(1, retry.state(now).backingOff);
+
+    retry.succeeded("/v1/event");
+    TEST_ASSERT_EQUAL(0, retry.waitFor("/v1/event", now));
+}
+
+void retryAfter() {
+    iop::RetryPolicy retry(base, max, 3, cooldown);
+    retry.failed("/v1/event", 0, iop::RetryFailure::TRANSIENT, 30000);
+    TEST_ASSERT_EQUAL(30000, retry.waitFor("/v1/event", 0));
+    TEST_ASSERT_EQUAL(10000, retry.waitFor("/v1/event", 20000));
+    TEST_ASSERT(retry.attempt("/v1/event", 30000));
+
+    // Never longer than the maximum delay
+    retry.failed("/v1/event", 0, iop::RetryFailure::TRANSIENT, 24 * 60 * 60 * 1000);
+    TEST_ASSERT_EQUAL(max, retry.waitFor("/v1/event", 0));
+}
+
+void circuitBreaker() {
+    iop::RetryPolicy retry(base, max, 3, cooldown);
+    retry.failed("/v1/event", 0, iop::RetryFailure::BROKEN_SERVER, 0);
+    retry.failed("/v1/log", 0, iop::RetryFailure::BROKEN_SERVER, 0);
+    TEST_ASSERT(!retry.isOpen(0));
+    retry.failed("/v1/event", 0, iop::RetryFailure::BROKEN_SERVER, 0);
+    TEST_ASSERT(retry.isOpen(0));
+
+    // Every endpoint waits for the jittered cooldown
+    const auto wait = retry.waitFor("/v1/panic", 0);
+    TEST_ASSERT(wait >= cooldown / 2 && wait <= cooldown);
+    TEST_ASSERT(!retry.attempt("/v1/panic", wait - 1));
+    TEST_ASSERT(retry.state(wait - 1).breakerOpen);
+    TEST_ASSERT_EQUAL(1, retry.state(wait - 1).waitFor);
+
+    // Half-open: a single trial is in flight
+    TEST_ASSERT(retry.attempt("/v1/panic", wait));
+    TEST_ASSERT(!retry.attempt("/v1/panic", wait));
+    TEST_ASSERT(!retry.attempt("/v1/update", wait + 1));
+
+    // A failed trial opens it again
+    retry.failed("/v1/panic", wait, iop::RetryFailure::TRANSIENT, std::nullopt);
+    TEST_ASSERT(retry.isOpen(wait));
+
+    // And a successful one closes it
+    const auto reopened = wait + retry.waitFor("/v1/log", wait);
+    TEST_ASSERT(retry.attempt("/v1/log", reopened));
+    retry.succeeded("/v1/log");
+    TEST_ASSERT(!retry.isOpen(reopened));
+    TEST_ASSERT_EQUAL(0, retry.waitFor("/v1/log", reopened));
+}
+
+void lostTrial() {
+    iop::RetryPolicy retry(base, max, 1, cooldown);
+    retry.failed("/v1/event", 0, iop::RetryFailure::BROKEN_SERVER, 0);
+    const auto wait = retry.waitFor("/v1/log", 0);
+    TEST_ASSERT(retry.attempt("/v1/log", wait));
+
+    // The trial never reported back, another one is allowed after a cooldown
+    TEST_ASSERT(!retry.attempt("/v1/log", wait + cooldown - 1));
+    TEST_ASSERT(retry.attempt("/v1/log", wait + cooldown));
+}
+
+void overflow() {
+    iop::RetryPolicy retry(base, max, 0, cooldown);
+    // `millis()` wraps around
+    const iop::esp_time now = static_cast<iop::esp_time>(-1) - 100;
+    retry.failed("/v1/event", now, iop::RetryFailure::BROKEN_SERVER, 1000);
+    TEST_ASSERT_EQUAL(500, retry.waitFor("/v1/event", now + 500));
+    TEST_ASSERT_EQUAL(0, retry.waitFor("/v1/event", now + 1000));
+    // Disabled breaker
+    TEST_ASSERT(!retry.isOpen(now));
+}
+
+void jitter() {
+    iop::RetryPolicy first(base, max, 3, cooldown);
+    iop::RetryPolicy second(base, max, 3, cooldown);
+    first.seed(1);
+    second.seed(2);
+
+    bool differs = false;
+    for (int i = 0; i < 100; ++i) {
+        const auto a = first.jitter(3600);
+        TEST_ASSERT(a >= 1800 && a <= 3600);
+        differs |= a != second.jitter(3600);
+    }
+    TEST_ASSERT(differs);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(backoff);
+    RUN_TEST(retryAfter);
+    RUN_TEST(circuitBreaker);
+    RUN_TEST(lostTrial);
+    RUN_TEST(overflow);
+    RUN_TEST(jitter);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "driver/simulator.hpp"
+#include "aggregator.hpp"
+#include "sensors.hpp"
+
+#include <unity.h>
+#include <cmath>
+
+constexpr static iop::esp_time day = 24 * 60 * 60 * 1000;
+
+auto flat() -> driver::SeriesProfile {
+    auto profile = (driver::SeriesProfile){};
+    profile.mean = 20;
+    profile.dayMillis = day;
+    profile.min = -INFINITY;
+    profile.max = INFINITY;
+    return profile;
+}
+
+void deterministic() {
+    auto profile = flat();
+    profile.noise = 1;
+    profile.failureProbability = 0.1F;
+    profile.stuckProbability = 0.1F;
+    profile.stuckSamples = 3;
+
+    driver::Series first(profile, 42);
+    driver::Series second(profile, 42);
+    driver::Series other(profile, 43);
+    bool differs = false;
+    for (iop::esp_time now = 0; now < 1000 * 10000; now += 10000) {
+        const auto a = first.sample(now);
+        const auto b = second.sample(now);
+        const auto c = other.sample(now);
+        TEST_ASSERT((std::isnan(a) && std::isnan(b)) || a == b);
+        differs |= a != c;
+    }
+    TEST_ASSERT(differs);
+}
+
+void diurnal() {
+    auto profile = flat();
+    profile.amplitude = 5;
+
+    driver::Series series(profile, 1);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 15, series.sample(0));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 25, series.sample(day / 2));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 15, series.sample(day));
+
+    profile.driftPerDay = 2;
+    driver::Series drifting(profile, 1);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 17, drifting.sample(day));
+}
+
+void faults() {
+    auto profile = flat();
+    profile.failureProbability = 1;
+    driver::Series failing(profile, 1);
+    for (iop::esp_time now = 0; now < 100; ++now)
+        TEST_ASSERT(std::isnan(failing.sample(now)));
+
+    profile = flat();
+    profile.amplitude = 5;
+    profile.stuckProbability = 1;
+    profile.stuckSamples = 10;
+    driver::Series stuck(profile, 1);
+    const auto first = stuck.sample(0);
+    for (iop::esp_time hour = 1; hour < 24; ++hour)
+        TEST_ASSERT_EQUAL_FLOAT(first, stuck.sample(hour * 60 * 60 * 1000));
+}
+
+void clamped() {
+    auto profile = flat();
+    profile.noise = 50;
+    profile.min = 0;
+    profile.max = 100;
+
+    driver::Series series(profile, 7);
+    for (iop::esp_time now = 0; now < 1000; ++now) {
+        const auto value = series.sample(now);
+        TEST_ASSERT(value >= 0 && value <= 100);
+    }
+}
+
+void pipeline() {
+    sensor::Simulated<sensor::SoilResistivity<config::soilResistivityPower>> sensor;
+    Aggregator aggregator;
+    float value = NAN;
+    TEST_ASSERT_EQUAL_STRING("soil_resistivity_raw", eventFields[3].name);
+
+    TEST_ASSERT(!sensor.poll(0, iop::Span<float>(&value, 1)));
+    for (int i = 0; i < 100; ++i) {
+        TEST_ASSERT(sensor.poll(decltype(sensor)::budgetMillis, iop::Span<float>(&value, 1)));
+        auto storage = (EventStorage){};
+        storage.values.fill(NAN);
+        storage.values[eventFields[3].offset] = value;
+        aggregator.add(Event(storage));
+    }
+
+    const auto &summary = aggregator.summary();
+    TEST_ASSERT_EQUAL(100, summary.samples);
+    const auto &resistivity = summary.channels[eventFields[3].offset];
+    TEST_ASSERT(resistivity.count > 90);
+    TEST_ASSERT_FLOAT_WITHIN(10, 700, resistivity.mean);
+    // Integer field
+    TEST_ASSERT_EQUAL_FLOAT(std::round(resistivity.min), resistivity.min);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(deterministic);
+    RUN_TEST(diurnal);
+    RUN_TEST(faults);
+    RUN_TEST(clamped);
+    RUN_TEST(pipeline);
+    UNITY_END();
+    return 0;
+}
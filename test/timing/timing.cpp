@@ -0,0 +1,108 @@
+#include "core/timing.hpp"
+
+#include <unity.h>
+#include <string>
+
+void timer() {
+    iop::RequestTimer timer;
+    // Not started
+    timer.mark(iop::RequestPhase::DNS, 10);
+    TEST_ASSERT(!timer.isRunning());
+
+    timer.start(100);
+    timer.mark(iop::RequestPhase::DNS, 103);
+    // Unmarked phases are counted in the next one
+    timer.mark(iop::RequestPhase::FIRST_BYTE, 150);
+    timer.mark(iop::RequestPhase::FIRST_BYTE, 160);
+    timer.mark(iop::RequestPhase::BODY, 165);
+    const auto timing = timer.stop();
+    TEST_ASSERT(!timer.isRunning());
+
+    TEST_ASSERT_EQUAL(3, timing.at(static_cast<uint8_t>(iop::RequestPhase::DNS)));
+    TEST_ASSERT_EQUAL(0, timing.at(static_cast<uint8_t>(iop::RequestPhase::CONNECT)));
+    TEST_ASSERT_EQUAL(0, timing.at(static_cast<uint8_t>(iop::RequestPhase::TLS)));
+    TEST_ASSERT_EQUAL(57, timing.at(static_cast<uint8_t>(iop::RequestPhase::FIRST_BYTE)));
+    TEST_ASSERT_EQUAL(5, timing.at(static_cast<uint8_t>(iop::RequestPhase::BODY)));
+
+    // `millis()` wraps around
+    timer.start(static_cast<iop::esp_time>(-5));
+    timer.mark(iop::RequestPhase::CONNECT, 5);
+    TEST_ASSERT_EQUAL(10, timer.stop().at(static_cast<uint8_t>(iop::RequestPhase::CONNECT)));
+}
+
+void buckets() {
+    TEST_ASSERT_EQUAL(0, iop::TimingHistogram::bucketOf(0));
+    TEST_ASSERT_EQUAL(1, iop::TimingHistogram::bucketOf(3));
+    TEST_ASSERT_EQUAL(2, iop::TimingHistogram::bucketOf(4));
+    TEST_ASSERT_EQUAL(2, iop::TimingHistogram::bucketOf(15));
+    TEST_ASSERT_EQUAL(3, iop::TimingHistogram::bucketOf(16));
+    TEST_ASSERT_EQUAL(8, iop::TimingHistogram::bucketOf(1000000));
+
+    // Every duration is below the upper bound of its bucket
+    for (iop::esp_time duration = 1; duration < 16384; duration = duration * 3 + 1)
+        TEST_ASSERT(duration < iop::TimingHistogram::upperBound(iop::TimingHistogram::bucketOf(duration)));
+}
+
+void percentiles() {
+    iop::TimingHistogram histogram;
+    TEST_ASSERT_EQUAL(0, histogram.percentile(iop::RequestPhase::FIRST_BYTE, 50));
+
+    for (int index = 0; index < 19; ++index)
+        histogram.record(iop::RequestTiming{0, 0, 0, 100, 1});
+    histogram.record(iop::RequestTiming{0, 0, 0, 5000, 1});
+
+    TEST_ASSERT_EQUAL(256, histogram.percentile(iop::RequestPhase::FIRST_BYTE, 50));
+    TEST_ASSERT_EQUAL(256, histogram.percentile(iop::RequestPhase::FIRST_BYTE, 95));
+    TEST_ASSERT_EQUAL(16384, histogram.percentile(iop::RequestPhase::FIRST_BYTE, 100));
+    TEST_ASSERT_EQUAL(0, histogram.percentile(iop::RequestPhase::TLS, 95));
+    TEST_ASSERT_EQUAL(4, histogram.percentile(iop::RequestPhase::BODY, 50));
+}
+
+void rolling() {
+    iop::TimingHistogram histogram;
+    for (int index = 0; index < iop::TimingHistogram::window; ++index)
+        histogram.record(iop::RequestTiming{0, 0, 0, 5000, 0});
+    TEST_ASSERT_EQUAL(16384, histogram.percentile(iop::RequestPhase::FIRST_BYTE, 50));
+
+    // The slow requests fade away
+    for (int index = 0; index < iop::TimingHistogram::window * 3; ++index)
+        histogram.record(iop::RequestTiming{0, 0, 0, 10, 0});
+    TEST_ASSERT_EQUAL(16, histogram.percentile(iop::RequestPhase::FIRST_BYTE, 95));
+    TEST_ASSERT(histogram.samples() <= iop::TimingHistogram::window);
+    TEST_ASSERT_EQUAL(iop::TimingHistogram::window * 4, histogram.total());
+}
+
+void metrics() {
+    TEST_ASSERT_EQUAL(0, iop::NetworkTimings::endpointOf("/v1/events"));
+    TEST_ASSERT_EQUAL(1, iop::NetworkTimings::endpointOf("/v1/summary"));
+    TEST_ASSERT_EQUAL(2, iop::NetworkTimings::endpointOf("/v1/log?level=info"));
+    TEST_ASSERT_EQUAL(4, iop::NetworkTimings::endpointOf("/v1/user/login"));
+    // Nothing posts single events anymore
+    TEST_ASSERT_EQUAL(iop::NetworkTimings::endpoints - 1, iop::NetworkTimings::endpointOf("/v1/event"));
+    TEST_ASSERT_EQUAL(iop::NetworkTimings::endpoints - 1, iop::NetworkTimings::endpointOf("/v1/unknown"));
+
+    iop::NetworkTimings timings;
+    std::array<char, 256> buffer;
+    TEST_ASSERT_EQUAL_STRING("{}", std::string(timings.serialize(buffer).value_or("")).c_str());
+
+    timings.record("/v1/events", iop::RequestTiming{2, 30, 200, 100, 1});
+    timings.record("/v1/summary", iop::RequestTiming{0, 0, 0, 10, 0});
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"events\":{\"n\":1,\"p50\":[4,64,256,256,4],\"p95\":[4,64,256,256,4]},"
+        "\"summary\":{\"n\":1,\"p50\":[0,0,0,16,0],\"p95\":[0,0,0,16,0]}}",
+        std::string(timings.serialize(buffer).value_or("")).c_str());
+
+    std::array<char, 32> small;
+    TEST_ASSERT(!timings.serialize(small).has_value());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(timer);
+    RUN_TEST(buckets);
+    RUN_TEST(percentiles);
+    RUN_TEST(rolling);
+    RUN_TEST(metrics);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "core/upgrade.hpp"
+
+#include <unity.h>
+
+static auto hashOf(const char c) -> iop::MD5Hash {
+    iop::MD5Hash hash;
+    hash.fill(c);
+    return hash;
+}
+
+void givesUp() {
+    iop::UpgradeAttempts attempts(2);
+    const auto broken = hashOf('A');
+    TEST_ASSERT(attempts.shouldDownload(broken));
+    attempts.failed(broken);
+    TEST_ASSERT(attempts.shouldDownload(broken));
+    attempts.failed(broken);
+    TEST_ASSERT(!attempts.shouldDownload(broken));
+    TEST_ASSERT_EQUAL(2, attempts.failuresOf(broken));
+
+    // A new image gets its own attempts
+    const auto fixed = hashOf('B');
+    TEST_ASSERT(attempts.shouldDownload(fixed));
+    attempts.failed(fixed);
+    TEST_ASSERT_EQUAL(1, attempts.failuresOf(fixed));
+    TEST_ASSERT_EQUAL(0, attempts.failuresOf(broken));
+}
+
+void persistence() {
+    iop::UpgradeAttempts attempts(1);
+    attempts.failed(hashOf('A'));
+    auto persisted = attempts.persist();
+
+    iop::UpgradeAttempts restored(1);
+    restored.restore(persisted);
+    TEST_ASSERT(!restored.shouldDownload(hashOf('A')));
+
+    // RTC memory is garbage after a power loss
+    persisted.at(4) ^= 1;
+    iop::UpgradeAttempts corrupted(1);
+    corrupted.restore(persisted);
+    TEST_ASSERT(corrupted.shouldDownload(hashOf('A')));
+
+    iop::UpgradeAttempts empty(1);
+    empty.restore(iop::UpgradeAttempts::Persisted{});
+    TEST_ASSERT(empty.shouldDownload(hashOf('A')));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(givesUp);
+    RUN_TEST(persistence);
+    UNITY_END();
+    return 0;
+}